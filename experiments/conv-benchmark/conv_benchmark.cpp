@@ -0,0 +1,240 @@
+#include "conv_benchmark_config.h"
+
+#include "utils/tensor.h"
+#include "utils/linear_algebra.h"
+#include "utils/gemm.h"
+#include "utils/parallel_for.h"
+#include "utils/rand.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+using namespace bioauth;
+using namespace bioauth::experiments::conv_benchmark;
+
+
+// The convolution of tensor.h before im2col(): an Eigen tensor expression that extracts the patches in each call
+template <typename T>
+void eigenConvolution(const T* input_buffer, const T* kernel_buffer, T* output_buffer, const Conv2DOp& conv_op) {
+    using TensorType3 = Eigen::Tensor<T, 3, Eigen::RowMajor>;
+    using CTensorType3 = Eigen::Tensor<const T, 3, Eigen::RowMajor>;
+    using CTensorType4 = Eigen::Tensor<const T, 4, Eigen::RowMajor>;
+
+    const auto& output_shape = conv_op.output_shape_;
+    const auto& input_shape = conv_op.input_shape_;
+    const auto& kernel_shape = conv_op.kernel_shape_;
+
+    Eigen::TensorMap<CTensorType3> input(input_buffer, input_shape[0], input_shape[1], input_shape[2]);
+    Eigen::TensorMap<CTensorType4> kernel(kernel_buffer, kernel_shape[0], kernel_shape[1], kernel_shape[2],
+                                          kernel_shape[3]);
+    Eigen::TensorMap<TensorType3> output(output_buffer, output_shape[0], output_shape[1], output_shape[2]);
+    const std::array<Eigen::Index, 2> kernel_matrix_dimensions = {
+        static_cast<Eigen::Index>(kernel_shape[1] * kernel_shape[2] * kernel_shape[3]),
+        static_cast<Eigen::Index>(kernel_shape[0])
+    };
+    const std::array<Eigen::Index, 2> input_matrix_dimensions = {
+        static_cast<Eigen::Index>(output_shape[1] * output_shape[2]),
+        static_cast<Eigen::Index>(kernel_shape[1] * kernel_shape[2] * kernel_shape[3])
+    };
+
+    auto kernel_matrix = kernel.shuffle(std::array<int, 4>{3, 2, 1, 0}).reshape(kernel_matrix_dimensions);
+    auto input_matrix =
+        input.shuffle(Eigen::array<Eigen::Index, 3>{2, 1, 0})
+             .extract_image_patches(kernel_shape[2], kernel_shape[3], conv_op.strides_[0], conv_op.strides_[1],
+                                    conv_op.dilations_[0], conv_op.dilations_[1], 1, 1, conv_op.pads_[0],
+                                    conv_op.pads_[2], conv_op.pads_[1], conv_op.pads_[3], 0)
+             .reshape(input_matrix_dimensions);
+
+    const std::array<Eigen::IndexPair<Eigen::Index>, 1> contraction_dimensions = {
+        Eigen::IndexPair<Eigen::Index>(1, 0)
+    };
+    auto output_matrix =
+        kernel_matrix.shuffle(std::array<Eigen::Index, 2>{1, 0})
+                     .contract(input_matrix.shuffle(std::array<Eigen::Index, 2>{1, 0}), contraction_dimensions)
+                     .shuffle(std::array<Eigen::Index, 2>{1, 0});
+
+    const std::array<Eigen::Index, 3> rev_output_dimensions = {
+        output.dimension(2), output.dimension(1), output.dimension(0)
+    };
+    output = output_matrix.reshape(rev_output_dimensions).shuffle(Eigen::array<Eigen::Index, 3>{2, 1, 0});
+}
+
+
+// The average milliseconds of an operation over kRepetitions runs
+template <typename Operation>
+double measure(const Operation& operation) {
+    operation(); // warm up the caches
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t repetition = 0; repetition < kRepetitions; ++repetition) {
+        operation();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(kRepetitions);
+}
+
+
+template <typename T>
+std::vector<T> random(std::size_t size) {
+    std::vector<T> values(size);
+    std::generate(values.begin(), values.end(), [] { return getRand<T>(); });
+    return values;
+}
+
+
+// The operands of Conv2DGate for one layer, with the patches of [a] and [a_mac] extracted as the gate reads them
+template <typename T>
+struct GateOperands {
+    explicit GateOperands(const Conv2DOp& op)
+        : temp_x(random<T>(op.compute_input_size())), a_stacked(random<T>(2 * op.compute_input_size())),
+          kernel_stacked(random<T>(3 * op.compute_kernel_size())) {
+        auto [patch_rows, patch_cols] = op.compute_input_matrix_shape();
+        a_patches.resize(patch_rows * patch_cols);
+        a_mac_patches.resize(patch_rows * patch_cols);
+        im2col(a_stacked.data(), a_patches.data(), op);
+        im2col(a_stacked.data() + op.compute_input_size(), a_mac_patches.data(), op);
+    }
+
+    std::vector<T> temp_x;
+    std::vector<T> a_stacked;      // [a; a_mac]
+    std::vector<T> kernel_stacked; // [temp_y; b; b_mac]
+    std::vector<T> a_patches, a_mac_patches;
+    std::vector<T> temp_x_patches, product, Delta, channel_major;
+};
+
+
+// The products of the online phase of Conv2DGate: the patches of temp_x,
+// [temp_xy; temp_x * [b]; temp_x * [b_mac]] and [Delta_z; Delta_z_mac] = [[a] * temp_y; [a_mac] * temp_y]
+template <typename T>
+void gateProducts(GateOperands<T>& operands, const Conv2DOp& op) {
+    auto size_output = op.compute_output_size();
+    auto num_kernels = op.kernel_shape_[0];
+    auto [patch_rows, patch_cols] = op.compute_input_matrix_shape();
+    operands.temp_x_patches.resize(patch_rows * patch_cols);
+    operands.product.resize(3 * size_output);
+    operands.Delta.resize(2 * size_output);
+
+    im2col(operands.temp_x.data(), operands.temp_x_patches.data(), op);
+    convolvePatches(operands.kernel_stacked.data(), 3 * num_kernels, operands.temp_x_patches.data(),
+                    operands.product.data(), operands.channel_major, op);
+    convolvePatches(operands.kernel_stacked.data(), num_kernels, operands.a_patches.data(), operands.Delta.data(),
+                    operands.channel_major, op);
+    convolvePatches(operands.kernel_stacked.data(), num_kernels, operands.a_mac_patches.data(),
+                    operands.Delta.data() + size_output, operands.channel_major, op);
+}
+
+
+// Compares the products of Conv2DGate for one layer with the Eigen tensor convolutions
+template <typename T>
+void benchmarkLayer(const Layer& layer) {
+    const auto& op = layer.op;
+    auto size_lhs = op.compute_input_size();
+    auto size_output = op.compute_output_size();
+    auto patch_rows = op.compute_input_matrix_shape().first;
+
+    GateOperands<T> operands(op);
+    const auto& temp_x = operands.temp_x;
+    const auto& a_stacked = operands.a_stacked;
+    const auto& kernel_stacked = operands.kernel_stacked;
+    const T* temp_y = kernel_stacked.data();
+
+    // Before: three convolutions, each extracting the patches of its image
+    Conv2DOp stacked_op = op;
+    stacked_op.kernel_shape_[0] *= 3;
+    stacked_op.output_shape_[0] *= 3;
+    std::vector<T> eigen_product(3 * size_output), eigen_Delta(2 * size_output);
+    auto eigen_milliseconds = measure([&] {
+        eigenConvolution(temp_x.data(), kernel_stacked.data(), eigen_product.data(), stacked_op);
+        eigenConvolution(a_stacked.data(), temp_y, eigen_Delta.data(), op);
+        eigenConvolution(a_stacked.data() + size_lhs, temp_y, eigen_Delta.data() + size_output, op);
+    });
+
+    // After: the patches of [a] and [a_mac] are extracted with the preprocessing data,
+    // those of temp_x once per session, and the products are computed by the GEMM
+    auto patches_milliseconds = measure([&] {
+        im2col(a_stacked.data(), operands.a_patches.data(), op);
+        im2col(a_stacked.data() + size_lhs, operands.a_mac_patches.data(), op);
+    });
+    auto gemm_milliseconds = measure([&] { gateProducts(operands, op); });
+
+    bool correct = operands.product == eigen_product && operands.Delta == eigen_Delta;
+    auto multiplications = static_cast<double>(5 * size_output * patch_rows);
+    std::cout << "  " << std::left << std::setw(16) << layer.name << std::right << std::fixed
+              << std::setw(12) << op.input_shape_[0] << "x" << std::setw(3) << op.input_shape_[1]
+              << "->" << std::setw(4) << op.output_shape_[0] << "x" << std::setw(3) << op.output_shape_[1]
+              << std::setprecision(3) << std::setw(12) << eigen_milliseconds << std::setw(12) << gemm_milliseconds
+              << std::setprecision(2) << std::setw(9) << eigen_milliseconds / gemm_milliseconds << "x"
+              << std::setprecision(0) << std::setw(10) << multiplications / gemm_milliseconds / 1e3
+              << std::setprecision(3) << std::setw(14) << patches_milliseconds
+              << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+// The products of Conv2DGate per image for the batch sizes of kBatchSizes, each batch in a single gate,
+// whose products are GEMMs over groups of images that fit in the cache, or over the whole batch for the small maps
+template <typename T>
+void benchmarkBatches(const Layer& layer) {
+    std::cout << "  " << std::left << std::setw(16) << layer.name << std::right << std::fixed;
+    double single_milliseconds = 0;
+    bool correct = true;
+    for (auto batch_size : kBatchSizes) {
+        Conv2DOp op = layer.op;
+        op.batch_size_ = batch_size;
+        GateOperands<T> operands(op);
+        auto milliseconds = measure([&] { gateProducts(operands, op); }) / static_cast<double>(batch_size);
+        single_milliseconds = batch_size == 1 ? milliseconds : single_milliseconds;
+        std::cout << std::setprecision(3) << std::setw(12) << milliseconds << std::setprecision(2) << std::setw(7)
+                  << single_milliseconds / milliseconds << "x";
+
+        // The outputs of the last image are those of a convolution of that image alone
+        Conv2DOp single_op = layer.op;
+        std::vector<T> last_image(operands.temp_x.end() - static_cast<std::ptrdiff_t>(single_op.compute_input_size()),
+                                  operands.temp_x.end());
+        std::vector<T> kernel(operands.kernel_stacked.begin(),
+                              operands.kernel_stacked.begin()
+                              + static_cast<std::ptrdiff_t>(single_op.compute_kernel_size()));
+        auto expected = convolution(last_image, kernel, single_op);
+        correct = correct && std::equal(expected.begin(), expected.end(),
+                                        operands.product.begin() + static_cast<std::ptrdiff_t>(
+                                            op.compute_output_size() - expected.size()));
+    }
+    std::cout << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+template <typename T>
+void benchmarkNetwork(const std::string& type_name) {
+    std::cout << type_name << "\n  " << std::left << std::setw(16) << "layer" << std::right << std::setw(21)
+              << "shape" << std::setw(12) << "Eigen ms" << std::setw(12) << "GEMM ms" << std::setw(10) << "speedup"
+              << std::setw(10) << "M mul/s" << std::setw(14) << "a patches ms" << "\n";
+    for (const auto& layer : kLayers) {
+        benchmarkLayer<T>(layer);
+    }
+
+    std::cout << "  ms per image (and speedup over a batch of 1) in a batch of";
+    for (auto batch_size : kBatchSizes) {
+        std::cout << " " << batch_size;
+    }
+    std::cout << "\n";
+    for (const auto& layer : kLayers) {
+        benchmarkBatches<T>(layer);
+    }
+}
+
+
+int main() {
+    setParallelThreads(std::thread::hardware_concurrency());
+    std::cout << "The local products of Conv2DGate per session, on " << parallelThreads() << " threads with the "
+              << gemmIsaName(gemmIsa()) << " GEMM\n"
+              << "Eigen: three Eigen tensor convolutions, GEMM: the patches of temp_x and three products\n"
+              << "The patches of [a] and [a_mac] are extracted when the preprocessing data is read (last column)\n";
+
+    benchmarkNetwork<std::uint64_t>("Z_2^64 (the shares of Spdz2kShare32)");
+    benchmarkNetwork<__uint128_t>("Z_2^128 (the shares of Spdz2kShare64)");
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef BIOAUTH_CONV_BENCHMARK_CONFIG_H
+#define BIOAUTH_CONV_BENCHMARK_CONFIG_H
+
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "utils/tensor.h"
+
+namespace bioauth::experiments::conv_benchmark {
+
+struct Layer {
+    std::string name;
+    Conv2DOp op;
+};
+
+// A convolution of 3x3 kernels (or another size) with a padding of `pad` on every side
+inline Conv2DOp convOp(std::size_t in_channels, std::size_t out_channels, std::size_t size, std::size_t kernel,
+                       std::size_t stride, std::size_t pad) {
+    Conv2DOp op{};
+    op.kernel_shape_ = {out_channels, in_channels, kernel, kernel};
+    op.input_shape_ = {in_channels, size, size};
+    op.dilations_ = {1, 1};
+    op.pads_ = {pad, pad, pad, pad};
+    op.strides_ = {stride, stride};
+    op.output_shape_ = op.compute_output_shape();
+    return op;
+}
+
+// The convolutions of a small face-embedding CNN on 64x64 RGB faces, shaped like the first stages of MobileFaceNet:
+// strided 3x3 convolutions halve the image, 1x1 convolutions expand the channels,
+// and a 4x4 convolution without padding reduces the last feature map to a 128-dimensional embedding
+const std::array<Layer, 7> kLayers = {{
+    {"conv1 3x3/2", convOp(3, 16, 64, 3, 2, 1)},
+    {"conv2 3x3", convOp(16, 16, 32, 3, 1, 1)},
+    {"conv3 3x3/2", convOp(16, 32, 32, 3, 2, 1)},
+    {"conv4 1x1", convOp(32, 64, 16, 1, 1, 0)},
+    {"conv5 3x3/2", convOp(64, 64, 16, 3, 2, 1)},
+    {"conv6 3x3/2", convOp(64, 128, 8, 3, 2, 1)},
+    {"embedding 4x4", convOp(128, 128, 4, 4, 1, 0)},
+}};
+
+constexpr std::size_t kRepetitions = 5; // the measurements are averaged over this many sessions
+
+// The probe images convolved by one gate, which shares the kernel and its preprocessing data across them
+constexpr std::array<std::size_t, 4> kBatchSizes = {1, 4, 16, 64};
+
+}
+
+
+#endif //BIOAUTH_CONV_BENCHMARK_CONFIG_H
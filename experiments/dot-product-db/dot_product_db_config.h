@@ -11,6 +11,7 @@ namespace bioauth::experiments::dot_product {
 const std::string kJobName = "DotProduct";
 constexpr std::size_t dim = 1024;
 constexpr std::size_t dbsize = 512;
+constexpr std::size_t kNumSessions = 10; // authentication sessions evaluated with one compiled circuit
 
 }
 
@@ -0,0 +1,38 @@
+#ifndef BIOAUTH_DOT_PRODUCT_SHARDS_CONFIG_H
+#define BIOAUTH_DOT_PRODUCT_SHARDS_CONFIG_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// Compares the serial layer walk with the work-stealing executor:
+// the database is split into shards, and the scores of each shard are computed by an independent branch.
+
+namespace bioauth::experiments::dot_product_shards {
+
+const std::string kJobName = "DotProductShards";
+constexpr std::size_t dim = 512;
+constexpr std::size_t kNumShards = 8;
+constexpr std::size_t kShardSize = 128; // database entries per shard
+constexpr std::size_t kNumSessions = 3; // sessions per executor, the offline data covers both executors
+
+/// Builds the same circuit for the online parties and the fake offline party,
+/// returns the query of party 0 and the database shards of party 1
+template <typename CircuitType>
+auto buildCircuit(CircuitType& circuit) {
+    auto query = circuit.input(0, 1, dim);
+    std::vector<decltype(query)> shards;
+    for (std::size_t shard = 0; shard < kNumShards; ++shard) {
+        shards.push_back(circuit.input(1, dim, kShardSize));
+        auto scores = circuit.multiply(query, shards.back());
+        circuit.addEndpoint(circuit.output(scores));
+    }
+    return std::pair{query, shards};
+}
+
+}
+
+
+#endif //BIOAUTH_DOT_PRODUCT_SHARDS_CONFIG_H
@@ -0,0 +1,27 @@
+
+#include "dot_product_shards_config.h"
+
+#include "fake-offline/FakeCircuit.h"
+#include "share/Spdz2kShare.h"
+#include "fake-offline/FakeParty.h"
+#include <iostream>
+
+using namespace bioauth;
+using namespace bioauth::experiments::dot_product_shards;
+
+
+int main() {
+    using ShrType = Spdz2kShare64;
+
+    FakeParty<ShrType, 2> party(kJobName);
+    FakeCircuit<ShrType, 2> circuit(party);
+    buildCircuit(circuit);
+
+    // kNumSessions sessions with the serial walk, then kNumSessions with the parallel executor
+    for (std::size_t session = 0; session < 2 * kNumSessions; ++session) {
+        circuit.runOffline();
+    }
+    std::cout << "Offline comm cost " << party.getTotalOfflineBytesWritten() << " bytes." << std::endl;
+
+    return 0;
+}
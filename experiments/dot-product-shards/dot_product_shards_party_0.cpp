@@ -0,0 +1,47 @@
+
+#include "dot_product_shards_config.h"
+
+#include "share/Spdz2kShare.h"
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::dot_product_shards;
+
+int main() {
+    using ShrType = Spdz2kShare64;
+    using ClearType = ShrType::ClearType;
+
+    PartyWithFakeOffline<ShrType> party(0, 2, 5050, kJobName);
+    Circuit<ShrType> circuit(party);
+    auto [query, shards] = buildCircuit(circuit);
+
+    std::size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<ClearType> vec_query(dim);
+    double mean_ms[2] = {0, 0};
+
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        circuit.setNumThreads(parallel ? num_threads : 1);
+        for (std::size_t session = 0; session < kNumSessions; ++session) {
+            std::generate(vec_query.begin(), vec_query.end(), [] { return getRand<ClearType>(); });
+            query->setInput(vec_query);
+
+            circuit.readOfflineFromFile();
+            circuit.runOnlineWithBenckmark();
+            mean_ms[parallel] += circuit.timer().elapsedMicroseconds() / 1000.0 / kNumSessions;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Shards: " << kNumShards << " x " << kShardSize << ", rounds: " << circuit.rounds() << "\n"
+              << "Serial walk: " << mean_ms[0] << " ms per session\n"
+              << "Work-stealing executor (" << num_threads << " threads): " << mean_ms[1] << " ms per session\n"
+              << "Speedup: " << mean_ms[0] / mean_ms[1] << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+
+#include "dot_product_shards_config.h"
+
+#include "share/Spdz2kShare.h"
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::dot_product_shards;
+
+int main() {
+    using ShrType = Spdz2kShare64;
+    using ClearType = ShrType::ClearType;
+
+    PartyWithFakeOffline<ShrType> party(1, 2, 5050, kJobName);
+    Circuit<ShrType> circuit(party);
+    auto shards = buildCircuit(circuit).second;
+
+    std::size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<ClearType> vec_shard(dim * kShardSize);
+    double mean_ms[2] = {0, 0};
+
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        circuit.setNumThreads(parallel ? num_threads : 1);
+        for (std::size_t session = 0; session < kNumSessions; ++session) {
+            for (auto& shard : shards) {
+                std::generate(vec_shard.begin(), vec_shard.end(), [] { return getRand<ClearType>(); });
+                shard->setInput(vec_shard);
+            }
+
+            circuit.readOfflineFromFile();
+            circuit.runOnlineWithBenckmark();
+            mean_ms[parallel] += circuit.timer().elapsedMicroseconds() / 1000.0 / kNumSessions;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "[Party 1] Serial walk: " << mean_ms[0] << " ms per session\n"
+              << "[Party 1] Work-stealing executor (" << num_threads << " threads): " << mean_ms[1] << " ms per session\n"
+              << "[Party 1] Speedup: " << mean_ms[0] / mean_ms[1] << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> allocated_bytes{0};
+
+void* countedAllocate(std::size_t size) {
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* countedAllocate(std::size_t size, std::align_val_t alignment) {
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(alignment);
+    if (auto pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+std::size_t bioauth::experiments::gate_allocations::allocatedBytes() {
+    return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+// The array forms of operator new and delete forward to these by default
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocate(size, alignment); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
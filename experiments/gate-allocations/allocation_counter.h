@@ -0,0 +1,15 @@
+#ifndef BIOAUTH_ALLOCATION_COUNTER_H
+#define BIOAUTH_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+namespace bioauth::experiments::gate_allocations {
+
+/// The bytes allocated with operator new since the start of the program,
+/// counted by the replacement of the global operator new in allocation_counter.cpp.
+/// Eigen allocates the temporaries of its products with malloc, which are not counted.
+std::size_t allocatedBytes();
+
+}
+
+#endif //BIOAUTH_ALLOCATION_COUNTER_H
@@ -0,0 +1,111 @@
+#ifndef BIOAUTH_GATE_ALLOCATIONS_CONFIG_H
+#define BIOAUTH_GATE_ALLOCATIONS_CONFIG_H
+
+
+#include <array>
+#include <string>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+
+#include "utils/tensor.h"
+
+// Measures the bytes allocated on the heap and the bytes sent by the online phase of each kind of gate.
+// Each kind is evaluated in a circuit of its own, made of its inputs, one gate and an output,
+// and the circuit without the gate (the input opened directly) is measured as the baseline.
+
+namespace bioauth::experiments::gate_allocations {
+
+const std::string kJobName = "GateAllocations";
+constexpr std::size_t dim = 64;              // the matrices are dim x dim
+constexpr std::size_t kNumSessions = 3;      // the first session allocates the buffers, the later ones reuse them
+constexpr std::size_t kParallelThreads = 4; // the loops are split over the pool, as in dot-product-db
+
+enum class GateKind { kNone, kAdd, kMultiply, kElemMultiply, kMultiplyTrunc, kConv2D, kAvgPool2D, kGtz };
+
+constexpr std::array kGateKinds = {GateKind::kNone, GateKind::kAdd, GateKind::kMultiply, GateKind::kElemMultiply,
+                                   GateKind::kMultiplyTrunc, GateKind::kConv2D, GateKind::kAvgPool2D,
+                                   GateKind::kGtz};
+
+inline const char* gateName(GateKind kind) {
+    switch (kind) {
+        case GateKind::kNone: return "(no gate)";
+        case GateKind::kAdd: return "Add";
+        case GateKind::kMultiply: return "Multiply";
+        case GateKind::kElemMultiply: return "ElemMultiply";
+        case GateKind::kMultiplyTrunc: return "MultiplyTrunc";
+        case GateKind::kConv2D: return "Conv2D";
+        case GateKind::kAvgPool2D: return "AvgPool2D";
+        case GateKind::kGtz: return "Gtz";
+    }
+    return "";
+}
+
+inline Conv2DOp convOp() {
+    Conv2DOp op{};
+    op.kernel_shape_ = {8, 3, 3, 3};
+    op.input_shape_ = {3, 32, 32};
+    op.output_shape_ = {8, 30, 30};
+    op.dilations_ = {1, 1};
+    op.pads_ = {0, 0, 0, 0};
+    op.strides_ = {1, 1};
+    return op;
+}
+
+inline MaxPoolOp poolOp() {
+    MaxPoolOp op{};
+    op.input_shape_ = {8, 30, 30};
+    op.output_shape_ = {8, 15, 15};
+    op.kernel_shape_ = {2, 2};
+    op.strides_ = {2, 2};
+    return op;
+}
+
+/// Builds the circuit of one kind of gate for the online parties and the fake offline party,
+/// returns the input of party 0 and the input of party 1 (nullptr if the gate has a single input)
+template <typename CircuitType>
+auto buildCircuit(CircuitType& circuit, GateKind kind) {
+    auto x = kind == GateKind::kConv2D ? circuit.input(0, convOp().compute_input_size(), 1)
+             : kind == GateKind::kAvgPool2D ? circuit.input(0, poolOp().compute_input_size(), 1)
+             : circuit.input(0, dim, dim);
+    decltype(x) y = nullptr;
+    typename std::remove_reference_t<decltype(circuit.endpoints())>::value_type gate = x; // the common gate type
+
+    switch (kind) {
+        case GateKind::kNone:
+            break;
+        case GateKind::kAdd:
+            y = circuit.input(1, dim, dim);
+            gate = circuit.add(x, y);
+            break;
+        case GateKind::kMultiply:
+            y = circuit.input(1, dim, dim);
+            gate = circuit.multiply(x, y);
+            break;
+        case GateKind::kElemMultiply:
+            y = circuit.input(1, dim, dim);
+            gate = circuit.elementMultiply(x, y);
+            break;
+        case GateKind::kMultiplyTrunc:
+            y = circuit.input(1, dim, dim);
+            gate = circuit.multiplyTrunc(x, y);
+            break;
+        case GateKind::kConv2D:
+            y = circuit.input(1, convOp().compute_kernel_size(), 1);
+            gate = circuit.conv2D(x, y, convOp());
+            break;
+        case GateKind::kAvgPool2D:
+            gate = circuit.avgPool2D(x, poolOp());
+            break;
+        case GateKind::kGtz:
+            gate = circuit.gtz(x);
+            break;
+    }
+    circuit.addEndpoint(circuit.output(gate));
+    return std::pair{x, y};
+}
+
+}
+
+
+#endif //BIOAUTH_GATE_ALLOCATIONS_CONFIG_H
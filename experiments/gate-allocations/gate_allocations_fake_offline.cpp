@@ -0,0 +1,29 @@
+
+#include "gate_allocations_config.h"
+
+#include "fake-offline/FakeCircuit.h"
+#include "share/Spdz2kShare.h"
+#include "fake-offline/FakeParty.h"
+#include <iostream>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gate_allocations;
+
+
+int main() {
+    using ShrType = Spdz2kShare64;
+
+    FakeParty<ShrType, 2> party(kJobName);
+
+    // The circuits are evaluated one after another, each for kNumSessions sessions
+    for (auto kind : kGateKinds) {
+        FakeCircuit<ShrType, 2> circuit(party);
+        buildCircuit(circuit, kind);
+        for (std::size_t session = 0; session < kNumSessions; ++session) {
+            circuit.runOffline();
+        }
+    }
+    std::cout << "Offline comm cost " << party.getTotalOfflineBytesWritten() << " bytes." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+
+#include "gate_allocations_config.h"
+#include "allocation_counter.h"
+
+#include "share/Spdz2kShare.h"
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include "utils/parallel_for.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gate_allocations;
+
+int main() {
+    using ShrType = Spdz2kShare64;
+    using ClearType = ShrType::ClearType;
+
+    PartyWithFakeOffline<ShrType> party(0, 2, 5050, kJobName);
+    setParallelThreads(kParallelThreads);
+    std::size_t baseline[3] = {0, 0, 0};
+
+    std::cout << std::left << std::setw(16) << "Gate" << std::right
+              << std::setw(20) << "first session" << std::setw(20) << "later sessions"
+              << std::setw(20) << "sent per session" << " (bytes per gate)\n";
+    for (auto kind : kGateKinds) {
+        Circuit<ShrType> circuit(party);
+        auto input = buildCircuit(circuit, kind).first;
+        std::vector<ClearType> values(input->dim_row() * input->dim_col());
+
+        // The bytes allocated by the online phase of the first session and on average by the later ones
+        std::size_t bytes[2] = {0, 0};
+        // The bytes sent by the online phase of the last session, the same in every session
+        std::size_t sent = 0;
+        for (std::size_t session = 0; session < kNumSessions; ++session) {
+            std::generate(values.begin(), values.end(), [] { return getRand<ClearType>(); });
+            input->setInput(values);
+            circuit.readOfflineFromFile();
+
+            auto before = allocatedBytes();
+            auto sent_before = party.bytes_sent();
+            circuit.runOnline();
+            auto allocated = allocatedBytes() - before;
+            sent = party.bytes_sent() - sent_before;
+            if (session == 0) bytes[0] = allocated;
+            else bytes[1] += allocated / (kNumSessions - 1);
+        }
+
+        if (kind == GateKind::kNone) {
+            baseline[0] = bytes[0];
+            baseline[1] = bytes[1];
+            baseline[2] = sent;
+        }
+        auto net = [](std::size_t total, std::size_t base) { return total > base ? total - base : 0; };
+        std::cout << std::left << std::setw(16) << gateName(kind) << std::right
+                  << std::setw(20) << (kind == GateKind::kNone ? bytes[0] : net(bytes[0], baseline[0]))
+                  << std::setw(20) << (kind == GateKind::kNone ? bytes[1] : net(bytes[1], baseline[1]))
+                  << std::setw(20) << (kind == GateKind::kNone ? sent : net(sent, baseline[2])) << "\n";
+    }
+    std::cout << "(no gate) is the circuit of one input and one output, which is subtracted from the others"
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+
+#include "gate_allocations_config.h"
+#include "allocation_counter.h"
+
+#include "share/Spdz2kShare.h"
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include "utils/parallel_for.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gate_allocations;
+
+int main() {
+    using ShrType = Spdz2kShare64;
+    using ClearType = ShrType::ClearType;
+
+    PartyWithFakeOffline<ShrType> party(1, 2, 5050, kJobName);
+    setParallelThreads(kParallelThreads);
+    std::size_t total_bytes = 0;
+
+    for (auto kind : kGateKinds) {
+        Circuit<ShrType> circuit(party);
+        auto input = buildCircuit(circuit, kind).second;
+        std::vector<ClearType> values(input ? input->dim_row() * input->dim_col() : 0);
+
+        for (std::size_t session = 0; session < kNumSessions; ++session) {
+            if (input) {
+                std::generate(values.begin(), values.end(), [] { return getRand<ClearType>(); });
+                input->setInput(values);
+            }
+            circuit.readOfflineFromFile();
+
+            auto before = allocatedBytes();
+            circuit.runOnline();
+            total_bytes += allocatedBytes() - before;
+        }
+    }
+    std::cout << "[Party 1] Allocated " << total_bytes << " bytes in the online phases" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "gemm_benchmark_config.h"
+
+#include "utils/gemm.h"
+#include "utils/parallel_for.h"
+#include "utils/linear_algebra.h"
+#include "utils/rand.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gemm_benchmark;
+
+
+// The average milliseconds of one product, repeated until kMinMultiplyAdds multiply-adds
+template <typename Product>
+double measure(const Shape& shape, const Product& product) {
+    auto multiply_adds = shape.dim_row * shape.dim_mid * shape.dim_col;
+    auto repetitions = std::max<std::size_t>(kMinMultiplyAdds / multiply_adds, 1);
+    product(); // warm up the caches and the packing buffers
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+        product();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(repetitions);
+}
+
+
+void printRow(const std::string& kernel, const Shape& shape, double milliseconds, double eigen_milliseconds,
+              bool correct) {
+    auto multiply_adds = static_cast<double>(shape.dim_row * shape.dim_mid * shape.dim_col);
+    std::cout << "  " << std::left << std::setw(20) << kernel << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << milliseconds << " ms" << std::setw(10) << multiply_adds / milliseconds / 1e6
+              << " GMAC/s" << std::setw(8) << std::setprecision(2) << eigen_milliseconds / milliseconds << "x"
+              << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+template <GemmElement T>
+void benchmark(const std::string& type_name, std::size_t num_threads) {
+    std::vector<std::size_t> thread_counts{1};
+    if (num_threads > 1) {
+        thread_counts.push_back(num_threads);
+    }
+    for (const auto& shape : kShapes) {
+        std::cout << type_name << ", " << shape.name << " (" << shape.dim_row << " x " << shape.dim_mid
+                  << " x " << shape.dim_col << ")\n";
+
+        std::vector<T> lhs(shape.dim_row * shape.dim_mid);
+        std::vector<T> rhs(shape.dim_mid * shape.dim_col);
+        std::generate(lhs.begin(), lhs.end(), [] { return getRand<T>(); });
+        std::generate(rhs.begin(), rhs.end(), [] { return getRand<T>(); });
+        std::vector<T> expected(shape.dim_row * shape.dim_col);
+        std::vector<T> output(shape.dim_row * shape.dim_col);
+
+        auto eigen_milliseconds = measure(shape, [&] {
+            auto matrix_output = matrixBlock(expected.data(), shape.dim_row, shape.dim_col, shape.dim_col);
+            matrix_output.noalias() = matrixBlock(lhs.data(), shape.dim_row, shape.dim_mid, shape.dim_mid)
+                                      * matrixBlock(rhs.data(), shape.dim_mid, shape.dim_col, shape.dim_col);
+        });
+        printRow("Eigen", shape, eigen_milliseconds, eigen_milliseconds, true);
+
+        for (auto isa : {GemmIsa::kScalar, GemmIsa::kAvx2, GemmIsa::kAvx512}) {
+            if (isa > supportedGemmIsa()) {
+                continue;
+            }
+            setGemmIsa(isa);
+            for (auto threads : thread_counts) {
+                setParallelThreads(threads);
+                std::fill(output.begin(), output.end(), T(0));
+                auto milliseconds = measure(shape, [&] {
+                    gemm(lhs.data(), shape.dim_mid, rhs.data(), shape.dim_col, output.data(), shape.dim_col,
+                         shape.dim_row, shape.dim_mid, shape.dim_col);
+                });
+                printRow(std::string(gemmIsaName(isa)) + ", " + std::to_string(threads) + " thread(s)", shape,
+                         milliseconds, eigen_milliseconds, output == expected);
+            }
+        }
+        setGemmIsa(supportedGemmIsa());
+        setParallelThreads(1);
+    }
+}
+
+
+int main() {
+    auto num_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::cout << "GEMM kernels of this CPU: " << gemmIsaName(supportedGemmIsa()) << ", " << num_threads
+              << " hardware thread(s)\n"
+              << "The last column is the speedup over Eigen\n";
+
+    benchmark<std::uint32_t>("Z_2^32", num_threads);
+    benchmark<std::uint64_t>("Z_2^64", num_threads);
+    benchmark<__uint128_t>("Z_2^128", num_threads);
+
+    return 0;
+}
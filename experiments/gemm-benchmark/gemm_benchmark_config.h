@@ -0,0 +1,37 @@
+#ifndef BIOAUTH_GEMM_BENCHMARK_CONFIG_H
+#define BIOAUTH_GEMM_BENCHMARK_CONFIG_H
+
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "../dot-product-db/dot_product_db_config.h"
+
+namespace bioauth::experiments::gemm_benchmark {
+
+using dot_product::dim;
+using dot_product::dbsize;
+
+struct Shape {
+    std::string name;
+    std::size_t dim_row;
+    std::size_t dim_mid;
+    std::size_t dim_col;
+};
+
+// The products of the dot-product-db experiment: the query with the database,
+// the query stacked with the Beaver operands of MultiplyGate, and a batch of queries
+const std::array<Shape, 4> kShapes = {{
+    {"query x db", 1, dim, dbsize},
+    {"stacked query x db", 3, dim, dbsize},
+    {"16 queries x db", 16, dim, dbsize},
+    {"db^T x db", dbsize, dim, dbsize},
+}};
+
+constexpr std::size_t kMinMultiplyAdds = std::size_t(1) << 28; // repeated until this many per measurement
+
+}
+
+
+#endif //BIOAUTH_GEMM_BENCHMARK_CONFIG_H
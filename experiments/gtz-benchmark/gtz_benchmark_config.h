@@ -0,0 +1,51 @@
+#ifndef BIOAUTH_GTZ_BENCHMARK_CONFIG_H
+#define BIOAUTH_GTZ_BENCHMARK_CONFIG_H
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "share/Spdz2kShare.h"
+
+// The online phase of GtzGate on one comparison per element of a dim x dbsize matrix,
+// the size of the products of experiments/dot-product-db, e.g., thresholding the scores of a database.
+// Run gtz_benchmark_fake_offline, then gtz_benchmark_party_0 and gtz_benchmark_party_1 side by side.
+// Party 0 owns the values and checks the revealed comparisons against them.
+// The MACs of the openings are checked, and party 0 also prints the time the online phase would take on the networks
+// below: the measured time plus a round trip per round and the bytes of a party at the bandwidth.
+// The comparisons are run once for each radix of the carry circuit, on the preprocessing of a circuit of their own,
+// and party 0 prints the radix that is the fastest on each network.
+// The offline phase prints the rate at which it generates the bit triples of the carry circuits.
+
+namespace bioauth::experiments::gtz_benchmark {
+
+using ShrType = Spdz2kShare64;
+
+const std::string kJobName = "GtzBenchmark";
+constexpr std::size_t dim = 1024;
+constexpr std::size_t dbsize = 512;
+// The bits compared, the fixed-point scores fit in about 40 bits, 64 compares the whole ring
+constexpr std::size_t num_bits = 40;
+// Radix 8 is left out: its groups take 494 products of masks each, whose MACs do not fit in memory at this size
+constexpr std::array<std::size_t, 2> kRadices{2, 4};
+
+struct NetworkProfile {
+    const char* name;
+    double rtt_ms;
+    double bandwidth_mbps;
+};
+
+// The networks of experiments/dot-product-db
+constexpr std::array<NetworkProfile, 3> kNetworks{{
+    {"LAN", 2, 1000},
+    {"MAN", 20, 100},
+    {"WAN", 100, 50},
+}};
+
+inline double modeledTimeMs(const NetworkProfile& network, double measured_ms, std::size_t rounds, std::size_t bytes) {
+    return measured_ms + rounds * network.rtt_ms + bytes * 8 / (network.bandwidth_mbps * 1000);
+}
+
+}
+
+#endif //BIOAUTH_GTZ_BENCHMARK_CONFIG_H
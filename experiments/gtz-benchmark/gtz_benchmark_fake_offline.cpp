@@ -0,0 +1,35 @@
+#include "gtz_benchmark_config.h"
+
+#include "fake-offline/FakeCircuit.h"
+#include "fake-offline/FakeParty.h"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gtz_benchmark;
+
+int main() {
+    FakeParty<ShrType, 2> party(kJobName);
+
+    // One circuit per radix, in the order in which the parties run them
+    for (auto radix : kRadices) {
+        FakeCircuit<ShrType, 2> circuit(party);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto x = circuit.input(0, dim, dbsize);
+        auto gtz = circuit.gtz(x, num_bits, radix);
+        auto z = circuit.output(gtz);
+        circuit.addEndpoint(z);
+        circuit.runOffline();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "Offline phase of " << dim * dbsize << " comparisons of radix " << radix << " took "
+                  << ms << " ms, " << gtz->num_triples() << " bit triples, "
+                  << static_cast<double>(gtz->num_triples()) * 1000 / std::max<decltype(ms)>(ms, 1) << " per second"
+                  << std::endl;
+    }
+
+    return 0;
+}
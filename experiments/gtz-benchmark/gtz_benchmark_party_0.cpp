@@ -0,0 +1,72 @@
+#include "gtz_benchmark_config.h"
+
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+using namespace bioauth;
+using namespace bioauth::experiments::gtz_benchmark;
+
+int main() {
+    using ClearType = ShrType::ClearType;
+    using SignedType = std::make_signed_t<ClearType>;
+
+    PartyWithFakeOffline<ShrType> party(0, 2, 5050, kJobName);
+
+    std::vector<ClearType> values(dim * dbsize);
+    // Random values of num_bits bits, sign-extended
+    std::ranges::generate(values, [] {
+        constexpr auto shift = sizeof(ClearType) * 8 - num_bits;
+        return ClearType(static_cast<SignedType>(getRand<ClearType>() << shift) >> shift);
+    });
+
+    std::array<double, kNetworks.size()> fastest_ms;
+    std::array<std::size_t, kNetworks.size()> fastest_radix{};
+    fastest_ms.fill(std::numeric_limits<double>::infinity());
+    for (auto radix : kRadices) {
+        Circuit<ShrType> circuit(party);
+
+        auto x = circuit.input(0, dim, dbsize);
+        auto z = circuit.output(circuit.gtz(x, num_bits, radix));
+        circuit.addEndpoint(z);
+        circuit.setMacCheck(true);
+        x->setInput(values);
+
+        circuit.readOfflineFromFile();
+        const auto bytes_before = party.bytes_sent();
+        circuit.runOnlineWithBenckmark();
+
+        const auto bytes = party.bytes_sent() - bytes_before;
+        const auto rounds = circuit.rounds() + circuit.mac_check_rounds();
+        std::cout << "Radix " << radix << ": spent " << circuit.timer().elapsed() << " ms, sent " << bytes
+                  << " bytes (" << static_cast<double>(bytes) / values.size() << " per comparison) in " << rounds
+                  << " rounds" << std::endl;
+        for (std::size_t i = 0; i < kNetworks.size(); ++i) {
+            const auto& network = kNetworks[i];
+            auto modeled_ms = modeledTimeMs(network, circuit.timer().elapsed(), rounds, bytes);
+            std::cout << "    " << network.name << " (RTT " << network.rtt_ms << " ms, " << network.bandwidth_mbps
+                      << " Mbps): " << modeled_ms << " ms" << std::endl;
+            if (modeled_ms < fastest_ms[i]) {
+                fastest_ms[i] = modeled_ms;
+                fastest_radix[i] = radix;
+            }
+        }
+
+        const auto& result = z->getClear();
+        std::size_t num_wrong = 0;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            num_wrong += result[i] != ClearType(static_cast<SignedType>(values[i]) >= 0);
+        }
+        std::cout << "    Compared " << values.size() << " values, " << num_wrong << " wrong" << std::endl;
+    }
+
+    for (std::size_t i = 0; i < kNetworks.size(); ++i) {
+        std::cout << "Fastest on " << kNetworks[i].name << ": radix " << fastest_radix[i] << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "gtz_benchmark_config.h"
+
+#include "protocols/Circuit.h"
+
+using namespace bioauth;
+using namespace bioauth::experiments::gtz_benchmark;
+
+int main() {
+    PartyWithFakeOffline<ShrType> party(1, 2, 5050, kJobName);
+
+    for (auto radix : kRadices) {
+        Circuit<ShrType> circuit(party);
+
+        auto x = circuit.input(0, dim, dbsize);
+        auto z = circuit.output(circuit.gtz(x, num_bits, radix));
+        circuit.addEndpoint(z);
+        circuit.setMacCheck(true);
+
+        circuit.readOfflineFromFile();
+        circuit.runOnlineWithBenckmark();
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "limb_benchmark_config.h"
+
+#include "utils/gemm.h"
+#include "utils/limb_arithmetic.h"
+#include "utils/rand.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <execution>
+#include <functional>
+
+using namespace bioauth;
+using namespace bioauth::experiments::limb_benchmark;
+
+
+// The average milliseconds of one operation over `size` elements, repeated until kMinElements elements
+template <typename Operation>
+double measure(std::size_t size, const Operation& operation) {
+    auto repetitions = std::max<std::size_t>(kMinElements / size, 1);
+    operation(); // warm up the caches
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+        operation();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(repetitions);
+}
+
+
+void printRow(const std::string& kernel, std::size_t size, double milliseconds, double baseline_milliseconds,
+              bool correct) {
+    std::cout << "    " << std::left << std::setw(16) << kernel << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << milliseconds << " ms" << std::setw(10) << std::setprecision(0)
+              << static_cast<double>(size) / milliseconds / 1e3 << " M elements/s" << std::setw(8)
+              << std::setprecision(2) << baseline_milliseconds / milliseconds << "x"
+              << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+using T = __uint128_t;
+
+struct Operation {
+    std::string name;
+    std::function<void(const std::vector<T>&, const std::vector<T>&, std::vector<T>&)> baseline;
+    std::function<void(const std::vector<T>&, const std::vector<T>&, std::vector<T>&)> kernel;
+};
+
+
+int main() {
+    std::cout << "Element-wise kernels over Z_2^128 of this CPU: " << gemmIsaName(supportedGemmIsa()) << "\n"
+              << "The baseline is std::transform over the 128-bit elements, the last column is the speedup over it\n";
+
+    const T scalar = getRand<T>();
+    const T mask = ~T(0) >> 64; // the upper bits of the shares of Spdz2kShare64
+
+    // The baselines are the element-wise operations of linear_algebra.h before the limb kernels
+    const std::vector<Operation> operations = {
+        {"add",
+         [](const auto& x, const auto& y, auto& output) {
+             std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), output.begin(), std::plus<T>());
+         },
+         [](const auto& x, const auto& y, auto& output) { limbAdd(x.data(), y.data(), output.data(), x.size()); }},
+        {"subtract",
+         [](const auto& x, const auto& y, auto& output) {
+             std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), output.begin(), std::minus<T>());
+         },
+         [](const auto& x, const auto& y, auto& output) {
+             limbSubtract(x.data(), y.data(), output.data(), x.size());
+         }},
+        {"scalar multiply",
+         [scalar](const auto& x, const auto&, auto& output) {
+             std::transform(std::execution::par_unseq, x.begin(), x.end(), output.begin(),
+                            [scalar](T value) { return scalar * value; });
+         },
+         [scalar](const auto& x, const auto&, auto& output) {
+             limbScalarMultiply(x.data(), scalar, output.data(), x.size());
+         }},
+        {"upper-bit mask",
+         [mask](const auto& x, const auto&, auto& output) {
+             std::transform(std::execution::par_unseq, x.begin(), x.end(), output.begin(),
+                            [mask](T value) { return value & mask; });
+         },
+         [mask](const auto& x, const auto&, auto& output) {
+             limbBitAnd(x.data(), mask, output.data(), x.size());
+         }},
+    };
+
+    for (const auto& size : kSizes) {
+        std::cout << size.name << " (" << size.num_elements * sizeof(T) / 1024 << " KB per vector)\n";
+        std::vector<T> x(size.num_elements);
+        std::vector<T> y(size.num_elements);
+        std::generate(x.begin(), x.end(), [] { return getRand<T>(); });
+        std::generate(y.begin(), y.end(), [] { return getRand<T>(); });
+        std::vector<T> expected(size.num_elements);
+        std::vector<T> output(size.num_elements);
+
+        for (const auto& operation : operations) {
+            std::cout << "  " << operation.name << "\n";
+            auto baseline_milliseconds = measure(size.num_elements, [&] { operation.baseline(x, y, expected); });
+            printRow("std::transform", size.num_elements, baseline_milliseconds, baseline_milliseconds, true);
+
+            for (auto isa : {GemmIsa::kScalar, GemmIsa::kAvx2, GemmIsa::kAvx512}) {
+                if (isa > supportedGemmIsa()) {
+                    continue;
+                }
+                setGemmIsa(isa);
+                std::fill(output.begin(), output.end(), T(0));
+                auto milliseconds = measure(size.num_elements, [&] { operation.kernel(x, y, output); });
+                printRow(gemmIsaName(isa), size.num_elements, milliseconds, baseline_milliseconds,
+                         output == expected);
+            }
+            setGemmIsa(supportedGemmIsa());
+        }
+    }
+
+    return 0;
+}
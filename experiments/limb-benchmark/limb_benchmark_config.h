@@ -0,0 +1,34 @@
+#ifndef BIOAUTH_LIMB_BENCHMARK_CONFIG_H
+#define BIOAUTH_LIMB_BENCHMARK_CONFIG_H
+
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "../dot-product-db/dot_product_db_config.h"
+
+namespace bioauth::experiments::limb_benchmark {
+
+using dot_product::dim;
+using dot_product::dbsize;
+
+struct Size {
+    std::string name;
+    std::size_t num_elements;
+};
+
+// The Delta of a small gate, which stays in the L1 and L2 caches, a larger one in the L3 cache,
+// and the database of the dot-product-db experiment, which is streamed from memory
+const std::array<Size, 3> kSizes = {{
+    {"4K elements", std::size_t(1) << 12},
+    {"64K elements", std::size_t(1) << 16},
+    {"database", dim * dbsize},
+}};
+
+constexpr std::size_t kMinElements = std::size_t(1) << 28; // repeated until this many per measurement
+
+}
+
+
+#endif //BIOAUTH_LIMB_BENCHMARK_CONFIG_H
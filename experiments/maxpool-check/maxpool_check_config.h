@@ -0,0 +1,52 @@
+#ifndef BIOAUTH_MAXPOOL_CHECK_CONFIG_H
+#define BIOAUTH_MAXPOOL_CHECK_CONFIG_H
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "share/Spdz2kShare.h"
+#include "utils/tensor.h"
+
+// Checks MaxPool2DGate against a plaintext max pooling, on the poolings below: windows of an odd number of elements,
+// several images of several channels per batch, and strides other than the kernel, overlapping or skipping elements.
+// Run maxpool_check_fake_offline, then maxpool_check_party_0 and maxpool_check_party_1 side by side.
+// Party 0 owns the images, the MACs of the openings are checked and party 0 prints the number of wrong maxima.
+// The poolings are run over Z_2^64 and over Z_2^40, whose public values are packed into 5 bytes on the wire.
+
+namespace bioauth::experiments::maxpool_check {
+
+using ShrType = Spdz2kShare64;
+using PackedShrType = Spdz2kShare<40, 40>;
+
+const std::string kJobName = "MaxPoolCheck";
+const std::string kPackedJobName = "MaxPoolCheck40";
+constexpr std::size_t kPort = 5050;
+constexpr std::size_t kPackedPort = 5060;
+// The values are drawn from a small range, so that the windows hold ties, around zero, so that they hold both signs
+constexpr std::size_t kValueRange = 64;
+
+inline MaxPoolOp makeMaxPoolOp(std::array<std::size_t, 3> input_shape, std::array<std::size_t, 2> kernel_shape,
+                               std::array<std::size_t, 2> strides, std::size_t batch_size) {
+    MaxPoolOp op{};
+    op.input_shape_ = input_shape;
+    op.kernel_shape_ = kernel_shape;
+    op.strides_ = strides;
+    op.batch_size_ = batch_size;
+    op.output_shape_ = op.compute_output_shape();
+    return op;
+}
+
+// Each pooling is run by a circuit of its own, in this order
+inline std::array<MaxPoolOp, 4> maxPoolOps() {
+    return {
+        makeMaxPoolOp({3, 9, 9}, {3, 3}, {2, 2}, 2), // 9 elements per window, overlapping
+        makeMaxPoolOp({2, 5, 5}, {2, 2}, {1, 1}, 3), // 4 elements per window, overlapping
+        makeMaxPoolOp({1, 7, 8}, {3, 1}, {2, 3}, 2), // 3 elements per window, skipping columns
+        makeMaxPoolOp({2, 11, 11}, {5, 5}, {3, 3}, 2), // 25 elements per window, a deep tournament
+    };
+}
+
+}
+
+#endif //BIOAUTH_MAXPOOL_CHECK_CONFIG_H
@@ -0,0 +1,32 @@
+#include "maxpool_check_config.h"
+
+#include "fake-offline/FakeCircuit.h"
+#include "fake-offline/FakeParty.h"
+
+using namespace bioauth;
+using namespace bioauth::experiments::maxpool_check;
+
+namespace {
+
+template <IsSpdz2kShare ShrType>
+void runOffline(const std::string& job_name) {
+    FakeParty<ShrType, 2> party(job_name);
+
+    for (const auto& op : maxPoolOps()) {
+        FakeCircuit<ShrType, 2> circuit(party);
+
+        auto x = circuit.input(0, op.compute_input_size(), 1);
+        auto z = circuit.output(circuit.maxPool2D(x, op));
+        circuit.addEndpoint(z);
+        circuit.runOffline();
+    }
+}
+
+}
+
+int main() {
+    runOffline<ShrType>(kJobName);
+    runOffline<PackedShrType>(kPackedJobName);
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "maxpool_check_config.h"
+
+#include "protocols/Circuit.h"
+#include "utils/rand.h"
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+using namespace bioauth;
+using namespace bioauth::experiments::maxpool_check;
+
+namespace {
+
+// The maximum of each window, read from the images directly
+template <typename ClearType>
+std::vector<ClearType> plainMaxPool(const std::vector<ClearType>& input, const MaxPoolOp& op) {
+    using SignedType = std::make_signed_t<ClearType>;
+
+    const auto num_images = op.batch_size_ * op.input_shape_[0];
+    const auto [in_rows, in_columns] = std::pair(op.input_shape_[1], op.input_shape_[2]);
+    const auto [out_rows, out_columns] = std::pair(op.output_shape_[1], op.output_shape_[2]);
+    std::vector<ClearType> output;
+    output.reserve(op.compute_output_size());
+    for (std::size_t image = 0; image < num_images; ++image) {
+        const auto* pixels = input.data() + image * in_rows * in_columns;
+        for (std::size_t out_row = 0; out_row < out_rows; ++out_row) {
+            for (std::size_t out_column = 0; out_column < out_columns; ++out_column) {
+                auto max = std::numeric_limits<SignedType>::min();
+                for (std::size_t row = 0; row < op.kernel_shape_[0]; ++row) {
+                    for (std::size_t column = 0; column < op.kernel_shape_[1]; ++column) {
+                        const auto index = (out_row * op.strides_[0] + row) * in_columns
+                                           + out_column * op.strides_[1] + column;
+                        max = std::max(max, static_cast<SignedType>(pixels[index]));
+                    }
+                }
+                output.push_back(static_cast<ClearType>(max));
+            }
+        }
+    }
+    return output;
+}
+
+// Returns the number of wrong maxima
+template <IsSpdz2kShare ShrType>
+std::size_t runOnline(const std::string& job_name, std::size_t port) {
+    using ClearType = typename ShrType::ClearType;
+    using SemiShrType = typename ShrType::SemiShrType;
+    using SignedType = std::make_signed_t<ClearType>;
+
+    PartyWithFakeOffline<ShrType> party(0, 2, port, job_name);
+
+    std::cout << "Z_2^" << ShrType::kBits << std::endl;
+    std::size_t total_wrong = 0;
+    for (const auto& op : maxPoolOps()) {
+        Circuit<ShrType> circuit(party);
+
+        auto x = circuit.input(0, op.compute_input_size(), 1);
+        auto z = circuit.output(circuit.maxPool2D(x, op));
+        circuit.addEndpoint(z);
+        circuit.setMacCheck(true);
+
+        std::vector<ClearType> images(op.compute_input_size());
+        std::ranges::generate(images, [] {
+            return static_cast<ClearType>(static_cast<SignedType>(getRand<ClearType>() % kValueRange)
+                                          - static_cast<SignedType>(kValueRange / 2));
+        });
+        x->setInput(images);
+
+        circuit.readOfflineFromFile();
+        circuit.runOnline();
+
+        const auto expected = plainMaxPool(images, op);
+        const auto& result = z->getClear();
+        std::size_t num_wrong = 0;
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            num_wrong += result[i] != ShrType::ToClear(static_cast<SemiShrType>(expected[i]));
+        }
+        total_wrong += num_wrong;
+        std::cout << "Batch of " << op.batch_size_ << " x " << op.input_shape_[0] << " x " << op.input_shape_[1]
+                  << " x " << op.input_shape_[2] << ", kernel " << op.kernel_shape_[0] << " x "
+                  << op.kernel_shape_[1] << ", strides " << op.strides_[0] << " x " << op.strides_[1] << ": "
+                  << expected.size() << " maxima, " << num_wrong << " wrong" << std::endl;
+    }
+    return total_wrong;
+}
+
+}
+
+int main() {
+    auto total_wrong = runOnline<ShrType>(kJobName, kPort);
+    total_wrong += runOnline<PackedShrType>(kPackedJobName, kPackedPort);
+
+    std::cout << (total_wrong == 0 ? "All maxima match the plaintext max pooling" : "Some maxima are wrong")
+              << std::endl;
+
+    return total_wrong != 0;
+}
@@ -0,0 +1,34 @@
+#include "maxpool_check_config.h"
+
+#include "protocols/Circuit.h"
+
+using namespace bioauth;
+using namespace bioauth::experiments::maxpool_check;
+
+namespace {
+
+template <IsSpdz2kShare ShrType>
+void runOnline(const std::string& job_name, std::size_t port) {
+    PartyWithFakeOffline<ShrType> party(1, 2, port, job_name);
+
+    for (const auto& op : maxPoolOps()) {
+        Circuit<ShrType> circuit(party);
+
+        auto x = circuit.input(0, op.compute_input_size(), 1);
+        auto z = circuit.output(circuit.maxPool2D(x, op));
+        circuit.addEndpoint(z);
+        circuit.setMacCheck(true);
+
+        circuit.readOfflineFromFile();
+        circuit.runOnline();
+    }
+}
+
+}
+
+int main() {
+    runOnline<ShrType>(kJobName, kPort);
+    runOnline<PackedShrType>(kPackedJobName, kPackedPort);
+
+    return 0;
+}
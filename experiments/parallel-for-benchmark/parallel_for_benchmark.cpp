@@ -0,0 +1,152 @@
+#include "parallel_for_benchmark_config.h"
+
+#include "utils/linear_algebra.h"
+#include "utils/parallel_for.h"
+#include "utils/rand.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <cstdint>
+
+using namespace bioauth;
+using namespace bioauth::experiments::parallel_for_benchmark;
+
+
+// The average microseconds of one operation over `size` elements, repeated until kMinElements elements
+template <typename Operation>
+double measure(std::size_t size, const Operation& operation) {
+    auto repetitions = std::max<std::size_t>(kMinElements / size, 1);
+    operation(); // warm up the caches
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+        operation();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(repetitions);
+}
+
+
+void printRow(const std::string& implementation, std::size_t size, double microseconds,
+              double baseline_microseconds, bool correct) {
+    std::cout << "      " << std::left << std::setw(16) << implementation << std::right << std::fixed
+              << std::setprecision(2) << std::setw(12) << microseconds << " us" << std::setw(10)
+              << std::setprecision(0) << static_cast<double>(size) / microseconds << " M elements/s" << std::setw(8)
+              << std::setprecision(2) << baseline_microseconds / microseconds << "x"
+              << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+// The operations of linear_algebra.h, each with its implementation before parallel_for.h as the baseline
+template <typename T>
+struct Operation {
+    std::string name;
+    std::function<void(const std::vector<std::vector<T>>&, std::vector<T>&)> baseline;
+    std::function<void(const std::vector<std::vector<T>>&, std::vector<T>&)> operation;
+};
+
+
+template <typename T>
+std::vector<Operation<T>> operations() {
+    const T scalar = getRand<T>();
+    const std::vector<T> coefficients = {T(1), T(-1), T(1), scalar};
+
+    return {
+        {"add",
+         [](const auto& inputs, auto& output) {
+             std::transform(std::execution::par_unseq, inputs[0].begin(), inputs[0].end(), inputs[1].begin(),
+                            output.begin(), std::plus<T>());
+         },
+         [](const auto& inputs, auto& output) { matrixAdd(inputs[0], inputs[1], output); }},
+        {"scalar multiply",
+         [scalar](const auto& inputs, auto& output) {
+             // matrixScalar() returns a new vector
+             output = std::vector<T>(inputs[0].size());
+             std::transform(std::execution::par_unseq, inputs[0].begin(), inputs[0].end(), output.begin(),
+                            [scalar](T value) { return scalar * value; });
+         },
+         [scalar](const auto& inputs, auto& output) { output = matrixScalar(inputs[0], scalar); }},
+        {"linear combination",
+         [coefficients](const auto& inputs, auto& output) {
+             std::for_each(std::execution::par_unseq, output.begin(), output.end(),
+                           [&inputs, &coefficients, data = output.data()](T& element) {
+                 auto idx = &element - data;
+                 T acc = 0;
+                 for (std::size_t j = 0; j < inputs.size(); ++j) {
+                     if (coefficients[j] == T(1)) acc += inputs[j][idx];
+                     else if (coefficients[j] == T(-1)) acc -= inputs[j][idx];
+                     else acc += coefficients[j] * inputs[j][idx];
+                 }
+                 element = acc;
+             });
+         },
+         [coefficients](const auto& inputs, auto& output) {
+             std::vector<const std::vector<T>*> input_ptrs;
+             for (const auto& input : inputs) input_ptrs.push_back(&input);
+             matrixLinearCombination(input_ptrs, coefficients, T(0), output);
+         }},
+    };
+}
+
+
+template <typename T>
+void benchmark(const std::string& type_name, std::size_t num_threads) {
+    std::cout << type_name << "\n";
+    for (auto size : kSizes) {
+        std::cout << "  " << size << " elements (" << size * sizeof(T) / 1024 << " KB per vector)\n";
+        std::vector<std::vector<T>> inputs(kNumInputs, std::vector<T>(size));
+        for (auto& input : inputs) {
+            std::generate(input.begin(), input.end(), [] { return getRand<T>(); });
+        }
+        std::vector<T> expected(size);
+        std::vector<T> output(size);
+
+        for (const auto& operation : operations<T>()) {
+            std::cout << "    " << operation.name << "\n";
+            auto baseline_microseconds = measure(size, [&] { operation.baseline(inputs, expected); });
+            printRow("par_unseq", size, baseline_microseconds, baseline_microseconds, true);
+
+            for (auto threads : {std::size_t(1), num_threads}) {
+                setParallelThreads(threads);
+                std::fill(output.begin(), output.end(), T(0));
+                auto microseconds = measure(size, [&] { operation.operation(inputs, output); });
+                printRow("parallelFor x" + std::to_string(threads), size, microseconds, baseline_microseconds,
+                         output == expected);
+            }
+        }
+    }
+}
+
+
+int main() {
+    auto num_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+    std::cout << "Element-wise operations with " << std::thread::hardware_concurrency() << " hardware threads\n"
+              << "The baseline is std::execution::par_unseq, the last column is the speedup over it\n";
+
+    // The cost of waking up the pool for a loop, which the parts of a loop must outweigh
+    setParallelThreads(num_threads);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t loop = 0; loop < kWakeUps; ++loop) {
+        parallelForTasks(num_threads, [](std::size_t) {});
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    auto wake_up_microseconds = elapsed.count() / kWakeUps;
+
+    std::vector<std::uint64_t> x(kMinTaskBytes / sizeof(std::uint64_t)), y(x.size()), sum(x.size());
+    setParallelThreads(1);
+    auto task_microseconds = measure(x.size(), [&] { matrixAdd(x, y, sum); });
+    std::cout << "Waking up " << num_threads << " threads: " << std::fixed << std::setprecision(2)
+              << wake_up_microseconds << " us, adding a part of " << (kMinTaskBytes >> 10)
+              << " KB of 64-bit elements: " << task_microseconds << " us\n";
+
+    benchmark<std::uint64_t>("Z_2^64 (the shares of Spdz2kShare32)", num_threads);
+    benchmark<__uint128_t>("Z_2^128 (the shares of Spdz2kShare64)", num_threads);
+    setParallelThreads(1);
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef BIOAUTH_PARALLEL_FOR_BENCHMARK_CONFIG_H
+#define BIOAUTH_PARALLEL_FOR_BENCHMARK_CONFIG_H
+
+
+#include <array>
+#include <cstddef>
+
+namespace bioauth::experiments::parallel_for_benchmark {
+
+// From the Delta of a single gate of a small circuit to the database of the dot-product-db experiment
+constexpr std::array<std::size_t, 6> kSizes = {
+    std::size_t(1) << 8, std::size_t(1) << 11, std::size_t(1) << 14,
+    std::size_t(1) << 17, std::size_t(1) << 20, std::size_t(1) << 22,
+};
+
+constexpr std::size_t kNumInputs = 4;                       // the inputs of the linear combination
+constexpr std::size_t kMinElements = std::size_t(1) << 27; // repeated until this many per measurement
+constexpr std::size_t kWakeUps = 10000;                     // the loops timed for the cost of waking up the pool
+
+}
+
+
+#endif //BIOAUTH_PARALLEL_FOR_BENCHMARK_CONFIG_H
@@ -0,0 +1,98 @@
+#include "strassen_benchmark_config.h"
+
+#include "utils/gemm.h"
+#include "utils/strassen.h"
+#include "utils/linear_algebra.h"
+#include "utils/parallel_for.h"
+#include "utils/rand.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace bioauth;
+using namespace bioauth::experiments::strassen_benchmark;
+
+
+// The average milliseconds of one product, repeated until kMinMultiplyAdds multiply-adds
+template <typename Product>
+double measure(const Shape& shape, const Product& product) {
+    auto multiply_adds = shape.dim_row * shape.dim_mid * shape.dim_col;
+    auto repetitions = std::max<std::size_t>(kMinMultiplyAdds / multiply_adds, 1);
+    product(); // warm up the caches and the packing buffers
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+        product();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(repetitions);
+}
+
+
+// The GEMM alone, a single level of Strassen-Winograd over it, and matrixMultiply(), which picks the levels by shape
+template <GemmElement T>
+void benchmarkShape(const Shape& shape) {
+    std::vector<T> lhs(shape.dim_row * shape.dim_mid);
+    std::vector<T> rhs(shape.dim_mid * shape.dim_col);
+    std::generate(lhs.begin(), lhs.end(), [] { return getRand<T>(); });
+    std::generate(rhs.begin(), rhs.end(), [] { return getRand<T>(); });
+    std::vector<T> expected(shape.dim_row * shape.dim_col);
+    std::vector<T> one_level(expected.size());
+    std::vector<T> output(expected.size());
+
+    auto gemm_milliseconds = measure(shape, [&] {
+        gemm(lhs.data(), shape.dim_mid, rhs.data(), shape.dim_col, expected.data(), shape.dim_col,
+             shape.dim_row, shape.dim_mid, shape.dim_col);
+    });
+    // The cutoff of a single level is the smallest dimension, so that the products of the blocks go to the GEMM
+    auto min_dim = std::min({shape.dim_row, shape.dim_mid, shape.dim_col});
+    auto one_level_milliseconds = measure(shape, [&] {
+        strassenGemm(lhs.data(), shape.dim_mid, rhs.data(), shape.dim_col, one_level.data(), shape.dim_col,
+                     shape.dim_row, shape.dim_mid, shape.dim_col, min_dim);
+    });
+    auto milliseconds = measure(shape, [&] {
+        matrixMultiply(lhs.data(), rhs.data(), output.data(), shape.dim_row, shape.dim_mid, shape.dim_col);
+    });
+
+    bool correct = one_level == expected && output == expected;
+    bool strassen = isStrassenProduct<T>(shape.dim_row, shape.dim_mid, shape.dim_col);
+    std::cout << "  " << std::left << std::setw(18) << shape.name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << gemm_milliseconds << std::setw(12) << one_level_milliseconds
+              << std::setprecision(2) << std::setw(8) << gemm_milliseconds / one_level_milliseconds << "x"
+              << std::setprecision(3) << std::setw(12) << milliseconds << std::setprecision(2) << std::setw(8)
+              << gemm_milliseconds / milliseconds << "x" << (strassen ? "  Strassen" : "  GEMM")
+              << (correct ? "" : "  WRONG RESULT") << "\n";
+}
+
+
+template <GemmElement T>
+void benchmark(const std::string& type_name) {
+    std::cout << type_name << ", cutoff " << kStrassenCutoff<T> << "\n  " << std::left << std::setw(18) << "shape"
+              << std::right << std::setw(12) << "GEMM ms" << std::setw(12) << "1 level ms" << std::setw(9)
+              << "speedup" << std::setw(12) << "auto ms" << std::setw(9) << "speedup" << "  path\n";
+    for (auto size : kSizes) {
+        benchmarkShape<T>({std::to_string(size) + "^3", size, size, size});
+    }
+    for (const auto& shape : kShapes) {
+        benchmarkShape<T>(shape);
+    }
+}
+
+
+int main() {
+    setParallelThreads(std::thread::hardware_concurrency());
+    std::cout << "Strassen-Winograd over the " << gemmIsaName(gemmIsa()) << " GEMM on " << parallelThreads()
+              << " thread(s)\n"
+              << "1 level: the GEMM computes the 7 products of the blocks, "
+              << "it beats the GEMM alone from the crossover on (speedup > 1)\n"
+              << "auto: matrixMultiply(), which splits the products whose dimensions reach the cutoff\n";
+
+    benchmark<std::uint32_t>("Z_2^32");
+    benchmark<std::uint64_t>("Z_2^64");
+    benchmark<__uint128_t>("Z_2^128");
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef BIOAUTH_STRASSEN_BENCHMARK_CONFIG_H
+#define BIOAUTH_STRASSEN_BENCHMARK_CONFIG_H
+
+
+#include <array>
+#include <string>
+#include <cstddef>
+
+#include "../dot-product-db/dot_product_db_config.h"
+
+namespace bioauth::experiments::strassen_benchmark {
+
+using dot_product::dim;
+using dot_product::dbsize;
+
+// The square products around the cutoffs of kStrassenCutoff
+constexpr std::array<std::size_t, 9> kSizes = {128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+
+struct Shape {
+    std::string name;
+    std::size_t dim_row;
+    std::size_t dim_mid;
+    std::size_t dim_col;
+};
+
+// Batches of probes scored against the database of the dot-product-db experiment,
+// stacked with the Beaver operands as MultiplyGate multiplies them
+const std::array<Shape, 3> kShapes = {{
+    {"64 probes x db", 3 * 64, dim, dbsize},
+    {"256 probes x db", 3 * 256, dim, dbsize},
+    {"1024 probes x db", 3 * 1024, dim, dbsize},
+}};
+
+constexpr std::size_t kMinMultiplyAdds = std::size_t(1) << 30; // repeated until this many per measurement
+
+}
+
+
+#endif //BIOAUTH_STRASSEN_BENCHMARK_CONFIG_H
@@ -44,9 +44,8 @@ FakeAddGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x,
 
 template <IsSpdz2kShare ShrType, std::size_t N>
 void FakeAddGate<ShrType, N>::doRunOffline() {
-    auto size = this->dim_row() * this->dim_col();
-
     // $[\lambda_z] = [\lambda_x] + [\lambda_y]$
+    this->lambda_clear() = matrixAdd(this->input_x()->lambda_clear(), this->input_y()->lambda_clear());
     for (std::size_t party_idx = 0; party_idx < N; ++party_idx) {
         this->lambda_shr()[party_idx] = matrixAdd(this->input_x()->lambda_shr()[party_idx],
                                                   this->input_y()->lambda_shr()[party_idx]);
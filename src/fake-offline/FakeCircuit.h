@@ -8,6 +8,7 @@
 #include <vector>
 #include <cstddef> 
 #include "share/IsSpdz2kShare.h"
+#include "utils/ExecutionPlan.h"
 #include "fake-offline/FakeParty.h"
 #include "fake-offline/FakeGate.h"
 #include "fake-offline/FakeInputGate.h"
@@ -21,6 +22,7 @@
 #include "fake-offline/FakeConv2DGate.h"
 #include "fake-offline/FakeConv2DTruncGate.h"
 #include "fake-offline/FakeAvgPool2DGate.h"
+#include "fake-offline/FakeMaxPool2DGate.h"
 #include "fake-offline/FakeGtzGate.h"
 #include "fake-offline/FakeReLUGate.h"
 #include <map>
@@ -40,6 +42,9 @@ public:
 
     explicit FakeCircuit(FakeParty<ShrType, N>& p_fake_party) : fake_party_(p_fake_party) {}
 
+    ~FakeCircuit();
+
+    /// Generates the preprocessing data of one session, call it again for each further session
     void runOffline();
 
     void addEndpoint(const std::shared_ptr<FakeGate<ShrType, N>>& gate);
@@ -88,8 +93,13 @@ public:
     avgPool2D(const std::shared_ptr<FakeGate<ShrType, N>>& input_x,
               const MaxPoolOp& op);
 
+    std::shared_ptr<FakeMaxPool2DGate<ShrType, N>>
+    maxPool2D(const std::shared_ptr<FakeGate<ShrType, N>>& input_x,
+              const MaxPoolOp& op);
+
     std::shared_ptr<FakeGtzGate<ShrType, N>>
-    gtz(const std::shared_ptr<FakeGate<ShrType, N>>& input_x);
+    gtz(const std::shared_ptr<FakeGate<ShrType, N>>& input_x,
+        std::size_t num_bits = FakeGtzGate<ShrType, N>::kMaxBits, std::size_t radix = 2);
 
     std::shared_ptr<FakeReLUGate<ShrType, N>>
     relu(const std::shared_ptr<FakeGate<ShrType, N>>& input_x);
@@ -101,17 +111,35 @@ private:
     std::vector<std::shared_ptr<FakeGate<ShrType, N>>> gates_;
     std::vector<std::shared_ptr<FakeGate<ShrType, N>>> endpoints_;
     std::map<std::string, int> gate_type_count_;
+
+    // Must visit the gates in the same order as the execution plan of the online circuit,
+    // since the preprocessing data are read back in that order
+    ExecutionPlan<FakeGate<ShrType, N>> plan_;
+    bool plan_outdated_ = true; // a new gate can only become reachable through a new endpoint
 };
 
 
+template <IsSpdz2kShare ShrType, std::size_t N>
+FakeCircuit<ShrType, N>::~FakeCircuit() {
+    // Release the newest gate first, see Circuit::~Circuit()
+    endpoints_.clear();
+    while (!gates_.empty()) {
+        gates_.pop_back();
+    }
+}
+
 template <IsSpdz2kShare ShrType, std::size_t N>
 void FakeCircuit<ShrType, N>::
 runOffline() {
     using namespace std::chrono;
     auto start = high_resolution_clock::now();
 
-    for (const auto& gatePtr : endpoints_) {
-        gatePtr->runOffline();
+    if (plan_outdated_) {
+        plan_.Build(gates_, endpoints_);
+        plan_outdated_ = false;
+    }
+    for (const auto& node : plan_) {
+        node.gate->runOffline();
     }
 
     auto end = high_resolution_clock::now();
@@ -132,6 +160,7 @@ template <IsSpdz2kShare ShrType, std::size_t N>
 void FakeCircuit<ShrType, N>::
 addEndpoint(const std::shared_ptr<FakeGate<ShrType, N>>& gate) {
     endpoints_.push_back(gate);
+    plan_outdated_ = true;
 }
 
 template <IsSpdz2kShare ShrType, std::size_t N>
@@ -245,10 +274,20 @@ avgPool2D(const std::shared_ptr<FakeGate<ShrType, N>>& input_x,
     return gate;
 }
 
+template <IsSpdz2kShare ShrType, std::size_t N>
+std::shared_ptr<FakeMaxPool2DGate<ShrType, N>> FakeCircuit<ShrType, N>::
+maxPool2D(const std::shared_ptr<FakeGate<ShrType, N>>& input_x,
+          const MaxPoolOp& op) {
+    auto gate = std::make_shared<FakeMaxPool2DGate<ShrType, N>>(input_x, op);
+    gates_.push_back(gate);
+    gate_type_count_[typeid(*gate).name()]++;
+    return gate;
+}
+
 template <IsSpdz2kShare ShrType, std::size_t N>
 std::shared_ptr<FakeGtzGate<ShrType, N>> FakeCircuit<ShrType, N>::
-gtz(const std::shared_ptr<FakeGate<ShrType, N>>& input_x) {
-    auto gate = std::make_shared<FakeGtzGate<ShrType, N>>(input_x);
+gtz(const std::shared_ptr<FakeGate<ShrType, N>>& input_x, std::size_t num_bits, std::size_t radix) {
+    auto gate = std::make_shared<FakeGtzGate<ShrType, N>>(input_x, num_bits, radix);
     gates_.push_back(gate);
     gate_type_count_[typeid(*gate).name()]++;
     return gate;
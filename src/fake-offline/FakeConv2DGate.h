@@ -24,8 +24,9 @@ public:
     using ClearType = typename ShrType::ClearType;
 
     /// @brief
-    /// @param p_input_x: The input tensor
-    /// @param p_input_y: The kernel tensor
+    /// @param p_input_x: The input tensor, the images of the batch of `op` one after the other
+    /// @param p_input_y: The kernel tensor, shared by the images of the batch
+    /// @param op: The convolution
     FakeConv2DGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x,
                    const std::shared_ptr<FakeGate<ShrType, N>>& p_input_y,
                    const Conv2DOp& op);
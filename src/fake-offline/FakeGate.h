@@ -29,6 +29,7 @@ public:
 
     virtual ~FakeGate() = default;
 
+    // Only processes this gate, the inputs must have been processed before (see ExecutionPlan)
     void runOffline();
 
     // [[nodiscard]] bool isEvaluatedOffline() const { return evaluated_offline_; }
@@ -60,10 +61,6 @@ protected:
 private:
     virtual void doRunOffline() = 0;
 
-    // Since circuit evaluation is done in a recursive manner,
-    // we need to keep track of whether the gate has been evaluated
-    bool evaluated_offline_ = false;
-
     FakeParty<ShrType, N>& fake_party_;
 
     // The inputs wires of the gate
@@ -88,17 +85,7 @@ private:
 
 template <IsSpdz2kShare ShrType, std::size_t N>
 void FakeGate<ShrType, N>::runOffline() {
-    if (this->evaluated_offline_)
-        return;
-
-    if (input_x_ && !input_x_->evaluated_offline_)
-        input_x_->runOffline();
-    if (input_y_ && !input_y_->evaluated_offline_)
-        input_y_->runOffline();
-
     this->doRunOffline();
-
-    this->evaluated_offline_ = true;
 }
 
 } // namespace bioauth
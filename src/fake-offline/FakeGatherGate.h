@@ -0,0 +1,72 @@
+#ifndef BIOAUTH_FAKEGATHERGATE_H
+#define BIOAUTH_FAKEGATHERGATE_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "utils/linear_algebra.h"
+#include "share/IsSpdz2kShare.h"
+#include "fake-offline/FakeGate.h"
+
+
+namespace bioauth {
+
+/// @brief Fake offline gather gate, see GatherGate. It writes nothing, since lambda is rearranged from the inputs.
+template <IsSpdz2kShare ShrType, std::size_t N>
+class FakeGatherGate : public FakeGate<ShrType, N> {
+public:
+    using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
+
+    FakeGatherGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, std::vector<std::size_t> x_index,
+                   const std::shared_ptr<FakeGate<ShrType, N>>& p_input_y = nullptr,
+                   std::vector<std::size_t> y_index = {}, bool subtract = false);
+
+private:
+    void doRunOffline() override;
+
+    std::vector<std::size_t> x_index_, y_index_;
+    bool subtract_;
+};
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+FakeGatherGate<ShrType, N>::
+FakeGatherGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, std::vector<std::size_t> x_index,
+               const std::shared_ptr<FakeGate<ShrType, N>>& p_input_y, std::vector<std::size_t> y_index,
+               bool subtract)
+    : FakeGate<ShrType, N>(p_input_x, p_input_y), x_index_(std::move(x_index)), y_index_(std::move(y_index)),
+      subtract_(subtract) {
+    if (!p_input_y) {
+        y_index_.assign(x_index_.size(), kNoIndex);
+    }
+    if (y_index_.size() != x_index_.size()) {
+        throw std::invalid_argument("The indices of gather gate should have the same size");
+    }
+    this->set_dim_row(x_index_.size());
+    this->set_dim_col(1);
+}
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+void FakeGatherGate<ShrType, N>::doRunOffline() {
+    const auto& input_y = this->input_y();
+    std::vector<ClearType> no_input_clear;
+    std::vector<SemiShrType> no_input_shr;
+
+    // $\lambda_z = \lambda_x$ rearranged (plus or minus $\lambda_y$), likewise for the shares and their MACs
+    matrixGather(this->input_x()->lambda_clear(), x_index_, input_y ? input_y->lambda_clear() : no_input_clear,
+                 y_index_, subtract_, this->lambda_clear());
+    for (std::size_t party_idx = 0; party_idx < N; ++party_idx) {
+        matrixGather(this->input_x()->lambda_shr()[party_idx], x_index_,
+                     input_y ? input_y->lambda_shr()[party_idx] : no_input_shr, y_index_, subtract_,
+                     this->lambda_shr()[party_idx]);
+        matrixGather(this->input_x()->lambda_shr_mac()[party_idx], x_index_,
+                     input_y ? input_y->lambda_shr_mac()[party_idx] : no_input_shr, y_index_, subtract_,
+                     this->lambda_shr_mac()[party_idx]);
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_FAKEGATHERGATE_H
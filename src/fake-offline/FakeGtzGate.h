@@ -4,9 +4,15 @@
 
 #include <memory>
 #include <array>
+#include <vector>
+#include <cstdint>
 #include <algorithm>
+#include <stdexcept>
+#include <bit>
 
 #include "utils/rand.h"
+#include "utils/bit_slicing.h"
+#include "utils/carry_circuit.h"
 #include "share/IsSpdz2kShare.h"
 #include "fake-offline/FakeGate.h"
 
@@ -19,17 +25,41 @@ public:
     using ClearType = typename ShrType::ClearType;
     using SemiShrType = typename ShrType::SemiShrType;
 
-    explicit FakeGtzGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x);
+    static constexpr std::size_t kMaxBits = ShrType::kBits; // the sign of a value of Z_2^K is bit K - 1
+    static constexpr std::size_t kMaxRadix = 8;
+
+    /// The preprocessing of a GtzGate that compares the lower num_bits bits by a carry circuit of the radix,
+    /// including the bit triples of the carry circuit, or the multi-input triples of a higher radix, and the daBits
+    /// that mask the result
+    explicit FakeGtzGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, std::size_t num_bits = kMaxBits,
+                         std::size_t radix = 2);
+
+    /// The bit triples generated for all the comparisons, counting each product of masks of a multi-input triple as one
+    [[nodiscard]] std::size_t num_triples() const { return num_triples_; }
 
 private:
     static std::array<ClearType, N> generateBooleanShares(ClearType x);
     void doRunOffline() override;
+
+    // The triples of a pair, or a group of t bits, bit-sliced in the planes of carry_circuit.h
+    void generatePairTriples(std::vector<uint64_t>& planes, std::size_t num_words) const;
+    void generateGroupTriple(std::size_t t, std::vector<uint64_t>& planes, std::size_t num_words) const;
+
+    std::size_t num_bits_;
+    std::size_t radix_;
+    std::size_t num_triples_ = 0;
 };
 
 template <IsSpdz2kShare ShrType, std::size_t N>
 FakeGtzGate<ShrType, N>::
-FakeGtzGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x)
-    : FakeGate<ShrType, N>(p_input_x, nullptr) {
+FakeGtzGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, std::size_t num_bits, std::size_t radix)
+    : FakeGate<ShrType, N>(p_input_x, nullptr), num_bits_(num_bits), radix_(radix) {
+    if (num_bits == 0 || num_bits > kMaxBits) {
+        throw std::invalid_argument("The bit length of GtzGate should be between 1 and the bits of the ring");
+    }
+    if (radix < 2 || radix > kMaxRadix) {
+        throw std::invalid_argument("The radix of GtzGate should be between 2 and 8");
+    }
     this->set_dim_row(p_input_x->dim_row());
     this->set_dim_col(p_input_x->dim_col());
 }
@@ -38,7 +68,7 @@ template <IsSpdz2kShare ShrType, std::size_t N>
 std::array<typename FakeGtzGate<ShrType, N>::ClearType, N>
 FakeGtzGate<ShrType, N>::generateBooleanShares(ClearType x) {
     std::array<ClearType, N> ret;
-    for (int i = 0; i < N - 1; ++i) {
+    for (std::size_t i = 0; i < N - 1; ++i) {
         ret[i] = getRand<ClearType>();
         x ^= ret[i];
     }
@@ -63,12 +93,85 @@ void FakeGtzGate<ShrType, N>::doRunOffline() {
     this->fake_party().WriteSharesToAllParites(this->lambda_shr());
     this->fake_party().WriteSharesToAllParites(this->lambda_shr_mac());
 
-    // Boolean shares of lambda_x
+    // Boolean shares of the lower bits of lambda_x, the mask of the input that the online phase compares Delta_x with
     // TODO: clean up the code, extract the boolean share generation to a function
+    const ClearType bits_mask = num_bits_ == sizeof(ClearType) * 8 ? ~ClearType(0) : (ClearType(1) << num_bits_) - 1;
+    const auto& lambda_x_clear = this->input_x()->lambda_clear();
     for (std::size_t vec_idx = 0; vec_idx < size; ++vec_idx) {
-        auto shares_i = generateBooleanShares(this->lambda_clear()[vec_idx]);
+        auto shares_i = generateBooleanShares(lambda_x_clear[vec_idx]);
         for (std::size_t party_idx = 0; party_idx < N; ++party_idx) {
-            this->fake_party().ithPartyFile(party_idx) << shares_i[party_idx] << '\n';
+            this->fake_party().ithPartyFile(party_idx) << (shares_i[party_idx] & bits_mask) << '\n';
+        }
+    }
+
+    // The MACs of their bits, bit-sliced as GtzGate evaluates them
+    const auto num_words = bitSliceWords(size);
+    std::vector<uint64_t> planes(num_bits_ * num_words);
+    bitSlice(lambda_x_clear.data(), size, num_bits_, planes.data());
+    this->fake_party().WriteWordsToAllParties(this->fake_party().GenerateAllPartiesBitMacs(planes, num_words));
+
+    // The triples of the carry circuit, level by level and pair by pair (or group by group), each followed by its MACs
+    num_triples_ = 0;
+    for (auto k : carryLevels(num_bits_, radix_)) {
+        for (auto t : carryUnits(k, radix_)) {
+            if (radix_ == 2) {
+                generatePairTriples(planes, num_words);
+                num_triples_ += 2;
+            }
+            else {
+                generateGroupTriple(t, planes, num_words);
+                num_triples_ += carryUnitPlanes(t, radix_) - (2 * t - 1);
+            }
+            this->fake_party().WriteWordsToAllParties(this->fake_party().GenerateAllPartiesBitShares(planes));
+            this->fake_party().WriteWordsToAllParties(this->fake_party().GenerateAllPartiesBitMacs(planes, num_words));
+        }
+    }
+    num_triples_ *= size;
+
+    // The daBits that mask the result, random bits shared in binary (bit-sliced, with their MACs) and in the ring
+    std::vector<ClearType> r_clear(size);
+    std::ranges::generate(r_clear, [] { return static_cast<ClearType>(getRand<uint64_t>() & 1); });
+    planes.assign(num_words, 0);
+    bitSlice(r_clear.data(), size, 1, planes.data());
+    this->fake_party().WriteWordsToAllParties(this->fake_party().GenerateAllPartiesBitShares(planes));
+    this->fake_party().WriteWordsToAllParties(this->fake_party().GenerateAllPartiesBitMacs(planes, num_words));
+    auto r_shares = this->fake_party().GenerateAllPartiesShares(r_clear);
+    this->fake_party().WriteSharesToAllParites(r_shares.value_shares);
+    this->fake_party().WriteSharesToAllParites(r_shares.mac_shares);
+}
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+void FakeGtzGate<ShrType, N>::
+generatePairTriples(std::vector<uint64_t>& planes, std::size_t num_words) const {
+    // (a, b, c = a * b) of p2 * p1, then of p2 * g1
+    planes.resize(kCarryPairPlanes * num_words);
+    for (std::size_t triple = 0; triple < 2; ++triple) {
+        auto* a = planes.data() + 3 * triple * num_words;
+        auto* b = a + num_words;
+        auto* c = b + num_words;
+        for (std::size_t word = 0; word < num_words; ++word) {
+            a[word] = getRand<uint64_t>();
+            b[word] = getRand<uint64_t>();
+            c[word] = a[word] & b[word];
+        }
+    }
+}
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+void FakeGtzGate<ShrType, N>::
+generateGroupTriple(std::size_t t, std::vector<uint64_t>& planes, std::size_t num_words) const {
+    // The random masks of the inputs, then the products of the masks of the subsets in the order of CarryGroupTriple
+    const auto triple = carryGroupTriple(t);
+    planes.resize(triple.num_planes() * num_words);
+    std::generate_n(planes.begin(), triple.num_inputs * num_words, getRand<uint64_t>);
+    for (std::size_t idx = 0; idx < triple.subsets.size(); ++idx) {
+        auto* product = planes.data() + (triple.num_inputs + idx) * num_words;
+        std::fill_n(product, num_words, ~uint64_t(0));
+        for (auto set = triple.subsets[idx]; set != 0; set &= set - 1) {
+            const auto* mask = planes.data() + std::countr_zero(set) * num_words;
+            for (std::size_t word = 0; word < num_words; ++word) {
+                product[word] &= mask[word];
+            }
         }
     }
 }
@@ -0,0 +1,73 @@
+#ifndef BIOAUTH_FAKEMAXPOOL2DGATE_H
+#define BIOAUTH_FAKEMAXPOOL2DGATE_H
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "utils/tensor.h"
+#include "share/IsSpdz2kShare.h"
+#include "fake-offline/FakeGate.h"
+#include "fake-offline/FakeGatherGate.h"
+#include "fake-offline/FakeGtzGate.h"
+#include "fake-offline/FakeElemMultiplyGate.h"
+
+
+namespace bioauth {
+
+/// @brief Fake offline max pooling gate, the same tournament tree as MaxPool2DGate
+template <IsSpdz2kShare ShrType, std::size_t N>
+class FakeMaxPool2DGate : public FakeGate<ShrType, N> {
+public:
+    FakeMaxPool2DGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, const MaxPoolOp& op);
+
+private:
+    void doRunOffline() override;
+
+    // The gates of the tournament tree, in the order in which MaxPool2DGate reads their preprocessing data
+    std::vector<std::shared_ptr<FakeGate<ShrType, N>>> gates_;
+};
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+FakeMaxPool2DGate<ShrType, N>::
+FakeMaxPool2DGate(const std::shared_ptr<FakeGate<ShrType, N>>& p_input_x, const MaxPoolOp& op)
+    : FakeGate<ShrType, N>(p_input_x, nullptr) {
+    if (p_input_x->dim_row() * p_input_x->dim_col() != op.compute_input_size()) {
+        throw std::invalid_argument("The input of max pooling gate should have the size of the pooling");
+    }
+    if (op.compute_kernel_size() < 2) {
+        throw std::invalid_argument("The windows of max pooling gate should have at least two elements");
+    }
+    this->set_dim_row(op.compute_output_size());
+    this->set_dim_col(1);
+
+    const auto num_windows = op.compute_output_size();
+    std::shared_ptr<FakeGate<ShrType, N>> candidates =
+        std::make_shared<FakeGatherGate<ShrType, N>>(p_input_x, poolingWindows(op));
+    gates_.push_back(candidates);
+    for (auto num_candidates = op.compute_kernel_size(); num_candidates > 1;) {
+        auto tournament = tournamentLevel(num_windows, num_candidates);
+        auto difference = std::make_shared<FakeGatherGate<ShrType, N>>(candidates, tournament.left, candidates,
+                                                                       tournament.right, true);
+        auto gtz = std::make_shared<FakeGtzGate<ShrType, N>>(difference);
+        auto multiply = std::make_shared<FakeElemMultiplyGate<ShrType, N>>(difference, gtz);
+        candidates = std::make_shared<FakeGatherGate<ShrType, N>>(candidates, tournament.winner_candidate, multiply,
+                                                                  tournament.winner_comparison);
+        gates_.insert(gates_.end(), {difference, gtz, multiply, candidates});
+        num_candidates = tournament.num_winners;
+    }
+}
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+void FakeMaxPool2DGate<ShrType, N>::doRunOffline() {
+    for (const auto& gate : gates_) {
+        gate->runOffline();
+    }
+    this->lambda_clear() = gates_.back()->lambda_clear();
+    this->lambda_shr() = gates_.back()->lambda_shr();
+    this->lambda_shr_mac() = gates_.back()->lambda_shr_mac();
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_FAKEMAXPOOL2DGATE_H
@@ -12,6 +12,7 @@
 #include "share/IsSpdz2kShare.h"
 #include "utils/rand.h"
 #include "utils/uint128_io.h"
+#include "utils/bit_slicing.h"
 
 namespace bioauth {
 
@@ -64,8 +65,19 @@ public:
         return key_shares_.at(i);
     }
     
+    /// The binary MAC key of the boolean shares (see bit_slicing.h) and the share of the i-th party
+    [[nodiscard]] uint64_t bit_mac_key() const { return bit_global_key_; }
+    [[nodiscard]] uint64_t bit_mac_key(std::size_t i) const { return bit_key_shares_.at(i); }
+
     AllPartiesShares GenerateAllPartiesShares(ClearType value) const;
 
+    /// The XOR shares of the MACs of bit planes of num_words words each, kBitMacBits planes per plane
+    std::array<std::vector<uint64_t>, N> GenerateAllPartiesBitMacs(const std::vector<uint64_t>& planes,
+                                                                   std::size_t num_words) const;
+
+    /// The XOR shares of bit planes
+    std::array<std::vector<uint64_t>, N> GenerateAllPartiesBitShares(const std::vector<uint64_t>& planes) const;
+
     AllPartiesSharesVec GenerateAllPartiesShares(const std::vector<ClearType>& value) const;
 
     // void WriteSharesToAllParites(const std::array<std::vector<SemiShrType>, N>& shares,
@@ -77,6 +89,9 @@ public:
 
     void WriteClearToAllParties(const std::vector<ClearType>& values);
 
+    /// Writes the words packed in binary, on a line of their own
+    void WriteWordsToAllParties(const std::array<std::vector<uint64_t>, N>& words);
+
     /// Simulate sending data to another party (just count the bytes)
     void SimulateSendToOther(const std::vector<SemiShrType>& data);
       
@@ -85,6 +100,8 @@ private:
     inline static const std::filesystem::path kFakeOfflineDir{FAKE_OFFLINE_DIR}; // The macro is in CMakeLists.txt
     GlobalKeyType global_key_;
     std::array<KeyShrType, N> key_shares_;
+    uint64_t bit_global_key_;
+    std::array<uint64_t, N> bit_key_shares_;
     std::array<std::ofstream, N> output_files_;
     std::size_t total_bytes_written_ = 0;
     //typename ShrType::ClearType mac_key_;
@@ -99,7 +116,7 @@ FakeParty<ShrType, N>::FakeParty(const std::string& job_name) {
     const std::string file_name_suffix = job_name + (job_name.empty() ? "party-" : "-party-");
     for (std::size_t i = 0; i < N; ++i) {
         std::string current_file_name = file_name_suffix + std::to_string(i) + ".txt";
-        output_files_[i].open(kFakeOfflineDir / current_file_name);
+        output_files_[i].open(kFakeOfflineDir / current_file_name, std::ios::binary);
     }
 
     // Generate the MAC key
@@ -109,9 +126,16 @@ FakeParty<ShrType, N>::FakeParty(const std::string& job_name) {
         global_key_ += static_cast<GlobalKeyType>(key_shares_[i]);
     }
 
-    // Write the MAC key to the output files for each party
+    // Generate the binary MAC key, which is XOR-shared
+    bit_global_key_ = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        bit_key_shares_[i] = getRand<uint64_t>() & ((uint64_t(1) << kBitMacBits) - 1);
+        bit_global_key_ ^= bit_key_shares_[i];
+    }
+
+    // Write the MAC keys to the output files for each party
     for (std::size_t i = 0; i < N; ++i) {
-        output_files_[i] << key_shares_[i] << '\n';
+        output_files_[i] << key_shares_[i] << '\n' << bit_key_shares_[i] << '\n';
     }
     //mac_key_ = getRand<typename ShrType::ClearType>();
 }
@@ -167,6 +191,49 @@ GenerateAllPartiesShares(const std::vector<ClearType>& value) const {
     return all_parties_shares;
 }
 
+template <IsSpdz2kShare ShrType, std::size_t N>
+std::array<std::vector<uint64_t>, N> FakeParty<ShrType, N>::
+GenerateAllPartiesBitMacs(const std::vector<uint64_t>& planes, std::size_t num_words) const {
+    std::array<std::vector<uint64_t>, N> mac_shares;
+    std::ranges::for_each(mac_shares, [&](auto& vec) { vec.resize(planes.size() * kBitMacBits); });
+
+    // Plane s of the MACs of a plane is the plane where bit s of the key is set, the first N - 1 shares are random
+    const auto key_masks = bitMacKeyMasks(bit_global_key_);
+    for (std::size_t plane = 0; plane < planes.size() / std::max<std::size_t>(num_words, 1); ++plane) {
+        for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+            for (std::size_t word = 0; word < num_words; ++word) {
+                auto mac = planes[plane * num_words + word] & key_masks[bit];
+                auto idx = (plane * kBitMacBits + bit) * num_words + word;
+                for (std::size_t party_idx = 0; party_idx < N - 1; ++party_idx) {
+                    mac_shares[party_idx][idx] = getRand<uint64_t>();
+                    mac ^= mac_shares[party_idx][idx];
+                }
+                mac_shares.back()[idx] = mac;
+            }
+        }
+    }
+
+    return mac_shares;
+}
+
+template <IsSpdz2kShare ShrType, std::size_t N>
+std::array<std::vector<uint64_t>, N> FakeParty<ShrType, N>::
+GenerateAllPartiesBitShares(const std::vector<uint64_t>& planes) const {
+    std::array<std::vector<uint64_t>, N> shares;
+    std::ranges::for_each(shares, [&](auto& vec) { vec.resize(planes.size()); });
+
+    for (std::size_t word = 0; word < planes.size(); ++word) {
+        auto value = planes[word];
+        for (std::size_t party_idx = 0; party_idx < N - 1; ++party_idx) {
+            shares[party_idx][word] = getRand<uint64_t>();
+            value ^= shares[party_idx][word];
+        }
+        shares.back()[word] = value;
+    }
+
+    return shares;
+}
+
 // template <IsSpdz2kShare ShrType, std::size_t N>
 // void FakeParty<ShrType, N>::WriteSharesToAllParites(const std::array<std::vector<SemiShrType>, N>& shares,
 //                                                     const std::array<std::vector<SemiShrType>, N>& macs) {
@@ -221,6 +288,18 @@ void FakeParty<ShrType, N>::WriteClearToAllParties(const std::vector<ClearType>&
         }
     }
 }
+template <IsSpdz2kShare ShrType, std::size_t N>
+void FakeParty<ShrType, N>::WriteWordsToAllParties(const std::array<std::vector<uint64_t>, N>& words) {
+    for (std::size_t party_idx = 0; party_idx < N; ++party_idx) {
+        auto& output_file = ithPartyFile(party_idx);
+        const auto num_bytes = words[party_idx].size() * sizeof(uint64_t);
+        output_file.write(reinterpret_cast<const char*>(words[party_idx].data()),
+                          static_cast<std::streamsize>(num_bytes));
+        output_file << '\n';
+        total_bytes_written_ += num_bytes + 1;
+    }
+}
+
 template <IsSpdz2kShare ShrType, std::size_t N>
 void FakeParty<ShrType, N>::SimulateSendToOther(const std::vector<SemiShrType>& data) {
     // 只累加通信字节数，不写入任何文件
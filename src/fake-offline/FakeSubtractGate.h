@@ -44,6 +44,7 @@ void FakeSubtractGate<ShrType, N>::doRunOffline() {
     auto size = this->dim_row() * this->dim_col();
 
     // $[\lambda_z] = [\lambda_x] - [\lambda_y]$
+    this->lambda_clear() = matrixSubtract(this->input_x()->lambda_clear(), this->input_y()->lambda_clear());
     for (std::size_t party_idx = 0; party_idx < N; ++party_idx) {
         this->lambda_shr()[party_idx] = matrixSubtract(this->input_x()->lambda_shr()[party_idx],
                                                        this->input_y()->lambda_shr()[party_idx]);
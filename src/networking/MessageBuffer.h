@@ -0,0 +1,129 @@
+
+#ifndef BIOAUTH_MESSAGEBUFFER_H
+#define BIOAUTH_MESSAGEBUFFER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <concepts>
+#include <stdexcept>
+#include <bit>
+
+#include "share/WideUint.h"
+
+
+namespace bioauth {
+
+/// A flat byte buffer that carries the messages of several gates in one communication round.
+/// The gates append their messages one after another, and the receiver reads them back in the same order,
+/// so no per-gate framing is needed as long as both parties walk the gates in the same order.
+class MessageBuffer {
+public:
+    template <RingElement T>
+    void Append(const T* values, std::size_t num_elements);
+
+    template <RingElement T>
+    void Append(const std::vector<T>& values) { Append(values.data(), values.size()); }
+
+    template <RingElement T>
+    void ReadInto(T* values, std::size_t num_elements);
+
+    template <RingElement T>
+    std::vector<T> Read(std::size_t num_elements);
+
+    /// Appends the lower element_bytes bytes of each value, e.g., a public value of Z_2^K in ceil(K/8) bytes.
+    /// The values may be wider than what they stand for, e.g., shares whose lower bits are opened.
+    template <RingElement T>
+    void AppendPacked(const T* values, std::size_t num_elements, std::size_t element_bytes);
+
+    /// Reads values appended by AppendPacked(), with their upper bytes set to zero
+    template <RingElement T>
+    void ReadPackedInto(T* values, std::size_t num_elements, std::size_t element_bytes);
+
+    void Clear() {
+        bytes_.clear();
+        read_pos_ = 0;
+    }
+
+    void ResetReadPosition() { read_pos_ = 0; }
+
+    [[nodiscard]] std::size_t size() const { return bytes_.size(); }
+    [[nodiscard]] bool empty() const { return bytes_.empty(); }
+
+    [[nodiscard]] std::vector<uint8_t>& bytes() { return bytes_; }
+    [[nodiscard]] const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+    std::vector<uint8_t> bytes_;
+    std::size_t read_pos_ = 0;
+};
+
+
+template <RingElement T>
+void MessageBuffer::Append(const T* values, std::size_t num_elements) {
+    auto num_bytes = num_elements * sizeof(T);
+    auto old_size = bytes_.size();
+    bytes_.resize(old_size + num_bytes);
+    std::memcpy(bytes_.data() + old_size, values, num_bytes);
+}
+
+
+template <RingElement T>
+void MessageBuffer::ReadInto(T* values, std::size_t num_elements) {
+    auto num_bytes = num_elements * sizeof(T);
+    if (read_pos_ + num_bytes > bytes_.size()) {
+        throw std::out_of_range("Reading beyond the end of the message buffer");
+    }
+    std::memcpy(values, bytes_.data() + read_pos_, num_bytes);
+    read_pos_ += num_bytes;
+}
+
+
+template <RingElement T>
+std::vector<T> MessageBuffer::Read(std::size_t num_elements) {
+    std::vector<T> values(num_elements);
+    ReadInto(values.data(), num_elements);
+    return values;
+}
+
+// The lower bytes of a value are its first bytes in memory, for the built-in integers and for WideUint
+static_assert(std::endian::native == std::endian::little, "The packed messages assume a little-endian CPU");
+
+
+template <RingElement T>
+void MessageBuffer::AppendPacked(const T* values, std::size_t num_elements, std::size_t element_bytes) {
+    if (element_bytes == sizeof(T)) {
+        Append(values, num_elements);
+        return;
+    }
+    auto old_size = bytes_.size();
+    bytes_.resize(old_size + num_elements * element_bytes);
+    auto* bytes = bytes_.data() + old_size;
+    for (std::size_t i = 0; i < num_elements; ++i) {
+        std::memcpy(bytes + i * element_bytes, values + i, element_bytes);
+    }
+}
+
+
+template <RingElement T>
+void MessageBuffer::ReadPackedInto(T* values, std::size_t num_elements, std::size_t element_bytes) {
+    if (element_bytes == sizeof(T)) {
+        ReadInto(values, num_elements);
+        return;
+    }
+    auto num_bytes = num_elements * element_bytes;
+    if (read_pos_ + num_bytes > bytes_.size()) {
+        throw std::out_of_range("Reading beyond the end of the message buffer");
+    }
+    const auto* bytes = bytes_.data() + read_pos_;
+    for (std::size_t i = 0; i < num_elements; ++i) {
+        values[i] = T(0);
+        std::memcpy(values + i, bytes + i * element_bytes, element_bytes);
+    }
+    read_pos_ += num_bytes;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_MESSAGEBUFFER_H
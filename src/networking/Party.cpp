@@ -7,9 +7,21 @@
 #include <vector>
 #include <cstddef>
 #include <mutex>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
 
 #include <boost/asio.hpp>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 #include "utils/uint128_io.h"
 
 
@@ -54,6 +66,16 @@ Party::Party(std::size_t p_my_id, std::size_t p_num_parties, std::size_t p_port)
 
     io_context_.run();
 
+    // Exchange() calls the non-blocking socket functions directly, the blocking functions of Boost.Asio
+    // keep working on non-blocking sockets, since Boost.Asio then waits for the socket by itself
+    for (std::size_t other_id = 0; other_id < num_parties_; ++other_id) {
+        if (other_id == my_id_) {
+            continue;
+        }
+        send_sockets_[other_id].native_non_blocking(true);
+        receive_sockets_[other_id].native_non_blocking(true);
+    }
+
     // These can be safely deleted
     send_endpoints_.clear();
     send_endpoints_.shrink_to_fit();
@@ -184,6 +206,215 @@ int Party::ReceiveInt(std::size_t from_id) {
 }
 
 
+namespace {
+
+// The length is sent by the other party, so it is checked before the receive buffer is sized to it
+void CheckMessageLength(uint64_t length, std::size_t max_size) {
+    if (length > max_size) {
+        throw std::runtime_error("The message of the other party is longer than expected");
+    }
+}
+
+} // namespace
+
+
+void Party::SendBuffer(std::size_t to_id, const MessageBuffer& buffer) {
+    CheckID(to_id);
+
+    uint64_t length = buffer.size();
+    std::array<boost::asio::const_buffer, 2> message{
+        boost::asio::buffer(&length, sizeof(length)),
+        boost::asio::buffer(buffer.bytes())
+    };
+    bytes_sent_ += boost::asio::write(send_sockets_[to_id], message);
+}
+
+
+void Party::ReceiveBuffer(std::size_t from_id, MessageBuffer& buffer, std::size_t max_size) {
+    CheckID(from_id);
+
+    uint64_t length;
+    boost::asio::read(receive_sockets_[from_id], boost::asio::buffer(&length, sizeof(length)));
+    CheckMessageLength(length, max_size);
+    buffer.Clear();
+    buffer.bytes().resize(length);
+    boost::asio::read(receive_sockets_[from_id], boost::asio::buffer(buffer.bytes()));
+}
+
+
+namespace {
+
+using NativeSocket = boost::asio::ip::tcp::socket::native_handle_type;
+
+// The native socket functions used by Party::Exchange(), the sockets are in non-blocking mode,
+// so the functions return -1 (with WouldBlock() being true) instead of waiting
+
+bool WouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+[[noreturn]] void ThrowSocketError(const char* what) {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+#else
+    int error = errno;
+#endif
+    throw boost::system::system_error(error, boost::asio::error::get_system_category(), what);
+}
+
+// Sends the length header and the payload with one gather write, skipping the first `offset` bytes,
+// so that a short message does not leave a small segment behind (Nagle's algorithm)
+std::ptrdiff_t SendSome(NativeSocket socket, const uint64_t& header, const std::vector<uint8_t>& payload,
+                        std::size_t offset) {
+    auto header_bytes = reinterpret_cast<const char*>(&header);
+    auto payload_bytes = reinterpret_cast<const char*>(payload.data());
+    std::size_t header_offset = std::min(offset, sizeof(header));
+    std::size_t payload_offset = offset - header_offset;
+
+#ifdef _WIN32
+    WSABUF buffers[2] = {
+        {static_cast<ULONG>(sizeof(header) - header_offset), const_cast<char*>(header_bytes + header_offset)},
+        {static_cast<ULONG>(std::min<std::size_t>(payload.size() - payload_offset, 1 << 30)),
+         const_cast<char*>(payload_bytes + payload_offset)}
+    };
+    DWORD sent = 0;
+    auto first = header_offset == sizeof(header) ? 1 : 0;
+    if (WSASend(socket, buffers + first, 2 - first, &sent, 0, nullptr, nullptr) != 0) {
+        return -1;
+    }
+    return static_cast<std::ptrdiff_t>(sent);
+#else
+    iovec buffers[2] = {
+        {const_cast<char*>(header_bytes + header_offset), sizeof(header) - header_offset},
+        {const_cast<char*>(payload_bytes + payload_offset), payload.size() - payload_offset}
+    };
+    msghdr message{};
+    message.msg_iov = header_offset == sizeof(header) ? buffers + 1 : buffers;
+    message.msg_iovlen = header_offset == sizeof(header) ? 1 : 2;
+#ifdef MSG_NOSIGNAL
+    return ::sendmsg(socket, &message, MSG_NOSIGNAL);
+#else
+    return ::sendmsg(socket, &message, 0); // Boost.Asio sets SO_NOSIGPIPE on such platforms
+#endif
+#endif
+}
+
+std::ptrdiff_t ReceiveSome(NativeSocket socket, uint8_t* data, std::size_t size) {
+#ifdef _WIN32
+    return ::recv(socket, reinterpret_cast<char*>(data), static_cast<int>(std::min<std::size_t>(size, 1 << 30)), 0);
+#else
+    return ::recv(socket, data, size, 0);
+#endif
+}
+
+// Waits until the socket to send to is writable or the socket to receive from is readable
+void WaitForSockets(NativeSocket send_socket, bool sending, NativeSocket receive_socket, bool receiving) {
+#ifdef _WIN32
+    WSAPOLLFD fds[2];
+#else
+    pollfd fds[2];
+#endif
+    std::size_t num_fds = 0;
+    if (sending) {
+        fds[num_fds++] = {send_socket, POLLOUT, 0};
+    }
+    if (receiving) {
+        fds[num_fds++] = {receive_socket, POLLIN, 0};
+    }
+#ifdef _WIN32
+    if (WSAPoll(fds, static_cast<ULONG>(num_fds), -1) < 0) {
+        ThrowSocketError("poll");
+    }
+#else
+    if (::poll(fds, num_fds, -1) < 0 && errno != EINTR) {
+        ThrowSocketError("poll");
+    }
+#endif
+}
+
+} // namespace
+
+
+void Party::Exchange(std::size_t other_id, const MessageBuffer& send_buffer, MessageBuffer& receive_buffer,
+                     std::size_t max_receive_size) {
+    CheckID(other_id);
+
+    auto send_socket = send_sockets_[other_id].native_handle();
+    auto receive_socket = receive_sockets_[other_id].native_handle();
+
+    uint64_t send_length = send_buffer.size();
+    std::size_t send_total = sizeof(send_length) + send_buffer.size();
+    std::size_t sent = 0;
+
+    // The length of the incoming message is known after its header has arrived
+    uint64_t receive_length = 0;
+    std::size_t header_received = 0;
+    std::size_t payload_received = 0;
+    receive_buffer.Clear();
+    auto receiving = [&] {
+        return header_received < sizeof(receive_length) || payload_received < receive_length;
+    };
+
+    while (sent < send_total || receiving()) {
+        bool progress = false;
+
+        if (sent < send_total) {
+            auto result = SendSome(send_socket, send_length, send_buffer.bytes(), sent);
+            if (result > 0) {
+                sent += result;
+                progress = true;
+            }
+            else if (result < 0 && !WouldBlock()) {
+                ThrowSocketError("send");
+            }
+        }
+
+        if (receiving()) {
+            std::ptrdiff_t result;
+            if (header_received < sizeof(receive_length)) {
+                auto header = reinterpret_cast<uint8_t*>(&receive_length);
+                result = ReceiveSome(receive_socket, header + header_received,
+                                     sizeof(receive_length) - header_received);
+                if (result > 0) {
+                    header_received += result;
+                    if (header_received == sizeof(receive_length)) {
+                        CheckMessageLength(receive_length, max_receive_size);
+                        receive_buffer.bytes().resize(receive_length);
+                    }
+                }
+            }
+            else {
+                result = ReceiveSome(receive_socket, receive_buffer.bytes().data() + payload_received,
+                                     receive_length - payload_received);
+                if (result > 0) {
+                    payload_received += result;
+                }
+            }
+
+            if (result > 0) {
+                progress = true;
+            }
+            else if (result == 0) {
+                throw std::runtime_error("The other party closed the connection");
+            }
+            else if (!WouldBlock()) {
+                ThrowSocketError("receive");
+            }
+        }
+
+        if (!progress) {
+            WaitForSockets(send_socket, sent < send_total, receive_socket, receiving());
+        }
+    }
+
+    bytes_sent_ += send_total;
+}
+
+
 // explicit instantiate the template functions
 // template void Party::Send<uint64_t>(std::size_t, uint64_t);
 // template void Party::Send<__uint128_t>(std::size_t, __uint128_t);
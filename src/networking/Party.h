@@ -15,7 +15,9 @@
 
 #include <boost/asio.hpp>
 
+#include "share/WideUint.h"
 #include "utils/uint128_io.h"
+#include "networking/MessageBuffer.h"
 
 
 namespace bioauth {
@@ -34,24 +36,45 @@ public:
     void SendInt(std::size_t to_id, int message);
     int ReceiveInt(std::size_t from_id);
 
-    template <std::integral T>
+    template <RingElement T>
     void Send(std::size_t to_id, T message);
 
-    template <std::integral T>
+    template <RingElement T>
     T Receive(std::size_t from_id);
 
-    template <std::integral T>
+    template <RingElement T>
     void SendVec(std::size_t to_id, const std::vector<T>& message);
 
-    template <std::integral T>
+    template <RingElement T>
     std::vector<T> ReceiveVec(std::size_t from_id, std::size_t num_elements);
 
-    template <std::integral T>
+    template <RingElement T>
     void SendVecToOther(const std::vector<T>& message);
 
-    template <std::integral T>
+    template <RingElement T>
     std::vector<T> ReceiveVecFromOther(std::size_t num_elements);
 
+    // The buffer is sent with its length, so the receiver doesn't need to know the exact size in advance.
+    // The receiver passes the largest size it expects, a longer message is rejected before anything is allocated.
+    void SendBuffer(std::size_t to_id, const MessageBuffer& buffer);
+    void ReceiveBuffer(std::size_t from_id, MessageBuffer& buffer, std::size_t max_size);
+
+    void SendBufferToOther(const MessageBuffer& buffer) { SendBuffer(1 - my_id_, buffer); }
+    void ReceiveBufferFromOther(MessageBuffer& buffer, std::size_t max_size) {
+        ReceiveBuffer(1 - my_id_, buffer, max_size);
+    }
+
+    // Sends one buffer and receives one buffer at the same time, on the calling thread:
+    // both sockets are non-blocking, and the party waits in poll() until either of them can make progress.
+    // The messages are framed as in SendBuffer(), so the other party may use either API.
+    void Exchange(std::size_t other_id, const MessageBuffer& send_buffer, MessageBuffer& receive_buffer,
+                  std::size_t max_receive_size);
+
+    void ExchangeWithOther(const MessageBuffer& send_buffer, MessageBuffer& receive_buffer,
+                           std::size_t max_receive_size) {
+        Exchange(1 - my_id_, send_buffer, receive_buffer, max_receive_size);
+    }
+
     [[nodiscard]] std::size_t my_id() const { return my_id_; }
 
     [[nodiscard]] uint64_t bytes_sent() const { 
@@ -107,16 +130,18 @@ void Party::CheckID(std::size_t target_id) const {
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline void Party::Send(std::size_t to_id, T message) {
     CheckID(to_id);
     bytes_sent_ += boost::asio::write(send_sockets_[to_id], boost::asio::buffer(&message, sizeof(message)));
+#ifdef BIOAUTH_DEBUG_ASIO
     std::lock_guard cerr_lock(cerr_mutex_);
     //std::cerr << "Party " << my_id_ << " sent integer " << message << " to party " << to_id << '\n';
+#endif
 }
 
 
-template <std::integral T>
+template <RingElement T>
 T Party::Receive(std::size_t from_id) {
     CheckID(from_id);
     //std::cout<<"from id="<<from_id<<std::endl;
@@ -124,15 +149,16 @@ T Party::Receive(std::size_t from_id) {
     boost::asio::read(receive_sockets_[from_id], boost::asio::buffer(&message, sizeof(message)));
     //std::cerr << " message=" << message << '\n';
 
-
+#ifdef BIOAUTH_DEBUG_ASIO
     std::lock_guard cerr_lock(cerr_mutex_);
     //std::cerr << "Party " << my_id_ << " received integer " << message << " from party " << from_id << '\n';
+#endif
 
     return message;
 }
 
 
-template <std::integral T>
+template <RingElement T>
 void Party::SendVec(std::size_t to_id, const std::vector<T>& message) {
     CheckID(to_id);
     bytes_sent_ += boost::asio::write(send_sockets_[to_id], boost::asio::buffer(message));
@@ -147,7 +173,7 @@ void Party::SendVec(std::size_t to_id, const std::vector<T>& message) {
 }
 
 
-template <std::integral T>
+template <RingElement T>
 std::vector<T> Party::ReceiveVec(std::size_t from_id, std::size_t num_elements) {
     CheckID(from_id);
     std::vector<T> message(num_elements);
@@ -166,12 +192,12 @@ std::vector<T> Party::ReceiveVec(std::size_t from_id, std::size_t num_elements)
 }
 
 
-template <std::integral T>
+template <RingElement T>
 void Party::SendVecToOther(const std::vector<T>& message) {
     SendVec(1 - this->my_id(), message);
 }
 
-template <std::integral T>
+template <RingElement T>
 std::vector<T> Party::ReceiveVecFromOther(std::size_t num_elements) {
     return ReceiveVec<T>(1 - this->my_id(), num_elements);
 }
@@ -6,16 +6,17 @@
 #include <memory>
 #include <vector>
 
-#include "protocols/Gate.h"
+#include "protocols/LinearGate.h"
 #include "share/IsSpdz2kShare.h"
 #include "utils/linear_algebra.h"
 
 namespace bioauth {
 
 template <IsSpdz2kShare ShrType>
-class AddConstantGate : public Gate<ShrType> {
+class AddConstantGate : public LinearGate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using Term = typename LinearGate<ShrType>::Term;
     using ClearType = typename ShrType::ClearType;
 
     AddConstantGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
@@ -23,7 +24,8 @@ public:
 
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doRunLinear() override;
+    void doAppendLinearForm(std::vector<Term>& terms, ClearType& constant) const override;
 
     ClearType constant_;
 };
@@ -31,7 +33,7 @@ private:
 template <IsSpdz2kShare ShrType>
 AddConstantGate<ShrType>::
 AddConstantGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, const ClearType& constant)
-    : Gate<ShrType>(p_input_x, nullptr), constant_(constant) {
+    : LinearGate<ShrType>(p_input_x, nullptr), constant_(constant) {
     this->set_dim_row(p_input_x->dim_row());
     this->set_dim_col(p_input_x->dim_col());
 }
@@ -43,8 +45,15 @@ void AddConstantGate<ShrType>::doReadOfflineFromFile() {
 }
 
 template <IsSpdz2kShare ShrType>
-void AddConstantGate<ShrType>::doRunOnline() {
-    this->Delta_clear() = matrixAddConstant(this->input_x()->Delta_clear(), constant_);
+void AddConstantGate<ShrType>::doRunLinear() {
+    matrixAddConstant(this->input_x()->Delta_clear(), constant_, this->Delta_clear());
+}
+
+
+template <IsSpdz2kShare ShrType>
+void AddConstantGate<ShrType>::doAppendLinearForm(std::vector<Term>& terms, ClearType& constant) const {
+    terms.push_back({this->input_x().get(), 1});
+    constant += constant_;
 }
 
 } // bioauth
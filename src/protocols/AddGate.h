@@ -6,30 +6,33 @@
 #include <memory>
 #include <vector>
 
-#include "protocols/Gate.h"
+#include "protocols/LinearGate.h"
 #include "share/IsSpdz2kShare.h"
 #include "utils/linear_algebra.h"
 
 namespace bioauth {
 
 template <IsSpdz2kShare ShrType>
-class AddGate : public Gate<ShrType> {
+class AddGate : public LinearGate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
+    using Term = typename LinearGate<ShrType>::Term;
 
     AddGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
             const std::shared_ptr<Gate<ShrType>>& p_input_y);
 
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doRunLinear() override;
+    void doAppendLinearForm(std::vector<Term>& terms, ClearType& constant) const override;
 };
 
 
 template <IsSpdz2kShare ShrType>
 AddGate<ShrType>::AddGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                           const std::shared_ptr<Gate<ShrType>>& p_input_y)
-    : Gate<ShrType>(p_input_x, p_input_y) {
+    : LinearGate<ShrType>(p_input_x, p_input_y) {
     if (p_input_x->dim_row() != p_input_y->dim_row() ||
         p_input_x->dim_col() != p_input_y->dim_col()) {
         throw std::invalid_argument("The inputs of addition gate should have the same dimensions");
@@ -42,14 +45,21 @@ AddGate<ShrType>::AddGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
 template <IsSpdz2kShare ShrType>
 void AddGate<ShrType>::doReadOfflineFromFile() {
     auto size = this->dim_row() * this->dim_col();
-    this->lambda_shr() = this->party().ReadShares(size);
-    this->lambda_shr_mac() = this->party().ReadShares(size);
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
 }
 
 
 template <IsSpdz2kShare ShrType>
-void AddGate<ShrType>::doRunOnline() {
-    this->Delta_clear() = matrixAdd(this->input_x()->Delta_clear(), this->input_y()->Delta_clear());
+void AddGate<ShrType>::doRunLinear() {
+    matrixAdd(this->input_x()->Delta_clear(), this->input_y()->Delta_clear(), this->Delta_clear());
+}
+
+
+template <IsSpdz2kShare ShrType>
+void AddGate<ShrType>::doAppendLinearForm(std::vector<Term>& terms, ClearType&) const {
+    terms.push_back({this->input_x().get(), 1});
+    terms.push_back({this->input_y().get(), 1});
 }
 
 } // namespace bioauth
@@ -3,10 +3,11 @@
 #ifndef AVGPOOL2DGATE_H
 #define AVGPOOL2DGATE_H
 
+#include <span>
 #include <memory>
 #include <vector>
 #include <stdexcept>
-#include <thread>
+#include <functional>
 
 #include "protocols/Gate.h"
 #include "share/IsSpdz2kShare.h"
@@ -25,13 +26,18 @@ public:
     AvgPool2DGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                   const MaxPoolOp& op);
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
 
     MaxPoolOp maxPoolOp;
     ClearType factor; // equals 1 / kernel_size
     std::vector<SemiShrType> lambdaPreTruncShr, lambdaPreTruncShrMac;
+    std::vector<SemiShrType> delta_zShr; // kept between the two halves of the round
+    std::vector<SemiShrType> x_shr_; // kept so that later sessions reuse its storage
 };
 
 template <IsSpdz2kShare ShrType>
@@ -48,48 +54,47 @@ AvgPool2DGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
 template <IsSpdz2kShare ShrType>
 void AvgPool2DGate<ShrType>::doReadOfflineFromFile() {
     auto size = this->maxPoolOp.compute_output_size();
-    this->lambda_shr() = this->party().ReadShares(size);
-    this->lambda_shr_mac() = this->party().ReadShares(size);
-    lambdaPreTruncShr = this->party().ReadShares(size);
-    lambdaPreTruncShrMac = this->party().ReadShares(size);
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
+    this->party().ReadShares(lambdaPreTruncShr, size);
+    this->party().ReadShares(lambdaPreTruncShrMac, size);
 }
 
 template <IsSpdz2kShare ShrType>
-void AvgPool2DGate<ShrType>::doRunOnline() {
+void AvgPool2DGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
     const auto& delta_x_clear = this->input_x()->Delta_clear();
     const auto& lambda_x_shr = this->input_x()->lambda_shr();
 
     // [x] = Delta_x - [lambda_x]
-    std::vector<SemiShrType> x_shr;
     if (this->my_id() == 0) {
-        x_shr = matrixSubtract(delta_x_clear, lambda_x_shr);
+        matrixTransform(x_shr_, std::minus<SemiShrType>(), delta_x_clear, lambda_x_shr);
     }
     else {
-        x_shr.resize(lambda_x_shr.size());
-        std::transform(lambda_x_shr.begin(), lambda_x_shr.end(), x_shr.begin(), std::negate());
+        matrixTransform(x_shr_, std::negate<SemiShrType>(), lambda_x_shr);
     }
 
-    auto size = maxPoolOp.compute_output_size();
-
-    auto delta_zShr = sumPool(x_shr, maxPoolOp);
-    matrixScalarAssign(delta_zShr, static_cast<SemiShrType>(factor));
-
-    assert(delta_zShr.size() == size);
+    sumPool(x_shr_, delta_zShr, maxPoolOp);
+    assert(delta_zShr.size() == maxPoolOp.compute_output_size());
 
-    //truncation (needs communication)
-    matrixAddAssign(delta_zShr, lambdaPreTruncShr);
+    // truncation (needs communication)
+    matrixTransform(delta_zShr,
+                    [factor = static_cast<SemiShrType>(factor)](SemiShrType sum, SemiShrType lambda) {
+                        return sum * factor + lambda;
+                    },
+                    delta_zShr, lambdaPreTruncShr);
 
-    std::vector<SemiShrType> delta_zRcv(size);
-    std::thread t1([this, &delta_zShr] {
-        this->party().SendVecToOther(delta_zShr);
-    });
-    std::thread t2([this, &delta_zRcv, size] {
-        delta_zRcv = this->party().template ReceiveVecFromOther<SemiShrType>(size);
-    });
-    t1.join();
-    t2.join();
+    // Nothing checks the MAC of this opening, so only the lower K bits that the result keeps are sent
+    send_buffer.AppendPacked(delta_zShr.data(), delta_zShr.size(), ShrType::kClearBytes);
+}
 
-    this->Delta_clear() = matrixAdd(delta_zShr, delta_zRcv);
+template <IsSpdz2kShare ShrType>
+void AvgPool2DGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    this->Delta_clear().resize(delta_zShr.size());
+    receive_buffer.ReadPackedInto(this->Delta_clear().data(), delta_zShr.size(), ShrType::kClearBytes);
+    // The upper bits must not be shifted into the result
+    matrixTransform(std::span<ClearType>(this->Delta_clear()),
+                    [](ClearType other, SemiShrType own) { return ShrType::ToClear(own + other); },
+                    this->Delta_clear(), delta_zShr);
     truncateClearVecInplace(this->Delta_clear());
 }
 
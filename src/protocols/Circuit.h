@@ -6,11 +6,21 @@
 
 #include <memory>
 #include <vector>
+#include <utility>
+#include <memory_resource>
 
 #include "utils/Timer.h"
+#include "utils/ExecutionPlan.h"
+#include "utils/WorkStealingPool.h"
+#include "utils/MemoryStats.h"
 #include "share/IsSpdz2kShare.h"
 #include "protocols/PartyWithFakeOffline.h"
 #include "protocols/Gate.h"
+#include "protocols/RoundScheduler.h"
+#include "protocols/ParallelExecutor.h"
+#include "protocols/GateFusion.h"
+#include "protocols/MemoryPlanner.h"
+#include "protocols/MacCheck.h"
 #include "protocols/InputGate.h"
 #include "protocols/AddGate.h"
 #include "protocols/SubtractGate.h"
@@ -24,9 +34,17 @@
 #include "protocols/GtzGate.h"
 #include "protocols/ReLUGate.h"
 #include "protocols/AvgPool2DGate.h"
+#include "protocols/MaxPool2DGate.h"
 
 namespace bioauth {
 
+/// The gates of a circuit are allocated contiguously in an arena owned by the circuit,
+/// so the gates returned by the builder functions must not outlive the circuit.
+/// The execution plan is computed once, when a phase is first run after the circuit changed.
+///
+/// A circuit is built once and can be evaluated in many sessions. For each session,
+/// call readOfflineFromFile() to load the next batch of preprocessing data, set the new inputs,
+/// and call runOnline(). The gates keep their buffers between sessions and overwrite them in place.
 template <IsSpdz2kShare ShrType>
 class Circuit {
 public:
@@ -34,6 +52,8 @@ public:
 
     explicit Circuit(PartyWithFakeOffline<ShrType>& party) : party_(party) {}
 
+    ~Circuit();
+
     void addEndpoint(const std::shared_ptr<Gate<ShrType>>& gate);
     void runOffline();
     void readOfflineFromFile();
@@ -41,6 +61,24 @@ public:
     void runOnlineWithBenckmark();
     void printStats();
 
+    /// Evaluates the online phase on `num_threads` threads, gates that do not depend on each other
+    /// run concurrently on a work-stealing pool. With one thread (the default), the layers are walked serially.
+    void setNumThreads(std::size_t num_threads);
+
+    /// Enables the fusion pass (see GateFusion.h): chains of linear gates are evaluated in one pass,
+    /// and the outputs are opened in the first round. Both parties must use the same setting.
+    void setFusion(bool enabled);
+
+    /// Enables the memory planner (see MemoryPlanner.h): gates whose Deltas are not needed at the same time
+    /// share their buffers, so only the Deltas of the endpoints and of the inputs of the outputs are kept after a run.
+    /// With `huge_pages`, the shared buffers are backed by transparent huge pages where supported.
+    void setMemoryPlanning(bool enabled, bool huge_pages = false);
+
+    /// Enables the deferred MAC check (see MacCheck.h): the values opened by the gates are checked together
+    /// at the end of runOnline(), which throws std::runtime_error if a MAC does not match.
+    /// Both parties must use the same setting.
+    void setMacCheck(bool enabled);
+
     std::shared_ptr<InputGate<ShrType>>
     input(std::size_t owner_id, std::size_t dim_row, std::size_t dim_col);
 
@@ -76,133 +114,261 @@ public:
     std::shared_ptr<AvgPool2DGate<ShrType>>
     avgPool2D(const std::shared_ptr<Gate<ShrType>>& input_x, const MaxPoolOp& op);
 
+    std::shared_ptr<MaxPool2DGate<ShrType>>
+    maxPool2D(const std::shared_ptr<Gate<ShrType>>& input_x, const MaxPoolOp& op);
+
+    /// [x >= 0] on the lower num_bits bits of x, for -2^(num_bits - 1) <= x < 2^(num_bits - 1),
+    /// by a carry circuit of the radix (see GtzGate)
     std::shared_ptr<GtzGate<ShrType>>
-    gtz(const std::shared_ptr<Gate<ShrType>>& input_x);
+    gtz(const std::shared_ptr<Gate<ShrType>>& input_x, std::size_t num_bits = GtzGate<ShrType>::kMaxBits,
+        std::size_t radix = 2);
 
     std::shared_ptr<ReLUGate<ShrType>>
     relu(const std::shared_ptr<Gate<ShrType>>& input_x);
 
     [[nodiscard]] auto& endpoints() { return endpoints_; }
 
+    /// The number of communication rounds of the last online phase
+    [[nodiscard]] std::size_t rounds() const {
+        return pool_ ? executor_.num_rounds() : scheduler_.num_rounds();
+    }
+
+    /// The peak resident memory of the process during the last readOfflineFromFile() and runOnlineWithBenckmark()
+    [[nodiscard]] std::size_t peak_offline_bytes() const { return peak_offline_bytes_; }
+    [[nodiscard]] std::size_t peak_online_bytes() const { return peak_online_bytes_; }
+
+    /// The cost of the last MAC check, which is included in the totals of the online phase
+    [[nodiscard]] std::size_t mac_check_rounds() const { return mac_check_.num_rounds(); }
+    [[nodiscard]] std::size_t mac_check_bytes() const { return mac_check_bytes_; }
+
     Timer& timer() { return timer_; }
 
 private:
+    template <typename GateType, typename... Args>
+    std::shared_ptr<GateType> makeGate(Args&&... args);
+
+    const ExecutionPlan<Gate<ShrType>>& plan();
+
     PartyWithFakeOffline<ShrType>& party_;
+    std::pmr::monotonic_buffer_resource gate_arena_; // must be declared before the gates
     std::vector<std::shared_ptr<Gate<ShrType>>> gates_;
     std::vector<std::shared_ptr<Gate<ShrType>>> endpoints_;
+    ExecutionPlan<Gate<ShrType>> plan_;
+    bool plan_outdated_ = true;
+    bool fusion_ = false;
+    bool memory_planning_ = false;
+    bool huge_pages_ = false;
+    bool mac_check_enabled_ = false;
+    RoundScheduler<ShrType> scheduler_;
+    ParallelExecutor<ShrType> executor_;
+    MemoryPlanner<ShrType> memory_planner_;
+    MacCheck<ShrType> mac_check_;
+    std::unique_ptr<WorkStealingPool> pool_; // only created for more than one thread
     Timer timer_;
+    std::size_t peak_offline_bytes_ = 0;
+    std::size_t peak_online_bytes_ = 0;
+    std::size_t mac_check_bytes_ = 0;
+    Timer mac_check_timer_;
 };
 
 
+template <IsSpdz2kShare ShrType>
+Circuit<ShrType>::~Circuit() {
+    // A gate only refers to gates created before it, so releasing the newest gate first
+    // never destroys a long chain of gates recursively through their input wires
+    endpoints_.clear();
+    while (!gates_.empty()) {
+        gates_.pop_back();
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+template <typename GateType, typename... Args>
+std::shared_ptr<GateType> Circuit<ShrType>::makeGate(Args&&... args) {
+    auto gate = std::allocate_shared<GateType>(std::pmr::polymorphic_allocator<GateType>(&gate_arena_),
+                                               std::forward<Args>(args)...);
+    gates_.push_back(gate);
+    plan_outdated_ = true;
+    return gate;
+}
+
+template <IsSpdz2kShare ShrType>
+const ExecutionPlan<Gate<ShrType>>& Circuit<ShrType>::plan() {
+    if (plan_outdated_) {
+        plan_.Build(gates_, endpoints_);
+        FuseGates(plan_, endpoints_, fusion_); // before the scheduling, since it moves the outputs
+        scheduler_.Build(plan_);
+        if (memory_planning_) {
+            memory_planner_.Build(plan_, scheduler_.start_layers(), endpoints_, huge_pages_);
+        }
+        else {
+            memory_planner_.Clear();
+        }
+        if (pool_) {
+            executor_.Build(plan_, memory_planning_ ? &memory_planner_ : nullptr);
+        }
+        plan_outdated_ = false;
+    }
+    return plan_;
+}
+
+
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::addEndpoint(const std::shared_ptr<Gate<ShrType>>& gate) {
     endpoints_.push_back(gate);
+    plan_outdated_ = true;
 }
 
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::runOffline() {
-
-    for (const auto& gate : endpoints_) {
-        gate->RunOffline();
+    for (const auto& node : plan()) {
+        node.gate->RunOffline();
     }
-
 }
 
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::readOfflineFromFile() {
-    for (const auto& gate : endpoints_) {
-        gate->readOfflineFromFile();
+    ResetPeakResident();
+    for (const auto& node : plan()) {
+        node.gate->readOfflineFromFile();
     }
+    peak_offline_bytes_ = PeakResidentBytes();
 }
 
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::runOnline() {
-    for (const auto& gate : endpoints_) {
-        gate->RunOnline();
+    plan(); // the scheduler is built together with the plan
+    // The openings of all gates in the same layer are merged into one exchange
+    // The bytes sent by the exchanges are measured as they went on the wire, framing included
+    auto memory_planner = memory_planning_ ? &memory_planner_ : nullptr;
+    auto online_bytes_before = party_.bytes_sent();
+    if (pool_) {
+        executor_.Run(party_, *pool_, memory_planner);
+    }
+    else {
+        scheduler_.Run(party_, memory_planner);
+    }
+    party_.comm_actual_ = party_.bytes_sent() - online_bytes_before;
+
+    if (mac_check_enabled_) {
+        mac_check_timer_.start();
+        auto bytes_before = party_.bytes_sent();
+        for (const auto& node : plan_) {
+            node.gate->CollectOpenings(mac_check_);
+        }
+        mac_check_.Check(party_);
+        mac_check_bytes_ = party_.bytes_sent() - bytes_before;
+        mac_check_timer_.stop();
     }
 }
 
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::runOnlineWithBenckmark() {
+    ResetPeakResident();
     timer_.start();
     runOnline();
     timer_.stop();
+    peak_online_bytes_ = PeakResidentBytes();
+}
+
+template <IsSpdz2kShare ShrType>
+void Circuit<ShrType>::setNumThreads(std::size_t num_threads) {
+    if (num_threads > 1) {
+        pool_ = std::make_unique<WorkStealingPool>(num_threads);
+    }
+    else {
+        pool_.reset();
+    }
+    plan_outdated_ = true; // the task graph of the executor is built together with the plan
+}
+
+template <IsSpdz2kShare ShrType>
+void Circuit<ShrType>::setFusion(bool enabled) {
+    fusion_ = enabled;
+    plan_outdated_ = true;
+}
+
+template <IsSpdz2kShare ShrType>
+void Circuit<ShrType>::setMemoryPlanning(bool enabled, bool huge_pages) {
+    memory_planning_ = enabled;
+    huge_pages_ = huge_pages;
+    plan_outdated_ = true;
+}
+
+template <IsSpdz2kShare ShrType>
+void Circuit<ShrType>::setMacCheck(bool enabled) {
+    mac_check_enabled_ = enabled;
 }
 
 template <IsSpdz2kShare ShrType>
 void Circuit<ShrType>::printStats() {
     std::cout
         << "Spent " << timer_.elapsed() << " ms\n"
-        << "Sent " << party_.bytes_sent() << " bytes\n";
+        << "Sent " << party_.bytes_sent() << " bytes\n"
+        << "Ran " << rounds() << " rounds\n"
+        << "Peak memory " << peak_offline_bytes_ << " bytes offline, " << peak_online_bytes_ << " bytes online\n";
+    if (memory_planning_) {
+        std::cout << "Planned " << memory_planner_.planned_bytes() << " bytes of Delta buffers in "
+                  << memory_planner_.num_slabs() << " slabs, instead of " << memory_planner_.unplanned_bytes()
+                  << " bytes\n";
+    }
+    if (mac_check_enabled_) {
+        std::cout << "Checked " << mac_check_.num_checked() << " MACs in " << mac_check_timer_.elapsed() << " ms, "
+                  << mac_check_rounds() << " rounds and " << mac_check_bytes_ << " bytes\n";
+    }
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<InputGate<ShrType>> Circuit<ShrType>::
 input(std::size_t owner_id, std::size_t dim_row, std::size_t dim_col) {
-    auto gate = std::make_shared<InputGate<ShrType>>(party_, dim_row, dim_col, owner_id);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<InputGate<ShrType>>(party_, dim_row, dim_col, owner_id);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<AddGate<ShrType>> Circuit<ShrType>::
 add(const std::shared_ptr<Gate<ShrType>>& input_x, const std::shared_ptr<Gate<ShrType>>& input_y) {
-    auto gate = std::make_shared<AddGate<ShrType>>(input_x, input_y);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<AddGate<ShrType>>(input_x, input_y);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<SubtractGate<ShrType>> Circuit<ShrType>::
 subtract(const std::shared_ptr<Gate<ShrType>>& input_x,
          const std::shared_ptr<Gate<ShrType>>& input_y) {
-    auto gate = std::make_shared<SubtractGate<ShrType>>(input_x, input_y);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<SubtractGate<ShrType>>(input_x, input_y);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<AddConstantGate<ShrType>> Circuit<ShrType>::
 addConstant(const std::shared_ptr<Gate<ShrType>>& input_x,
             ClearType constant) {
-    auto gate = std::make_shared<AddConstantGate<ShrType>>(input_x, constant);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<AddConstantGate<ShrType>>(input_x, constant);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<MultiplyGate<ShrType>> Circuit<ShrType>::
 multiply(const std::shared_ptr<Gate<ShrType>>& input_x,
          const std::shared_ptr<Gate<ShrType>>& input_y) {
-    auto gate = std::make_shared<MultiplyGate<ShrType>>(input_x, input_y);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<MultiplyGate<ShrType>>(input_x, input_y);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<OutputGate<ShrType>> Circuit<ShrType>::
 output(const std::shared_ptr<Gate<ShrType>>& input) {
-    auto gate = std::make_shared<OutputGate<ShrType>>(input);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<OutputGate<ShrType>>(input);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<MultiplyTruncGate<ShrType>> Circuit<ShrType>::
 multiplyTrunc(const std::shared_ptr<Gate<ShrType>>& input_x,
               const std::shared_ptr<Gate<ShrType>>& input_y) {
-    auto gate = std::make_shared<MultiplyTruncGate<ShrType>>(input_x, input_y);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<MultiplyTruncGate<ShrType>>(input_x, input_y);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<ElemMultiplyGate<ShrType>> Circuit<ShrType>::
 elementMultiply(const std::shared_ptr<Gate<ShrType>>& input_x,
                 const std::shared_ptr<Gate<ShrType>>& input_y) {
-    auto gate = std::make_shared<ElemMultiplyGate<ShrType>>(input_x, input_y);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<ElemMultiplyGate<ShrType>>(input_x, input_y);
 }
 
 template <IsSpdz2kShare ShrType>
@@ -210,9 +376,7 @@ std::shared_ptr<Conv2DGate<ShrType>> Circuit<ShrType>::
 conv2D(const std::shared_ptr<Gate<ShrType>>& input_x,
        const std::shared_ptr<Gate<ShrType>>& input_y,
        const Conv2DOp& op) {
-    auto gate = std::make_shared<Conv2DGate<ShrType>>(input_x, input_y, op);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<Conv2DGate<ShrType>>(input_x, input_y, op);
 }
 
 template <IsSpdz2kShare ShrType>
@@ -220,34 +384,33 @@ std::shared_ptr<Conv2DTruncGate<ShrType>> Circuit<ShrType>::
 conv2DTrunc(const std::shared_ptr<Gate<ShrType>>& input_x,
             const std::shared_ptr<Gate<ShrType>>& input_y,
             const Conv2DOp& op) {
-    auto gate = std::make_shared<Conv2DTruncGate<ShrType>>(input_x, input_y, op);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<Conv2DTruncGate<ShrType>>(input_x, input_y, op);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<AvgPool2DGate<ShrType>> Circuit<ShrType>::
 avgPool2D(const std::shared_ptr<Gate<ShrType>>& input_x,
           const MaxPoolOp& op) {
-    auto gate = std::make_shared<AvgPool2DGate<ShrType>>(input_x, op);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<AvgPool2DGate<ShrType>>(input_x, op);
+}
+
+template <IsSpdz2kShare ShrType>
+std::shared_ptr<MaxPool2DGate<ShrType>> Circuit<ShrType>::
+maxPool2D(const std::shared_ptr<Gate<ShrType>>& input_x,
+          const MaxPoolOp& op) {
+    return makeGate<MaxPool2DGate<ShrType>>(input_x, op);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<GtzGate<ShrType>> Circuit<ShrType>::
-gtz(const std::shared_ptr<Gate<ShrType>>& input_x) {
-    auto gate = std::make_shared<GtzGate<ShrType>>(input_x);
-    gates_.push_back(gate);
-    return gate;
+gtz(const std::shared_ptr<Gate<ShrType>>& input_x, std::size_t num_bits, std::size_t radix) {
+    return makeGate<GtzGate<ShrType>>(input_x, num_bits, radix);
 }
 
 template <IsSpdz2kShare ShrType>
 std::shared_ptr<ReLUGate<ShrType>> Circuit<ShrType>::
 relu(const std::shared_ptr<Gate<ShrType>>& input_x) {
-    auto gate = std::make_shared<ReLUGate<ShrType>>(input_x);
-    gates_.push_back(gate);
-    return gate;
+    return makeGate<ReLUGate<ShrType>>(input_x);
 }
 
 
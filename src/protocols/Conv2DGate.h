@@ -3,9 +3,9 @@
 #ifndef BIOAUTH_CONV2DGATE_H
 #define BIOAUTH_CONV2DGATE_H
 
+#include <span>
 #include <memory>
 #include <vector>
-#include <thread>
 
 #include "protocols/Gate.h"
 #include "share/IsSpdz2kShare.h"
@@ -18,6 +18,7 @@ template <IsSpdz2kShare ShrType>
 class Conv2DGate : public Gate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
 
     Conv2DGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                const std::shared_ptr<Gate<ShrType>>& p_input_y,
@@ -25,17 +26,38 @@ public:
 
     [[nodiscard]] const Conv2DOp& conv_op() const { return conv_op_; }
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
 protected:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
+
+    // The mask of the product, which differs from the mask of the output if the product is truncated
+    [[nodiscard]] virtual const std::vector<SemiShrType>& product_lambda_shr() const { return this->lambda_shr(); }
+    [[nodiscard]] virtual const std::vector<SemiShrType>& product_lambda_shr_mac() const {
+        return this->lambda_shr_mac();
+    }
 
 private:
     Conv2DOp conv_op_;
-    std::vector<SemiShrType> a_shr_, a_shr_mac_;
-    std::vector<SemiShrType> b_shr_, b_shr_mac_;
+
+    // The convolutions are products with the patches of their images (see im2col()), which are extracted once:
+    // the patches of [a] and [a_mac] when the preprocessing data is read, and those of temp_x in each session.
+    // The kernels are stacked with the shares of their MACs, so that the patches of temp_x are read once:
+    // kernel_stacked_ is [temp_y; [b]; [b_mac]] (along the output channels), where temp_y is written in each session.
+    // The images of a batch share the kernels, each product covers all of them (see convolvePatches())
+    std::vector<SemiShrType> a_stacked_; // [a; a_mac], as they are read
+    std::vector<SemiShrType> a_patches_, a_mac_patches_, temp_x_patches_;
+    std::vector<SemiShrType> kernel_stacked_;
     std::vector<SemiShrType> c_shr_, c_shr_mac_;
-    std::vector<SemiShrType> delta_x_clear_;
-    std::vector<SemiShrType> delta_y_clear_;
+    std::vector<ClearType> delta_x_clear_;
+    std::vector<ClearType> delta_y_clear_;
+    std::vector<SemiShrType> Delta_z_opened_; // with the upper bits, which Delta_clear drops
+    std::vector<SemiShrType> Delta_z_stacked_; // [Delta_z; Delta_z_mac], kept between the two halves of the round
+    // Temporaries of the online phase, kept so that later sessions reuse their storage
+    std::vector<SemiShrType> temp_x_, product_, channel_major_;
 };
 
 template <IsSpdz2kShare ShrType>
@@ -54,90 +76,104 @@ void Conv2DGate<ShrType>::doReadOfflineFromFile() {
     auto size_rhs = conv_op_.compute_kernel_size();
     auto size_output = conv_op_.compute_output_size();
 
-    a_shr_ = this->party().ReadShares(size_lhs);
-    a_shr_mac_ = this->party().ReadShares(size_lhs);
-    b_shr_ = this->party().ReadShares(size_rhs);
-    b_shr_mac_ = this->party().ReadShares(size_rhs);
-    c_shr_ = this->party().ReadShares(size_output);
-    c_shr_mac_ = this->party().ReadShares(size_output);
-    this->lambda_shr() = this->party().ReadShares(size_output);
-    this->lambda_shr_mac() = this->party().ReadShares(size_output);
-    delta_x_clear_ = this->party().ReadShares(size_lhs);
-    delta_y_clear_ = this->party().ReadShares(size_rhs);
+    // The shares and their MACs are stored one after the other, so they are read as they are
+    a_stacked_.resize(2 * size_lhs);
+    this->party().ReadShares(std::span<SemiShrType>(a_stacked_));
+    kernel_stacked_.resize(3 * size_rhs);
+    this->party().ReadShares(std::span<SemiShrType>(kernel_stacked_).subspan(size_rhs));
+    this->party().ReadShares(c_shr_, size_output);
+    this->party().ReadShares(c_shr_mac_, size_output);
+    this->party().ReadShares(this->lambda_shr(), size_output);
+    this->party().ReadShares(this->lambda_shr_mac(), size_output);
+    this->party().ReadClear(delta_x_clear_, size_lhs);
+    this->party().ReadClear(delta_y_clear_, size_rhs);
+
+    // [a] and [a_mac] are only used through their patches
+    auto [patch_rows, patch_cols] = conv_op_.compute_input_matrix_shape();
+    a_patches_.resize(patch_rows * patch_cols);
+    a_mac_patches_.resize(patch_rows * patch_cols);
+    im2col(a_stacked_.data(), a_patches_.data(), conv_op_);
+    im2col(a_stacked_.data() + size_lhs, a_mac_patches_.data(), conv_op_);
 }
 
 template <IsSpdz2kShare ShrType>
-void Conv2DGate<ShrType>::doRunOnline() {
+void Conv2DGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
+    auto size_rhs = conv_op_.compute_kernel_size();
+    auto size_output = conv_op_.compute_output_size();
+    auto num_kernels = conv_op_.kernel_shape_[0];
+    auto [patch_rows, patch_cols] = conv_op_.compute_input_matrix_shape();
+
     // temp_x = $\Delta_x + \delta_x$
-    auto temp_x = matrixAdd(this->input_x()->Delta_clear(), delta_x_clear_);
-    // temp_y = $\Delta_y + \delta_y$
-    auto temp_y = matrixAdd(this->input_y()->Delta_clear(), delta_y_clear_);
-    // temp_xy = temp_x * temp_y
-    auto temp_xy = convolution(temp_x, temp_y, conv_op_);
+    matrixTransform(temp_x_, std::plus<SemiShrType>(), this->input_x()->Delta_clear(), delta_x_clear_);
+    // temp_y = $\Delta_y + \delta_y$, written before [b] and [b_mac]
+    std::span<SemiShrType> temp_y(kernel_stacked_.data(), size_rhs);
+    matrixTransform(temp_y, std::plus<SemiShrType>(), this->input_y()->Delta_clear(), delta_y_clear_);
+
+    // [temp_xy; temp_x * [b]; temp_x * [b_mac]] = [temp_y; [b]; [b_mac]] * patches(temp_x)
+    temp_x_patches_.resize(patch_rows * patch_cols);
+    im2col(temp_x_.data(), temp_x_patches_.data(), conv_op_);
+    product_.resize(3 * size_output);
+    convolvePatches(kernel_stacked_.data(), 3 * num_kernels, temp_x_patches_.data(), product_.data(), channel_major_,
+                    conv_op_);
+    std::span<const SemiShrType> temp_xy(product_.data(), size_output);
+    std::span<const SemiShrType> temp_x_b(product_.data() + size_output, size_output);
+    std::span<const SemiShrType> temp_x_b_mac(product_.data() + 2 * size_output, size_output);
+
+    // [a] * temp_y and [a_mac] * temp_y, written where [Delta_z] and [Delta_z_mac] are computed below
+    Delta_z_stacked_.resize(2 * size_output);
+    std::span<SemiShrType> Delta_z_shr(Delta_z_stacked_.data(), size_output);
+    std::span<SemiShrType> Delta_z_mac(Delta_z_stacked_.data() + size_output, size_output);
+    convolvePatches(temp_y.data(), num_kernels, a_patches_.data(), Delta_z_shr.data(), channel_major_, conv_op_);
+    convolvePatches(temp_y.data(), num_kernels, a_mac_patches_.data(), Delta_z_mac.data(), channel_major_, conv_op_);
 
     // Compute [Delta_z] according to the paper
-    // [Delta_z] = [c] + [lambda_z]
-    auto Delta_z_shr = matrixAdd(c_shr_, this->lambda_shr());
-    // [Delta_z] -= [a] * temp_y
-    matrixSubtractAssign(Delta_z_shr,
-                         convolution(a_shr_, temp_y, conv_op_));
-    // [Delta_z] -= temp_x * [b]
-    matrixSubtractAssign(Delta_z_shr,
-                         convolution(temp_x, b_shr_, conv_op_));
+    // [Delta_z] = [c] + [lambda_z] (+ temp_xy for party 0) - [a] * temp_y - temp_x * [b]
     if (this->my_id() == 0) {
-        // [Delta_z] += temp_xy
-        matrixAddAssign(Delta_z_shr, temp_xy);
+        matrixTransform(Delta_z_shr,
+                        [](SemiShrType c, SemiShrType lambda, SemiShrType xy, SemiShrType ay, SemiShrType xb) {
+                            return c + lambda + xy - ay - xb;
+                        },
+                        c_shr_, product_lambda_shr(), temp_xy, Delta_z_shr, temp_x_b);
+    }
+    else {
+        matrixTransform(Delta_z_shr,
+                        [](SemiShrType c, SemiShrType lambda, SemiShrType ay, SemiShrType xb) {
+                            return c + lambda - ay - xb;
+                        },
+                        c_shr_, product_lambda_shr(), Delta_z_shr, temp_x_b);
     }
+    // [Delta_z_mac] = temp_xy * [key] + [c_mac] + [lambda_z_mac] - [a_mac] * temp_y - temp_x * [b_mac]
+    matrixTransform(Delta_z_mac,
+                    [key = static_cast<SemiShrType>(this->party().global_key_shr())](
+                        SemiShrType xy, SemiShrType c_mac, SemiShrType lambda_mac, SemiShrType ay_mac,
+                        SemiShrType xb_mac) {
+                        return xy * key + c_mac + lambda_mac - ay_mac - xb_mac;
+                    },
+                    temp_xy, c_shr_mac_, product_lambda_shr_mac(), Delta_z_mac, temp_x_b_mac);
+
+    send_buffer.Append(Delta_z_stacked_.data(), size_output);
+}
 
-    // Compute Delta_z_mac according to the paper
-    // [Delta_z_mac] = temp_xy * [key]
-    auto Delta_z_mac = std::move(temp_xy);
-    matrixScalarAssign(Delta_z_mac, this->party().global_key_shr());
-    // [Delta_z_mac] += [c_mac] + [lambda_z_mac]
-    matrixAddAssign(Delta_z_mac,
-                       matrixAdd(c_shr_mac_, this->lambda_shr_mac()));
-    // [Delta_z_mac] -= [a_mac] * temp_y
-    matrixSubtractAssign(Delta_z_mac,
-                        convolution(a_shr_mac_, temp_y, conv_op_));
-    // [Delta_z_mac] -= temp_x * [b_mac]
-    matrixSubtractAssign(Delta_z_mac,
-                        convolution(temp_x, b_shr_mac_, conv_op_));
-
-    std::thread t1([&, this] {
-        this->party().SendVecToOther(Delta_z_shr);
-    });
-
-    std::thread t2([&, this] {
-        this->Delta_clear() = this->party().template ReceiveVecFromOther<
-            SemiShrType>(this->dim_row() * this->dim_col());
-    });
-
-    t1.join();
-    t2.join();
-
-    matrixAddAssign(this->Delta_clear(), Delta_z_shr);
-
-    // Since Delta_clear is in ClearType but stored in SemiShrType, we need to remove the upper bits
-    // This is important since it affects the correctness in MultiplyTruncGate!!!
-    ShrType::RemoveUpperBitsInplace(this->Delta_clear());
-
-    // free the spaces of preprocessing data
-    a_shr_.clear();
-    a_shr_.shrink_to_fit();
-    a_shr_mac_.clear();
-    a_shr_mac_.shrink_to_fit();
-    b_shr_.clear();
-    b_shr_.shrink_to_fit();
-    b_shr_mac_.clear();
-    b_shr_mac_.shrink_to_fit();
-    c_shr_.clear();
-    c_shr_.shrink_to_fit();
-    c_shr_mac_.clear();
-    c_shr_mac_.shrink_to_fit();
-    delta_x_clear_.clear();
-    delta_x_clear_.shrink_to_fit();
-    delta_y_clear_.clear();
-    delta_y_clear_.shrink_to_fit();
+template <IsSpdz2kShare ShrType>
+void Conv2DGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    auto size_output = conv_op_.compute_output_size();
+
+    // The opened [Delta_z] keeps all its bits for the MAC check
+    Delta_z_opened_.resize(size_output);
+    receive_buffer.ReadInto(Delta_z_opened_.data(), size_output);
+    matrixTransform(Delta_z_opened_, std::plus<SemiShrType>(), Delta_z_opened_,
+                    std::span<const SemiShrType>(Delta_z_stacked_).first(size_output));
+
+    // Delta_clear keeps the lower K bits, the upper bits must not be shifted into the result of Conv2DTruncGate
+    ShrType::ToClear(Delta_z_opened_, this->Delta_clear());
+
+    // The buffers are kept for the next session
+}
+
+template <IsSpdz2kShare ShrType>
+void Conv2DGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    auto size_output = conv_op_.compute_output_size();
+    mac_check.Add(Delta_z_opened_, std::span<const SemiShrType>(Delta_z_stacked_).subspan(size_output));
 }
 
 }
@@ -6,7 +6,6 @@
 #include <memory>
 #include <vector>
 #include <stdexcept>
-#include <thread>
 
 #include "protocols/Gate.h"
 #include "share/IsSpdz2kShare.h"
@@ -18,20 +17,30 @@ template <IsSpdz2kShare ShrType>
 class ElemMultiplyGate : public Gate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
 
     ElemMultiplyGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                      const std::shared_ptr<Gate<ShrType>>& p_input_y);
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
 protected:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
 
 private:
     std::vector<SemiShrType> a_shr_, a_shr_mac_;
     std::vector<SemiShrType> b_shr_, b_shr_mac_;
     std::vector<SemiShrType> c_shr_, c_shr_mac_;
-    std::vector<SemiShrType> delta_x_clear_;
-    std::vector<SemiShrType> delta_y_clear_;
+    std::vector<ClearType> delta_x_clear_;
+    std::vector<ClearType> delta_y_clear_;
+    std::vector<SemiShrType> Delta_z_opened_; // with the upper bits, which Delta_clear drops
+    std::vector<SemiShrType> Delta_z_shr_; // kept between the two halves of the round
+
+    // Temporaries of the online phase, kept so that later sessions reuse their storage
+    std::vector<SemiShrType> Delta_z_mac_;
 };
 
 template <IsSpdz2kShare ShrType>
@@ -52,90 +61,67 @@ template <IsSpdz2kShare ShrType>
 void ElemMultiplyGate<ShrType>::doReadOfflineFromFile() {
     auto size = this->dim_row() * this->dim_col();
 
-    a_shr_ = this->party().ReadShares(size);
-    a_shr_mac_ = this->party().ReadShares(size);
-    b_shr_ = this->party().ReadShares(size);
-    b_shr_mac_ = this->party().ReadShares(size);
-    c_shr_ = this->party().ReadShares(size);
-    c_shr_mac_ = this->party().ReadShares(size);
-    this->lambda_shr() = this->party().ReadShares(size);
-    this->lambda_shr_mac() = this->party().ReadShares(size);
-    delta_x_clear_ = this->party().ReadShares(size);
-    delta_y_clear_ = this->party().ReadShares(size);
+    this->party().ReadShares(a_shr_, size);
+    this->party().ReadShares(a_shr_mac_, size);
+    this->party().ReadShares(b_shr_, size);
+    this->party().ReadShares(b_shr_mac_, size);
+    this->party().ReadShares(c_shr_, size);
+    this->party().ReadShares(c_shr_mac_, size);
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
+    this->party().ReadClear(delta_x_clear_, size);
+    this->party().ReadClear(delta_y_clear_, size);
 }
 
 template <IsSpdz2kShare ShrType>
-void ElemMultiplyGate<ShrType>::doRunOnline() {
-    // temp_x = $\Delta_x + \delta_x$
-    auto temp_x = matrixAdd(this->input_x()->Delta_clear(), delta_x_clear_);
-    // temp_y = $\Delta_y + \delta_y$
-    auto temp_y = matrixAdd(this->input_y()->Delta_clear(), delta_y_clear_);
-    // temp_xy = temp_x * temp_y
-    auto temp_xy = matrixElemMultiply(temp_x, temp_y);
-
-    // Compute [Delta_z] according to the paper
-    // [Delta_z] = [c] + [lambda_z]
-    auto Delta_z_shr = matrixAdd(c_shr_, this->lambda_shr());
-    // [Delta_z] -= [a] * temp_y
-    matrixSubtractAssign(Delta_z_shr,
-                         matrixElemMultiply(a_shr_, temp_y));
-    // [Delta_z] -= temp_x * [b]
-    matrixSubtractAssign(Delta_z_shr,
-                         matrixElemMultiply(temp_x, b_shr_));
-    if (this->my_id() == 0) {
-        // [Delta_z] += temp_xy
-        matrixAddAssign(Delta_z_shr, temp_xy);
-    }
+void ElemMultiplyGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
+    // With temp_x = $\Delta_x + \delta_x$ and temp_y = $\Delta_y + \delta_y$, according to the paper
+    // [Delta_z] = [c] + [lambda_z] - [a] * temp_y - temp_x * [b] (+ temp_x * temp_y for party 0)
+    // [Delta_z_mac] = temp_x * temp_y * [key] + [c_mac] + [lambda_z_mac] - [a_mac] * temp_y - temp_x * [b_mac]
+    // Everything is element-wise, so each of them is computed in a single pass without temporaries
+    const auto& Delta_x_clear = this->input_x()->Delta_clear();
+    const auto& Delta_y_clear = this->input_y()->Delta_clear();
+    bool is_party_0 = this->my_id() == 0;
+    auto key = static_cast<SemiShrType>(this->party().global_key_shr());
+
+    matrixTransform(Delta_z_shr_,
+                    [is_party_0](SemiShrType Delta_x, SemiShrType delta_x, SemiShrType Delta_y, SemiShrType delta_y,
+                                 SemiShrType a, SemiShrType b, SemiShrType c, SemiShrType lambda) {
+                        auto temp_x = Delta_x + delta_x;
+                        auto temp_y = Delta_y + delta_y;
+                        auto result = c + lambda - a * temp_y - temp_x * b;
+                        return is_party_0 ? result + temp_x * temp_y : result;
+                    },
+                    Delta_x_clear, delta_x_clear_, Delta_y_clear, delta_y_clear_, a_shr_, b_shr_, c_shr_, this->lambda_shr());
+    matrixTransform(Delta_z_mac_,
+                    [key](SemiShrType Delta_x, SemiShrType delta_x, SemiShrType Delta_y, SemiShrType delta_y,
+                          SemiShrType a_mac, SemiShrType b_mac, SemiShrType c_mac, SemiShrType lambda_mac) {
+                        auto temp_x = Delta_x + delta_x;
+                        auto temp_y = Delta_y + delta_y;
+                        return temp_x * temp_y * key + c_mac + lambda_mac - a_mac * temp_y - temp_x * b_mac;
+                    },
+                    Delta_x_clear, delta_x_clear_, Delta_y_clear, delta_y_clear_, a_shr_mac_, b_shr_mac_, c_shr_mac_,
+                    this->lambda_shr_mac());
+
+    send_buffer.Append(Delta_z_shr_);
+}
+
+template <IsSpdz2kShare ShrType>
+void ElemMultiplyGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    // The opened [Delta_z] keeps all its bits for the MAC check
+    Delta_z_opened_.resize(Delta_z_shr_.size());
+    receive_buffer.ReadInto(Delta_z_opened_.data(), Delta_z_shr_.size());
+    matrixAddAssign(Delta_z_opened_, Delta_z_shr_);
+
+    // Delta_clear keeps the lower K bits, the upper bits must not be shifted into the result of MultiplyTruncGate
+    ShrType::ToClear(Delta_z_opened_, this->Delta_clear());
 
-    // Compute Delta_z_mac according to the paper
-    // [Delta_z_mac] = temp_xy * [key]
-    auto Delta_z_mac = std::move(temp_xy);
-    matrixScalarAssign(Delta_z_mac, this->party().global_key_shr());
-    // [Delta_z_mac] += [c_mac] + [lambda_z_mac]
-    matrixAddAssign(Delta_z_mac, c_shr_mac_);
-    matrixAddAssign(Delta_z_mac, this->lambda_shr_mac());
-    // [Delta_z_mac] -= [a_mac] * temp_y
-    matrixSubtractAssign(Delta_z_mac,
-                         matrixElemMultiply(a_shr_mac_, temp_y));
-    // [Delta_z_mac] -= temp_x * [b_mac]
-    matrixSubtractAssign(Delta_z_mac,
-                         matrixElemMultiply(temp_x, b_shr_mac_));
-
-    std::thread t1([&, this] {
-        this->party().SendVecToOther(Delta_z_shr);
-    });
-
-    std::thread t2([&, this] {
-        this->Delta_clear() = this->party().template ReceiveVecFromOther<
-            SemiShrType>(this->dim_row() * this->dim_col());
-    });
-
-    t1.join();
-    t2.join();
-
-    matrixAddAssign(this->Delta_clear(), Delta_z_shr);
-
-    // Since Delta_clear is in ClearType but stored in SemiShrType, we need to remove the upper bits
-    // This is important since it affects the correctness in MultiplyTruncGate!!!
-    ShrType::RemoveUpperBitsInplace(this->Delta_clear());
-
-    // free the spaces of preprocessing data
-    a_shr_.clear();
-    a_shr_.shrink_to_fit();
-    a_shr_mac_.clear();
-    a_shr_mac_.shrink_to_fit();
-    b_shr_.clear();
-    b_shr_.shrink_to_fit();
-    b_shr_mac_.clear();
-    b_shr_mac_.shrink_to_fit();
-    c_shr_.clear();
-    c_shr_.shrink_to_fit();
-    c_shr_mac_.clear();
-    c_shr_mac_.shrink_to_fit();
-    delta_x_clear_.clear();
-    delta_x_clear_.shrink_to_fit();
-    delta_y_clear_.clear();
-    delta_y_clear_.shrink_to_fit();
+    // The buffers are kept for the next session
+}
+
+template <IsSpdz2kShare ShrType>
+void ElemMultiplyGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    mac_check.Add(Delta_z_opened_, Delta_z_mac_);
 }
 
 } // bioauth
@@ -5,10 +5,13 @@
 
 #include <vector>
 #include <memory>
+#include <stdexcept>
 
 #include "networking/Party.h"
+#include "networking/MessageBuffer.h"
 #include "share/IsSpdz2kShare.h"
 #include "protocols/PartyWithFakeOffline.h"
+#include "protocols/MacCheck.h"
 
 
 namespace bioauth {
@@ -26,10 +29,32 @@ public:
 
     virtual ~Gate() = default;
 
+    // Each phase only processes this gate, the circuit replays them in the order of its execution plan.
+    // The inputs of the gate must have been processed before.
     void RunOffline();
     void readOfflineFromFile();
     void RunOnline();
 
+    // Round-by-round evaluation of the online phase, driven by the round scheduler of the circuit.
+    // In each round, the gate appends its message to send_buffer, and after the exchange,
+    // reads the message of the other party from receive_buffer (in the same order).
+    void PrepareRound(std::size_t round, MessageBuffer& send_buffer);
+    void FinishRound(std::size_t round, MessageBuffer& receive_buffer);
+
+    /// Adds the values opened in the last run, with the shares of their MACs, to the deferred MAC check
+    void CollectOpenings(MacCheck<ShrType>& mac_check) const;
+
+    /// The number of communication rounds of the online phase, 0 for local gates (e.g., addition)
+    [[nodiscard]] virtual std::size_t num_rounds() const { return 0; }
+
+    /// The size of the message of the other party in the given round, given the size of the own message.
+    /// Both parties send messages of the same size unless the gate overrides this.
+    [[nodiscard]] virtual std::size_t receive_size(std::size_t, std::size_t send_size) const { return send_size; }
+
+    /// Whether the rounds only use the preprocessing data of the inputs, not their online values,
+    /// in which case the scheduler may start the rounds in the first layer
+    [[nodiscard]] virtual bool rounds_use_only_preprocessing() const { return false; }
+
     [[nodiscard]] auto& party() { return party_; }
 
     [[nodiscard]] std::size_t my_id() const { return party_.my_id(); }
@@ -37,8 +62,8 @@ public:
     [[nodiscard]] std::size_t dim_row() const { return dim_row_; }
     [[nodiscard]] std::size_t dim_col() const { return dim_col_; }
 
-    [[nodiscard]] auto input_x() { return input_x_; }
-    [[nodiscard]] auto input_y() { return input_y_; }
+    [[nodiscard]] auto input_x() const { return input_x_; }
+    [[nodiscard]] auto input_y() const { return input_y_; }
 
     [[nodiscard]] const std::vector<SemiShrType>& lambda_shr() const { return lambda_shr_; }
     [[nodiscard]] std::vector<SemiShrType>& lambda_shr() { return lambda_shr_; }
@@ -46,8 +71,8 @@ public:
     [[nodiscard]] const std::vector<SemiShrType>& lambda_shr_mac() const { return lambda_shr_mac_; }
     [[nodiscard]] std::vector<SemiShrType>& lambda_shr_mac() { return lambda_shr_mac_; }
 
-    [[nodiscard]] const std::vector<SemiShrType>& Delta_clear() const { return Delta_clear_; }
-    [[nodiscard]] std::vector<SemiShrType>& Delta_clear() { return Delta_clear_; }
+    [[nodiscard]] const std::vector<ClearType>& Delta_clear() const { return Delta_clear_; }
+    [[nodiscard]] std::vector<ClearType>& Delta_clear() { return Delta_clear_; }
 
 protected:
     void set_dim_row(std::size_t p_dim_row) { dim_row_ = p_dim_row; }
@@ -56,11 +81,13 @@ protected:
 private:
     virtual void doRunOffline() { throw std::runtime_error("Offline Phase is not implemented."); }
     virtual void doReadOfflineFromFile() = 0;
-    virtual void doRunOnline() = 0;
 
-    bool evaluated_offline_ = false;
-    bool evaluated_online_ = false;
-    bool read_offline_ = false;
+    // Local gates override doRunOnline(), interactive gates override the round functions instead.
+    // The default doRunOnline() runs the rounds one by one, each with its own exchange.
+    virtual void doRunOnline();
+    virtual void doPrepareRound(std::size_t round, MessageBuffer& send_buffer);
+    virtual void doFinishRound(std::size_t round, MessageBuffer& receive_buffer);
+    virtual void doCollectOpenings(MacCheck<ShrType>&) const {} // Gates without MACs open nothing to check
 
     PartyWithFakeOffline<ShrType>& party_;
 
@@ -75,7 +102,7 @@ private:
 
     std::vector<SemiShrType> lambda_shr_;
     std::vector<SemiShrType> lambda_shr_mac_;
-    std::vector<SemiShrType> Delta_clear_; // We store it as SemiShrType for convienence, but it's actually ClearType
+    std::vector<ClearType> Delta_clear_; // public, so it is stored (and sent) in Z_2^K
 };
 
 
@@ -91,53 +118,63 @@ Gate<ShrType>::Gate(const std::shared_ptr<Gate>& p_input_x, const std::shared_pt
 
 template <IsSpdz2kShare ShrType>
 void Gate<ShrType>::RunOffline() {
-    if (this->evaluated_offline_)
-        return;
+    this->doRunOffline();
+}
 
-    
-    if (input_x_ && !input_x_->evaluated_offline_)
-        input_x_->RunOffline();
-    if (input_y_ && !input_y_->evaluated_offline_)
-        input_y_->RunOffline();
 
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::readOfflineFromFile() {
+    this->doReadOfflineFromFile();
+}
 
 
-    this->doRunOffline();
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::RunOnline() {
+    this->doRunOnline();
+}
 
 
-    this->evaluated_offline_ = true;
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::PrepareRound(std::size_t round, MessageBuffer& send_buffer) {
+    this->doPrepareRound(round, send_buffer);
 }
 
 
 template <IsSpdz2kShare ShrType>
-void Gate<ShrType>::readOfflineFromFile() {
-    if (this->read_offline_)
-        return;
-
-    if (input_x_ && !input_x_->read_offline_)
-        input_x_->readOfflineFromFile();
-    if (input_y_ && !input_y_->read_offline_)
-        input_y_->readOfflineFromFile();
+void Gate<ShrType>::FinishRound(std::size_t round, MessageBuffer& receive_buffer) {
+    this->doFinishRound(round, receive_buffer);
+}
 
-    this->doReadOfflineFromFile();
 
-    this->read_offline_ = true;
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::CollectOpenings(MacCheck<ShrType>& mac_check) const {
+    this->doCollectOpenings(mac_check);
 }
 
 
 template <IsSpdz2kShare ShrType>
-void Gate<ShrType>::RunOnline() {
-    if (this->evaluated_online_)
-        return;
+void Gate<ShrType>::doRunOnline() {
+    MessageBuffer send_buffer, receive_buffer;
+    for (std::size_t round = 0; round < this->num_rounds(); ++round) {
+        send_buffer.Clear();
+        this->doPrepareRound(round, send_buffer);
 
-    if (input_x_ && !input_x_->evaluated_online_)
-        input_x_->RunOnline();
-    if (input_y_ && !input_y_->evaluated_online_)
-        input_y_->RunOnline();
+        party_.ExchangeWithOther(send_buffer, receive_buffer, this->receive_size(round, send_buffer.size()));
+
+        this->doFinishRound(round, receive_buffer);
+    }
+}
 
-    this->doRunOnline();
 
-    this->evaluated_online_ = true;
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::doPrepareRound(std::size_t, MessageBuffer&) {
+    throw std::logic_error("The gate does not communicate in the online phase");
+}
+
+
+template <IsSpdz2kShare ShrType>
+void Gate<ShrType>::doFinishRound(std::size_t, MessageBuffer&) {
+    throw std::logic_error("The gate does not communicate in the online phase");
 }
 
 }
@@ -0,0 +1,125 @@
+#ifndef BIOAUTH_GATEFUSION_H
+#define BIOAUTH_GATEFUSION_H
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+
+#include "share/IsSpdz2kShare.h"
+#include "utils/ExecutionPlan.h"
+#include "protocols/Gate.h"
+#include "protocols/LinearGate.h"
+#include "protocols/OutputGate.h"
+
+
+namespace bioauth {
+
+/// The fusion pass of a circuit, run on its execution plan whenever the plan is rebuilt.
+/// 1. A chain of linear gates (e.g., additions), whose intermediate results are only used inside the chain,
+///    is evaluated by its last gate in a single pass over the inputs of the chain,
+///    so the intermediate Deltas are never written. The other gates of the chain are skipped.
+/// 2. An output gate opens lambda_x in the first round, together with the input gates,
+///    instead of in a round of its own after its input is computed.
+/// Fused and unfused circuits compute the same values, but both parties must use the same setting,
+/// since the second rule changes the layer of the messages.
+/// With `enabled` false, the pass undoes a previous fusion.
+/// Returns the number of gates removed from the online phase.
+template <IsSpdz2kShare ShrType>
+std::size_t FuseGates(const ExecutionPlan<Gate<ShrType>>& plan,
+                      const std::vector<std::shared_ptr<Gate<ShrType>>>& endpoints,
+                      bool enabled) {
+    using ClearType = typename ShrType::ClearType;
+    using Term = typename LinearGate<ShrType>::Term;
+    constexpr auto kNoInput = ExecutionPlan<Gate<ShrType>>::kNoInput;
+
+    const auto& nodes = plan.nodes();
+    auto as_linear = [](Gate<ShrType>* gate) { return dynamic_cast<LinearGate<ShrType>*>(gate); };
+
+    for (const auto& node : nodes) {
+        if (auto linear = as_linear(node.gate)) {
+            linear->Unfuse();
+        }
+        else if (auto output = dynamic_cast<OutputGate<ShrType>*>(node.gate)) {
+            output->set_reveal_early(enabled);
+        }
+    }
+    if (!enabled) {
+        return 0;
+    }
+
+    // The number of uses of each gate, an endpoint counts as a use from outside the circuit
+    std::vector<std::size_t> num_uses(nodes.size(), 0);
+    std::vector<std::size_t> consumer(nodes.size(), kNoInput);
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+        for (auto wire : {nodes[idx].input_x, nodes[idx].input_y}) {
+            if (wire != kNoInput) {
+                ++num_uses[wire];
+                consumer[wire] = idx;
+            }
+        }
+    }
+    std::unordered_set<const Gate<ShrType>*> endpoint_set;
+    for (const auto& endpoint : endpoints) {
+        endpoint_set.insert(endpoint.get());
+    }
+
+    // A linear gate is absorbed into its consumer if that is its only use and the consumer is linear too
+    std::vector<bool> absorbed(nodes.size(), false);
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+        absorbed[idx] = as_linear(nodes[idx].gate) && num_uses[idx] == 1 && !endpoint_set.contains(nodes[idx].gate)
+                        && as_linear(nodes[consumer[idx]].gate);
+    }
+
+    // The linear form of each gate in terms of the gates that are not absorbed, in topological order
+    std::vector<std::vector<Term>> forms(nodes.size());
+    std::vector<ClearType> constants(nodes.size(), 0);
+    std::vector<Term> own_terms;
+    std::size_t num_skipped = 0;
+
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+        const auto& node = nodes[idx];
+        auto linear = as_linear(node.gate);
+        if (!linear) {
+            continue;
+        }
+
+        auto& form = forms[idx];
+        auto add_term = [&form](Gate<ShrType>* gate, ClearType coefficient) {
+            auto it = std::ranges::find(form, gate, &Term::gate);
+            if (it == form.end()) form.push_back({gate, coefficient});
+            else it->coefficient += coefficient;
+        };
+
+        own_terms.clear();
+        linear->AppendLinearForm(own_terms, constants[idx]);
+        bool absorbs_input = false;
+        for (const auto& [gate, coefficient] : own_terms) {
+            auto wire = gate == node.gate->input_x().get() ? node.input_x : node.input_y;
+            if (wire != kNoInput && absorbed[wire]) {
+                for (const auto& term : forms[wire]) {
+                    add_term(term.gate, coefficient * term.coefficient);
+                }
+                constants[idx] += coefficient * constants[wire];
+                absorbs_input = true;
+            }
+            else {
+                add_term(gate, coefficient);
+            }
+        }
+
+        if (absorbed[idx]) {
+            linear->set_skipped(true);
+            ++num_skipped;
+        }
+        else if (absorbs_input) {
+            linear->FuseChain(form, constants[idx]);
+        }
+    }
+
+    return num_skipped;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_GATEFUSION_H
@@ -0,0 +1,75 @@
+#ifndef BIOAUTH_GATHERGATE_H
+#define BIOAUTH_GATHERGATE_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "protocols/Gate.h"
+#include "share/IsSpdz2kShare.h"
+#include "utils/linear_algebra.h"
+
+namespace bioauth {
+
+/// A local gate that rearranges the elements of its inputs, z[i] = x[x_index[i]] + y[y_index[i]],
+/// or x[x_index[i]] - y[y_index[i]] with `subtract`, where y is left out if y_index[i] is kNoIndex.
+/// Both Delta and lambda are combined in the same way, so the gate needs no preprocessing data of its own.
+/// It is a building block of the composite gates, e.g., MaxPool2DGate.
+template <IsSpdz2kShare ShrType>
+class GatherGate : public Gate<ShrType> {
+public:
+    using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
+
+    GatherGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, std::vector<std::size_t> x_index,
+               const std::shared_ptr<Gate<ShrType>>& p_input_y = nullptr, std::vector<std::size_t> y_index = {},
+               bool subtract = false);
+
+private:
+    void doReadOfflineFromFile() override;
+    void doRunOnline() override;
+
+    std::vector<std::size_t> x_index_, y_index_;
+    bool subtract_;
+
+    // The inputs without a y, whose y_index_ is all kNoIndex
+    std::vector<ClearType> no_input_clear_;
+    std::vector<SemiShrType> no_input_shr_;
+};
+
+template <IsSpdz2kShare ShrType>
+GatherGate<ShrType>::
+GatherGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, std::vector<std::size_t> x_index,
+           const std::shared_ptr<Gate<ShrType>>& p_input_y, std::vector<std::size_t> y_index, bool subtract)
+    : Gate<ShrType>(p_input_x, p_input_y), x_index_(std::move(x_index)), y_index_(std::move(y_index)),
+      subtract_(subtract) {
+    if (!p_input_y) {
+        y_index_.assign(x_index_.size(), kNoIndex);
+    }
+    if (y_index_.size() != x_index_.size()) {
+        throw std::invalid_argument("The indices of gather gate should have the same size");
+    }
+    this->set_dim_row(x_index_.size());
+    this->set_dim_col(1);
+}
+
+template <IsSpdz2kShare ShrType>
+void GatherGate<ShrType>::doReadOfflineFromFile() {
+    // $[\lambda_z] = [\lambda_x]$ rearranged (plus or minus $[\lambda_y]$), nothing is read
+    const auto& lambda_y_shr = this->input_y() ? this->input_y()->lambda_shr() : no_input_shr_;
+    const auto& lambda_y_shr_mac = this->input_y() ? this->input_y()->lambda_shr_mac() : no_input_shr_;
+    matrixGather(this->input_x()->lambda_shr(), x_index_, lambda_y_shr, y_index_, subtract_, this->lambda_shr());
+    matrixGather(this->input_x()->lambda_shr_mac(), x_index_, lambda_y_shr_mac, y_index_, subtract_,
+                 this->lambda_shr_mac());
+}
+
+template <IsSpdz2kShare ShrType>
+void GatherGate<ShrType>::doRunOnline() {
+    const auto& Delta_y = this->input_y() ? this->input_y()->Delta_clear() : no_input_clear_;
+    matrixGather(this->input_x()->Delta_clear(), x_index_, Delta_y, y_index_, subtract_, this->Delta_clear());
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_GATHERGATE_H
@@ -3,440 +3,698 @@
 #ifndef GTZGATE_H
 #define GTZGATE_H
 
+#include <span>
+#include <array>
 #include <memory>
 #include <vector>
-#include <bitset>
-#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
 
 #include "protocols/Gate.h"
 #include "share/IsSpdz2kShare.h"
 #include "utils/linear_algebra.h"
+#include "utils/bit_slicing.h"
+#include "utils/carry_circuit.h"
+#include "utils/crypto.h"
 
 
 namespace bioauth {
 
+/// [x >= 0] by a carry circuit on the bits of Delta_x and the boolean shares of lambda_x.
+/// The comparisons are bit-sliced (see bit_slicing.h): each bit of the carry circuit is a plane of words
+/// that holds it for 64 comparisons, so a level of the circuit takes a few word operations per 64 comparisons,
+/// and the values opened by a level are its planes, sent as they are.
+/// The boolean shares carry MACs of kBitMacBits bits, which are never sent: the sigma of each opening
+/// (see MacCheck) is hashed level by level, and the digest is checked with the other openings of the circuit.
+/// So a level sends one bit per opened value, two per AND.
+/// Only the lower num_bits bits are compared, which gives the sign of x when -2^(num_bits - 1) <= x < 2^(num_bits - 1):
+/// the carry circuit of k bits takes k - 1 pairs of ANDs in ceil(log2(k)) rounds.
+/// With a radix r above 2, each level combines r bits at once by multi-input ANDs (see CarryGroupTriple), which takes
+/// ceil(log_r(k)) rounds and opens 2r - 1 bits per group, for 2^(r + 1) - 2r - 2 products of masks per group
+/// in the preprocessing. Fewer rounds pay off when the round trips dominate, as on a WAN.
+/// The bit triples and multi-input triples are read from the preprocessing with their MACs, bit-sliced as
+/// the carry circuit takes them (see carry_circuit.h).
+/// The result is never opened: it is masked by a daBit, a random bit r shared both in binary and in the ring,
+/// and c = result ^ r is opened, from which [result] = c + [r] - 2c[r] in the ring. The Delta of the result is then
+/// opened with all the bits of its shares, and its MAC is checked with the other openings of the circuit.
+/// The remaining gap is the preprocessing: the triples, the daBits and the boolean shares of lambda_x are dealt by
+/// fake-offline, which knows them all, instead of being generated by the parties, e.g., by OT extension.
 template <IsSpdz2kShare ShrType>
 class GtzGate : public Gate<ShrType> {
 public:
     using ClearType = typename ShrType::ClearType;
     using SemiShrType = typename ShrType::SemiShrType;
 
-    explicit GtzGate(const std::shared_ptr<Gate<ShrType>>& p_input_x);
+    static constexpr std::size_t kMaxBits = ShrType::kBits; // the sign of a value of Z_2^K is bit K - 1
+    static constexpr std::size_t kMaxRadix = 8;
+
+    explicit GtzGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, std::size_t num_bits = kMaxBits,
+                     std::size_t radix = 2);
+
+    // The carry circuit takes one round per level, then the result and Delta are opened
+    [[nodiscard]] std::size_t num_rounds() const override { return num_levels_ + 2; }
+
+    [[nodiscard]] std::size_t num_bits() const { return num_bits_; }
+    [[nodiscard]] std::size_t radix() const { return radix_; }
 
 private:
+    // The words of a chunk of the products of a group, whose products of the opened values fit in the cache
+    static constexpr std::size_t kChunkWords = 16;
+
     void doReadOfflineFromFile() override;
 
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
 
-    // template <typename T>
-    // bool CarryOutAux(std::bitset<sizeof(T) * 8> p,
-    //                  std::bitset<sizeof(T) * 8> g, int k);
+    void BitLT(const std::vector<ClearType>& pInt, // output s = (pInt < sInt) on the bits below the top one
+               const std::vector<ClearType>& sInt);
 
-    std::vector<bool> BitLT(std::vector<ClearType>& pInt, // output s = (pInt < sInt)
-                            std::vector<ClearType>& sInt);
+    void CarryOutCin(bool cIn); // from the planes of a<-delta_x in p_, b<-lambda_xBinShr in g_
 
-    std::vector<bool> CarryOutCin(std::vector<std::bitset<sizeof(ClearType) * 8>>& aIn,
-                                  std::vector<std::bitset<sizeof(ClearType) * 8>>& bIn,
-                                  bool cIn); // a<-delta_x, b<-lambda_xBinShr
+    // One level of the carry circuit, k bits, (p2,g2)*(p1,g1) = (p2p1,g2+p2g1)
+    void CarryOutAuxSend(std::size_t level, MessageBuffer& send_buffer);
+    void CarryOutAuxReceive(std::size_t level, MessageBuffer& receive_buffer);
 
-    std::vector<bool> CarryOutAux(std::vector<std::bitset<sizeof(ClearType) * 8>> p,
-                                  std::vector<std::bitset<sizeof(ClearType) * 8>> g,
-                                  int k); // k bits, (p2,g2)*(p1,g1) = (p2p1,g2+p2g1)
+    // One level of the carry circuit of a higher radix, each group of r bits becomes one:
+    // P = p_{r-1} ... p_0, G = g_{r-1} + sum_j p_{r-1} ... p_{j+1} g_j
+    void CarryOutRadixSend(std::size_t level, MessageBuffer& send_buffer);
+    void CarryOutRadixReceive(std::size_t level, MessageBuffer& receive_buffer);
 
-    std::vector<ClearType> lambda_xBinShr;
+    // Adds a product of the inputs of a group to out and its MACs to out_mac, on a chunk of count words
+    // from the word begin, see CarryGroupTriple
+    void AddGroupProduct(const CarryGroupTriple& triple, uint32_t product, const uint64_t* open,
+                         std::size_t triple_plane, std::size_t begin, std::size_t count,
+                         uint64_t* out, std::vector<uint64_t>& out_mac, std::size_t out_plane);
+    [[nodiscard]] std::size_t num_radix_groups() const { return (k_ + radix_ - 1) / radix_; }
+    [[nodiscard]] std::size_t radix_group_bits(std::size_t group) const {
+        return std::min(radix_, k_ - group * radix_);
+    }
+
+    // Appends the lower bits of the planes of opened_, one bit per comparison,
+    // and xors those of the other party into them, which opens them
+    void AppendOpened(MessageBuffer& send_buffer, std::size_t num_planes) const;
+    void ReceiveOpened(MessageBuffer& receive_buffer, std::size_t num_planes);
+
+    // Hashes the sigma planes of the openings, without the lanes past the last comparison
+    void HashSigma(std::size_t num_planes);
 
-    // Binary Triples, we currently fake them as (0, 0, 0)
-    bool a = false;
-    bool b = false;
-    bool c = false;
+    // Plane s of the MACs of a plane
+    [[nodiscard]] uint64_t* mac_plane(std::vector<uint64_t>& macs, std::size_t plane, std::size_t bit) const {
+        return macs.data() + (plane * kBitMacBits + bit) * num_words_;
+    }
+
+    [[nodiscard]] std::size_t num_comparisons() const { return this->dim_row() * this->dim_col(); }
+
+    std::size_t num_bits_;
+    std::size_t radix_;
+    std::size_t num_levels_;
+
+    std::vector<ClearType> lambda_xBinShr;
+    std::vector<uint64_t> lambda_xBinMac; // the MACs of the bits of lambda_xBinShr, bit-sliced
+
+    // The state of the carry circuit between the rounds, bit b of comparison i is bit i % 64 of
+    // the word [b * num_words_ + i / 64] of each plane, and the MACs of plane b are planes
+    // [b * kBitMacBits, (b + 1) * kBitMacBits) of mac_p_ and mac_g_
+    std::vector<uint64_t> p_, g_, mac_p_, mac_g_;
+    std::size_t num_words_ = 0;
+    std::size_t k_ = 0;
+    std::vector<uint64_t> msb_, msb_mac_; // the share of msb(lambda_x), xor msb(Delta_x) for party 0, and its MAC
+    std::vector<uint64_t> opened_; // the masked values opened in the current round
+    std::vector<uint64_t> received_; // a plane of the other party's shares of opened_
+    std::vector<SemiShrType> Delta_shr_, Delta_mac_shr_; // the share of Delta of the result and of its MAC
+    std::vector<SemiShrType> Delta_opened_; // Delta of the result with all the bits of the shares
+
+    // The daBits that mask the result: the bits r, bit-sliced with their MACs, and their shares in the ring
+    std::vector<uint64_t> r_bin_, r_bin_mac_;
+    std::vector<SemiShrType> r_shr_, r_shr_mac_;
+
+    std::array<uint64_t, kBitMacBits> key_masks_{}; // see bitMacKeyMasks()
+    std::vector<uint64_t> sigma_;
+    Sha256 sigma_hash_;
+    Sha256::Digest sigma_digest_{};
+    std::size_t num_bit_openings_ = 0;
+
+    // The triples of the carry circuit and their MACs, bit-sliced, level by level and pair by pair (or group by group)
+    std::vector<uint64_t> triples_, triple_macs_;
+    std::vector<std::size_t> level_planes_; // the first plane of the triples of each level
+    std::vector<CarryGroupTriple> group_triples_; // the multi-input triples of the groups, by their bits
+    std::vector<uint64_t> e_products_; // the products of the opened values of a product of a group, on a chunk
 };
 
 
 template <IsSpdz2kShare ShrType>
 GtzGate<ShrType>::
-GtzGate(const std::shared_ptr<Gate<ShrType>>& p_input_x)
-    : Gate<ShrType>(p_input_x, nullptr) {
+GtzGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, std::size_t num_bits, std::size_t radix)
+    : Gate<ShrType>(p_input_x, nullptr), num_bits_(num_bits), radix_(radix) {
+    if (num_bits == 0 || num_bits > kMaxBits) {
+        throw std::invalid_argument("The bit length of GtzGate should be between 1 and the bits of the ring");
+    }
+    if (radix < 2 || radix > kMaxRadix) {
+        throw std::invalid_argument("The radix of GtzGate should be between 2 and 8");
+    }
     this->set_dim_row(p_input_x->dim_row());
     this->set_dim_col(p_input_x->dim_col());
+    num_words_ = bitSliceWords(num_comparisons());
+    received_.assign(num_words_, 0);
+
+    const auto levels = carryLevels(num_bits, radix);
+    num_levels_ = levels.size();
+    level_planes_.assign(1, 0);
+    for (auto k : levels) {
+        auto units = carryUnits(k, radix);
+        level_planes_.push_back(level_planes_.back());
+        for (auto t : units) {
+            level_planes_.back() += carryUnitPlanes(t, radix);
+        }
+    }
+    if (radix > 2) {
+        group_triples_.resize(radix + 1);
+        for (std::size_t t = 2; t <= radix; ++t) {
+            group_triples_[t] = carryGroupTriple(t);
+        }
+        e_products_.resize((std::size_t(1) << radix) * kChunkWords);
+    }
 }
 
 template <IsSpdz2kShare ShrType>
 void GtzGate<ShrType>::doReadOfflineFromFile() {
     auto size = this->dim_row() * this->dim_col();
 
-    this->lambda_shr() = this->party().ReadShares(size);
-    this->lambda_shr_mac() = this->party().ReadShares(size);
-    lambda_xBinShr = this->party().ReadClear(size);
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
+    this->party().ReadClear(lambda_xBinShr, size);
+    this->party().ReadWords(lambda_xBinMac, num_bits_ * kBitMacBits * num_words_);
+
+    // The triples, each followed by its MACs
+    triples_.resize(level_planes_.back() * num_words_);
+    triple_macs_.resize(level_planes_.back() * kBitMacBits * num_words_);
+    std::size_t plane = 0;
+    for (auto k : carryLevels(num_bits_, radix_)) {
+        for (auto t : carryUnits(k, radix_)) {
+            const auto num_planes = carryUnitPlanes(t, radix_);
+            this->party().ReadWords(std::span<uint64_t>(triples_.data() + plane * num_words_, num_planes * num_words_));
+            this->party().ReadWords(std::span<uint64_t>(mac_plane(triple_macs_, plane, 0),
+                                                        num_planes * kBitMacBits * num_words_));
+            plane += num_planes;
+        }
+    }
+
+    // The daBits
+    this->party().ReadWords(r_bin_, num_words_);
+    this->party().ReadWords(r_bin_mac_, kBitMacBits * num_words_);
+    this->party().ReadShares(r_shr_, size);
+    this->party().ReadShares(r_shr_mac_, size);
 }
 
 template <IsSpdz2kShare ShrType>
-void GtzGate<ShrType>::doRunOnline() {
-#ifndef NDEBUG
-    //        std::cout << "\nGtzGate Online\n";
-    //        std::cout << "lambdaShr:";
-    //        printVector(this->lambdaShr);
-    //        std::cout << "deltaClear:";
-    //        printVector(this->deltaClear);
-    //        std::cout << "lambda_xBinShr:";
-    //        printVector(this->lambda_xBinShr);
-#endif
-
-    // const auto& delta_x_semiShr = this->input_x->getDeltaClear();
-    const auto& delta_x_semiShr = this->input_x()->Delta_clear(); // By ybs
-
-    std::vector<ClearType> delta_x(delta_x_semiShr.begin(), delta_x_semiShr.end());
-    auto ret = BitLT(delta_x, this->lambda_xBinShr);
-    if (this->my_id() == 0) {
-        std::transform(ret.begin(), ret.end(), ret.begin(), std::logical_not<>());
-    }
-
-#ifndef NDEBUG
-    //        std::cout << "delta_x: ";
-    //        printVector(delta_x);
-    //        std::cout << "Lambda_xBinShr: ";
-    //        printVector(this->lambda_xBinShr);
-    //        std::cout << "Ret value of BitLT:";
-    //        printVector(ret);
-#endif
-
-    //TODO: this is fake
-
-    int msgBytes = (ret.size() + 7) / 8; // round up
-    //        std::vector<std::bitset<sizeof(uint8_t) * 8>> sendmsg(msgBytes, 0);
-    //        std::vector<std::bitset<sizeof(uint8_t) * 8>> rcvmsg(msgBytes, 0);
-
-    std::vector<uint8_t> sendmsg(msgBytes, 0);
-    // std::vector<uint8_t> rcvmsg(msgBytes, 0);
-    std::vector<uint8_t> rcvmsg; // By ybs
-    int vec_loc, bit_loc;
-    for (int j = 0; j < ret.size(); ++j) {
-        vec_loc = j / 8;
-        bit_loc = j % 8;
-        sendmsg[vec_loc] += ret[j] << bit_loc; //[p1] -[a]
-    }
-#ifndef NDEBUG
-    std::cout << "GtzGate open ret value, size: " << sendmsg.size() << "\n";
-#endif
-    // std::thread t1([this, &sendmsg]() { this->getParty()->getNetwork().send(1 - this->myId(), sendmsg); });
-    // std::thread t2(
-    //     [this, &rcvmsg] { this->getParty()->getNetwork().rcv(1 - this->myId(), &rcvmsg, rcvmsg.size()); });
-    std::thread t1([this, &sendmsg] { this->party().SendVecToOther(sendmsg); }); // By ybs
-    std::thread t2(
-        [this, &rcvmsg, msgBytes] {
-            rcvmsg = this->party().template ReceiveVecFromOther<uint8_t>(msgBytes);
-        }); // By ybs
-    t1.join();
-    t2.join();
-
-    std::vector<bool> rcv(ret.size());
-    for (int j = 0; j < rcv.size(); ++j) {
-        vec_loc = j / 8;
-        bit_loc = j % 8;
-        rcv[j] = std::bitset<sizeof(uint8_t) * 8>(rcvmsg[vec_loc])[bit_loc]; //[p1] -[a]
-    }
-
-
-    std::vector<SemiShrType> zShr(ret.size(), 0);
-
-    if (this->my_id() == 0) {
-        std::transform(ret.begin(), ret.end(), rcv.begin(), zShr.begin(), std::bit_xor<>());
-    }
-
-    // this->deltaClear = matrixAdd(this->lambdaShr, zShr);
-    this->Delta_clear() = matrixAdd(this->lambda_shr(), zShr); // By ybs
-    std::vector<SemiShrType> deltaRcv(zShr.size());
-
-#ifndef NDEBUG
-    // std::cout << "GtzGate open deltaClear, size: " << this->deltaClear.size() << "\n";
-    std::cout << "GtzGate open deltaClear, size: " << this->Delta_clear().size() << "\n";
-#endif
-    // std::thread t3([this]() { this->getParty()->getNetwork().send(1 - this->myId(), this->deltaClear); });
-    // std::thread t4([this, &deltaRcv]() {
-    //     this->getParty()->getNetwork().rcv(1 - this->myId(), &deltaRcv, deltaRcv.size());
-    // });
-
-    // By ybs begin
-    auto size = zShr.size();
-    std::thread t3([this] { this->party().SendVecToOther(this->Delta_clear()); });
-    std::thread t4(
-        [this, &deltaRcv, size] {
-            deltaRcv = this->party().template ReceiveVecFromOther<SemiShrType>(size);
-        });
-    // By ybs end
-
-    t3.join();
-    t4.join();
-
-    // matrixAddAssign(this->deltaClear, deltaRcv);
-    matrixAddAssign(this->Delta_clear(), deltaRcv); // By ybs
+void GtzGate<ShrType>::doPrepareRound(std::size_t round, MessageBuffer& send_buffer) {
+    if (round == 0) {
+        BitLT(this->input_x()->Delta_clear(), this->lambda_xBinShr);
+    }
+
+    if (round < num_levels_ && radix_ == 2) {
+        CarryOutAuxSend(round, send_buffer);
+    }
+    else if (round < num_levels_) {
+        CarryOutRadixSend(round, send_buffer);
+    }
+    else if (round == num_levels_) {
+        // The sign of x = Delta_x - lambda_x is msb(Delta_x) ^ msb(lambda_x) ^ (the borrow out of the lower bits),
+        // the borrow is the complement of the carry g[0] and the result is the complement of the sign,
+        // so the result is g[0] ^ msb, which is opened masked by r
+        opened_.resize(num_words_);
+        for (std::size_t word = 0; word < num_words_; ++word) {
+            opened_[word] = g_[word] ^ msb_[word] ^ r_bin_[word];
+        }
+        AppendOpened(send_buffer, 1);
+    }
+    else {
+        // All the bits of the shares are sent for the MAC check
+        send_buffer.Append(Delta_shr_.data(), Delta_shr_.size());
+    }
 }
 
 
-// template <IsSpdz2kShare ShrType>
-// template <typename T>
-// bool GtzGate<ShrType>::
-// CarryOutAux(std::bitset<sizeof(T) * 8> p, std::bitset<sizeof(T) * 8> g, int k) {
-//     //k bits, (p2,g2)*(p1,g1) = (p2p1,g2+p2g1)
-//     if (k > 1) {
-//         int u_len = k / 2; // round down bit length, if k%2=1, push back the last one bit at the end
-//         std::bitset<sizeof(T) * 8> u_p, u_g;
-//         // compute u[k/2..1] = (d[2k] * d[2k-1],...)---- compute p2*p1 and g2*p1 need 2 triples
-//         // (k/2)*2 triples per invocation
-//         int numTriples = u_len * 2; //parallel g.size() comparisons
-//         //prepare beaver's triples
-//         //[alpha] = [x] - [a]
-//         //[beta] = [y] - [b]
-//         // open alpha, beta
-//         // compute [z] = [c] + alpha*[b] + beta*[a] + alpha*beta
-//
-//         // each triple sholud send alpha, beta -- 2 bits
-//         int msgBytes = (numTriples * 2 + 7) / 8; // round up
-//         //            std::vector<std::bitset<sizeof(uint8_t)*8>> sendmsg(msgBytes,0);
-//         //            std::vector<std::bitset<sizeof(uint8_t)*8>> rcvmsg(msgBytes,0);
-//
-//         std::vector<uint8_t> sendmsg(msgBytes, 0);
-//         std::vector<uint8_t> rcvmsg(msgBytes, 0);
-//         int vec_loc, bit_loc;
-//         int index_triple = 0;
-//         // load the msg
-//         for (int j = 0; j < u_len; ++j) {
-//             vec_loc = index_triple * 2 / 8;
-//             bit_loc = (index_triple * 2) % 8;
-//             index_triple++;
-//             sendmsg[vec_loc] += (p[2 * j] ^ a) << bit_loc; //[p1] -[a]
-//             sendmsg[vec_loc] += (p[2 * j + 1] ^ b) << (bit_loc + 1); //[p2] -[b]
-//             vec_loc = index_triple * 2 / 8;
-//             bit_loc = (index_triple * 2) % 8;
-//             index_triple++;
-//             sendmsg[vec_loc] = (g[2 * j] ^ a) << bit_loc; //[g1] -[a]
-//             sendmsg[vec_loc] = (p[2 * j + 1] ^ b) << (bit_loc + 1); //[p2] -[b]
-//         }
-//         //send & rcv
-//         //send numTriples, sendmsg; receive numTriples rcvmsg
-//         std::thread t1([this, &sendmsg]() {
-//             this->party->getNetwork().send(1 - this->myId(), sendmsg);
-//         });
-//         std::thread t2([this, &rcvmsg]() {
-//             this->party->getNetwork().rcv(1 - this->myId(), &rcvmsg, rcvmsg.size());
-//         });
-//         t1.join();
-//         t2.join();
-//         //#ifndef NDEBUG
-//         //            std::cout<<"sendmsg: ";printVector(sendmsg);
-//         //            std::cout<<"rcvmsg: "; printVector(rcvmsg);
-//         //#endif
-//         //compute
-//         bool alpha, beta, z, x_, y_;
-//         index_triple = 0;
-//         for (int j = 0; j < u_len; ++j) {
-//             // compute u_p, u_g
-//             vec_loc = index_triple * 2 / 8;
-//             bit_loc = (index_triple * 2) % 8;
-//             index_triple++;
-//             alpha = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc] ^ std::bitset<sizeof(uint8_t) *
-//                 8>(rcvmsg[vec_loc])[bit_loc]; // alpha = p1 -a
-//             beta = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc + 1] ^ std::bitset<sizeof(uint8_t) *
-//                 8>(rcvmsg[vec_loc])[bit_loc + 1]; // beta = p2 - b
-//             x_ = p[2 * j], y_ = p[2 * j + 1]; //x_ -- p1, y_ -- p2
-//             z = c ^ (alpha & y_) ^ (beta & x_); // z = p1p2
-//             if (this->myId() == 0) z ^= (alpha & beta);
-//             u_p[j] = z;
-//             vec_loc = index_triple * 2 / 8;
-//             bit_loc = (index_triple * 2) % 8;
-//             index_triple++;
-//             alpha = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc] ^ std::bitset<sizeof(uint8_t) *
-//                 8>(rcvmsg[vec_loc])[bit_loc]; // open g1 -a
-//             beta = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc + 1] ^ std::bitset<sizeof(uint8_t) *
-//                 8>(rcvmsg[vec_loc])[bit_loc + 1]; // open  p2 -b
-//             x_ = g[2 * j], y_ = p[2 * j + 1]; // x_ -- g1 y_ -- p2
-//             z = c ^ (alpha & y_) ^ (beta & x_); // z = p2g1
-//             if (this->myId() == 0) z ^= (alpha & beta);
-//             u_g[j] = g[2 * j + 1] ^ z; // u_g = g2 + p2g1
-//         }
-//         if (index_triple < numTriples) std::cout << "triples amount error\n";
-//         if (k % 2 == 1) {
-//             u_len += 1;
-//             for (int i = 0; i < p.size(); ++i) {
-//                 u_p[i][u_len] = p[i][k - 1];
-//                 u_g[i][u_len] = g[i][k - 1];
-//             }
-//         }
-//         auto ret = CarryOutAux(u_p, u_g, u_len); // u_len : bit length
-//         return ret;
-//     }
-//     else {
-//         return g[0]; // Actcually only care g[..][0]
-//     }
-// }
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::doFinishRound(std::size_t round, MessageBuffer& receive_buffer) {
+    if (round < num_levels_ && radix_ == 2) {
+        CarryOutAuxReceive(round, receive_buffer);
+    }
+    else if (round < num_levels_) {
+        CarryOutRadixReceive(round, receive_buffer);
+    }
+    else if (round == num_levels_) {
+        ReceiveOpened(receive_buffer, 1);
+
+        // The MAC of the opened c is that of g[0] ^ msb ^ r
+        sigma_.resize(kBitMacBits * num_words_);
+        for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+            const auto* mac_g = mac_plane(mac_g_, 0, bit);
+            const auto* mac_msb = msb_mac_.data() + bit * num_words_;
+            const auto* mac_r = r_bin_mac_.data() + bit * num_words_;
+            for (std::size_t word = 0; word < num_words_; ++word) {
+                sigma_[bit * num_words_ + word] = mac_g[word] ^ mac_msb[word] ^ mac_r[word]
+                                                  ^ (opened_[word] & key_masks_[bit]);
+            }
+        }
+        HashSigma(kBitMacBits);
+        num_bit_openings_ += num_comparisons();
+        sigma_digest_ = sigma_hash_.Final();
+
+        // [result] = c + [r] - 2c[r], i.e., [r] if c = 0 and 1 - [r] if c = 1, and its MAC c[alpha] + (1 - 2c)[m_r],
+        // added to [lambda] and its MAC
+        const SemiShrType one = static_cast<uint64_t>(this->my_id() == 0);
+        const auto key = static_cast<SemiShrType>(this->party().global_key_shr());
+        const auto& lambda_shr = this->lambda_shr();
+        const auto& lambda_shr_mac = this->lambda_shr_mac();
+        Delta_shr_.resize(num_comparisons());
+        Delta_mac_shr_.resize(num_comparisons());
+        for (std::size_t j = 0; j < num_comparisons(); ++j) {
+            if ((opened_[j / 64] >> (j % 64)) & 1) {
+                Delta_shr_[j] = lambda_shr[j] + one - r_shr_[j];
+                Delta_mac_shr_[j] = lambda_shr_mac[j] + key - r_shr_mac_[j];
+            }
+            else {
+                Delta_shr_[j] = lambda_shr[j] + r_shr_[j];
+                Delta_mac_shr_[j] = lambda_shr_mac[j] + r_shr_mac_[j];
+            }
+        }
+    }
+    else {
+        Delta_opened_.resize(Delta_shr_.size());
+        receive_buffer.ReadInto(Delta_opened_.data(), Delta_opened_.size());
+        matrixAddAssign(Delta_opened_, Delta_shr_);
+        ShrType::ToClear(Delta_opened_, this->Delta_clear());
+    }
+}
 
 
 template <IsSpdz2kShare ShrType>
-std::vector<bool> GtzGate<ShrType>::
-BitLT(std::vector<ClearType>& pInt, std::vector<ClearType>& sInt) {
-    // output s = (pInt < sInt)
-    std::vector<std::bitset<sizeof(ClearType) * 8>> b_(sInt.size());
-    std::vector<std::bitset<sizeof(ClearType) * 8>> a_(pInt.size());
-    for (int i = 0; i < sInt.size(); ++i) {
-        if (this->my_id() == 0) b_[i] = ~sInt[i]; //b_[i][j] = 1 - b[i][j]
-        else b_[i] = sInt[i];
-        a_[i] = pInt[i];
-    }
-    auto s = CarryOutCin(a_, b_, 1);
-    for (int i = 0; i < s.size(); ++i) {
-        if (this->my_id() == 0) s[i] = 1 ^ s[i]; //s[i] = 1 -s[i]
-    }
-    return s;
+void GtzGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    mac_check.AddBitDigest(sigma_digest_, num_bit_openings_);
+    mac_check.Add(Delta_opened_, Delta_mac_shr_);
 }
 
 
 template <IsSpdz2kShare ShrType>
-std::vector<bool> GtzGate<ShrType>::
-CarryOutCin(std::vector<std::bitset<sizeof(ClearType) * 8>>& aIn,
-            std::vector<std::bitset<sizeof(ClearType) * 8>>& bIn,
-            bool cIn) {
-    //a<-delta_x, b<-lambda_xBinShr
-    std::vector<std::bitset<sizeof(ClearType) * 8>> p(bIn.size());
-    std::vector<std::bitset<sizeof(ClearType) * 8>> g(bIn.size());
-    //compute p[i] = a[i]^b[i], g[i] = a[i]*b[i]
-    int numBits = sizeof(ClearType) * 8;
-    for (int i = 0; i < bIn.size(); ++i) {
-        for (int j = 0; j < numBits; j++) {
-            if (this->my_id() == 0) p[i][j] = aIn[i][j] ^ bIn[i][j];
-            else p[i][j] = bIn[i][j]; //p = a+b -2ab
-            g[i][j] = aIn[i][j] & bIn[i][j]; //g = a*b
+void GtzGate<ShrType>::
+BitLT(const std::vector<ClearType>& pInt, const std::vector<ClearType>& sInt) {
+    // output s = (pInt < sInt) on the bits below the top one, left in g[0] after the carry circuit
+    p_.resize(num_bits_ * num_words_);
+    g_.resize(num_bits_ * num_words_);
+    bitSlice(pInt.data(), pInt.size(), num_bits_, p_.data());
+    bitSlice(sInt.data(), sInt.size(), num_bits_, g_.data());
+    CarryOutCin(true);
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+CarryOutCin(bool cIn) {
+    //a<-delta_x, b<-lambda_xBinShr, b[i][j] = 1 - b[i][j] for party 0
+    const uint64_t flip = this->my_id() == 0 ? ~uint64_t(0) : 0;
+    key_masks_ = bitMacKeyMasks(this->party().bit_key_shr());
+    sigma_hash_ = Sha256();
+    num_bit_openings_ = 0;
+
+    // The MACs, from those of b: a public bit a adds a * [Delta] to the MACs, so
+    // MAC(p) = MAC(b) ^ (1 ^ a) * [Delta], MAC(g) = a * (MAC(b) ^ [Delta]).
+    // The MACs of b are copied into those of g, which are then updated in place, so that the preprocessed MACs
+    // are left as they are for the next session
+    auto* top_a = p_.data() + (num_bits_ - 1) * num_words_;
+    auto* top_b = g_.data() + (num_bits_ - 1) * num_words_;
+    msb_.resize(num_words_);
+    msb_mac_.resize(kBitMacBits * num_words_);
+    for (std::size_t word = 0; word < num_words_; ++word) {
+        msb_[word] = top_b[word] ^ (top_a[word] & flip);
+    }
+    mac_g_.assign(lambda_xBinMac.begin(), lambda_xBinMac.end());
+    mac_p_.resize(mac_g_.size());
+    for (std::size_t plane = 0; plane < num_bits_; ++plane) {
+        const auto* a_bits = p_.data() + plane * num_words_;
+        for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+            const auto key = key_masks_[bit];
+            auto* mac_p = mac_plane(mac_p_, plane, bit);
+            auto* mac_g = mac_plane(mac_g_, plane, bit);
+            if (plane == num_bits_ - 1) {
+                auto* mac_msb = msb_mac_.data() + bit * num_words_;
+                for (std::size_t word = 0; word < num_words_; ++word) {
+                    mac_msb[word] = mac_g[word] ^ (a_bits[word] & key);
+                }
+            }
+            BIOAUTH_SIMD_LOOP
+            for (std::size_t word = 0; word < num_words_; ++word) {
+                auto mac_b_bits = mac_g[word];
+                mac_p[word] = mac_b_bits ^ (~a_bits[word] & key);
+                mac_g[word] = a_bits[word] & (mac_b_bits ^ key);
+            }
         }
     }
-    for (int i = 0; i < bIn.size(); ++i) {
-        g[i][0] = g[i][0] ^ (cIn & p[i][0]); // g1 = g1 + c*p1
+
+    //compute p[i] = a[i]^b[i], g[i] = a[i]*b[i]
+    auto* p = p_.data();
+    auto* g = g_.data();
+    const auto num_plane_words = p_.size();
+    BIOAUTH_SIMD_LOOP
+    for (std::size_t word = 0; word < num_plane_words; ++word) {
+        auto a_bits = p[word];
+        auto b_bits = g[word] ^ flip;
+        p[word] = (a_bits & flip) ^ b_bits; //p = a+b -2ab
+        g[word] = a_bits & b_bits;          //g = a*b
+    }
+
+    // The most significant bit propagates the carry, so the carry out is the borrow out of the lower bits.
+    // With a single bit, it is also the least significant one, which then propagates the carry in
+    for (std::size_t word = 0; word < num_words_; ++word) {
+        top_a[word] = flip;
+        top_b[word] = 0;
+        g_[word] ^= cIn ? p_[word] : 0; // g1 = g1 + c*p1
     }
-    return CarryOutAux(p, g, numBits);
+    for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+        std::fill_n(mac_plane(mac_p_, num_bits_ - 1, bit), num_words_, key_masks_[bit]);
+        std::fill_n(mac_plane(mac_g_, num_bits_ - 1, bit), num_words_, 0);
+        auto* mac_g = mac_plane(mac_g_, 0, bit);
+        const auto* mac_p = mac_plane(mac_p_, 0, bit);
+        for (std::size_t word = 0; word < num_words_; ++word) {
+            mac_g[word] ^= cIn ? mac_p[word] : 0;
+        }
+    }
+    k_ = num_bits_;
 }
 
+
 template <IsSpdz2kShare ShrType>
-std::vector<bool> GtzGate<ShrType>::
-CarryOutAux(std::vector<std::bitset<sizeof(ClearType) * 8>> p,
-            std::vector<std::bitset<sizeof(ClearType) * 8>> g,
-            int k) {
+void GtzGate<ShrType>::
+CarryOutAuxSend(std::size_t level, MessageBuffer& send_buffer) {
     //k bits, (p2,g2)*(p1,g1) = (p2p1,g2+p2g1)
-    if (k > 1) {
-        int u_len = k / 2; // round down bit length, if k%2=1, push back the last one bit at the end
-        std::vector<std::bitset<sizeof(ClearType) * 8>> u_p(p.size(), 0);
-        std::vector<std::bitset<sizeof(ClearType) * 8>> u_g(p.size(), 0);
-        // compute u[k/2..1] = (d[2k] * d[2k-1],...)---- compute p2*p1 and g2*p1 need 2 triples
-        // (k/2)*2 triples per invocation
-        int numTriples = g.size() * u_len * 2; //parallel g.size() comparisons
-        //prepare beaver's triples
-        //[alpha] = [x] - [a]
-        //[beta] = [y] - [b]
-        // open alpha, beta
-        // compute [z] = [c] + alpha*[b] + beta*[a] + alpha*beta
-
-        // each triple should send alpha, beta -- 2 bits
-        int msgBytes = (numTriples * 2 + 7) / 8; // round up
-        std::vector<uint8_t> sendmsg(msgBytes, 0);
-        std::vector<uint8_t> rcvmsg(msgBytes, 0);
-        std::vector<ClearType> sendMacmsg(numTriples * 2, 0);
-        std::vector<ClearType> rcvMacmsg(numTriples * 2, 0);
-        int vec_loc, bit_loc;
-        int index_triple = 0;
-        // load the msg
-        for (int i = 0; i < g.size(); ++i) {
-            // parallel comparison
-            for (int j = 0; j < u_len; ++j) {
-                vec_loc = index_triple * 2 / 8;
-                bit_loc = (index_triple * 2) % 8;
-                index_triple++;
-                sendmsg[vec_loc] += (p[i][2 * j] ^ a) << bit_loc; //[p1] -[a]
-                sendmsg[vec_loc] += (p[i][2 * j + 1] ^ b) << (bit_loc + 1); //[p2] -[b]
-                vec_loc = index_triple * 2 / 8;
-                bit_loc = (index_triple * 2) % 8;
-                index_triple++;
-                sendmsg[vec_loc] += (g[i][2 * j] ^ a) << bit_loc; //[g1] -[a]
-                sendmsg[vec_loc] += (p[i][2 * j + 1] ^ b) << (bit_loc + 1); //[p2] -[b]
+    auto u_len = k_ / 2; // round down bit length, if k%2=1, push back the last one bit at the end
+    // compute u[k/2..1] = (d[2k] * d[2k-1],...)---- compute p2*p1 and g2*p1 need 2 triples
+    // (k/2)*2 triples per invocation
+    //prepare beaver's triples
+    //[alpha] = [x] - [a]
+    //[beta] = [y] - [b]
+    // open alpha, beta
+    // compute [z] = [c] + alpha*[b] + beta*[a] + alpha*beta
+
+    // each triple should send alpha, beta -- 2 bits, four planes per pair of bits
+    opened_.resize(u_len * 4 * num_words_);
+    for (std::size_t j = 0; j < u_len; ++j) {
+        const auto* p1 = p_.data() + 2 * j * num_words_;
+        const auto* p2 = p1 + num_words_;
+        const auto* g1 = g_.data() + 2 * j * num_words_;
+        // the triples (a1, b1, c1) of p2*p1 and (a2, b2, c2) of p2*g1
+        const auto* a1 = triples_.data() + (level_planes_[level] + kCarryPairPlanes * j) * num_words_;
+        const auto* b1 = a1 + num_words_;
+        const auto* a2 = b1 + 2 * num_words_;
+        const auto* b2 = a2 + num_words_;
+        auto* open = opened_.data() + 4 * j * num_words_;
+        BIOAUTH_SIMD_LOOP
+        for (std::size_t word = 0; word < num_words_; ++word) {
+            open[word] = p1[word] ^ a1[word];                  //[p1] -[a1]
+            open[num_words_ + word] = p2[word] ^ b1[word];     //[p2] -[b1]
+            open[2 * num_words_ + word] = g1[word] ^ a2[word]; //[g1] -[a2]
+            open[3 * num_words_ + word] = p2[word] ^ b2[word]; //[p2] -[b2]
+        }
+    }
+    AppendOpened(send_buffer, u_len * 4);
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+CarryOutAuxReceive(std::size_t level, MessageBuffer& receive_buffer) {
+    auto u_len = k_ / 2;
+    ReceiveOpened(receive_buffer, u_len * 4);
+    num_bit_openings_ += num_comparisons() * u_len * 4;
+
+    //compute, u_p[j] and u_g[j] overwrite p[j] and g[j], which have been read by then since j <= 2j
+    const uint64_t party_0 = this->my_id() == 0 ? ~uint64_t(0) : 0;
+    sigma_.resize(4 * kBitMacBits * num_words_);
+    for (std::size_t j = 0; j < u_len; ++j) {
+        const auto* alpha_p = opened_.data() + 4 * j * num_words_; // alpha = p1 -a1
+        const auto* beta_p = alpha_p + num_words_;                   // beta = p2 - b1
+        const auto* alpha_g = beta_p + num_words_;                   // open g1 -a2
+        const auto* beta_g = alpha_g + num_words_;                   // open  p2 -b2
+        const auto triple_plane = level_planes_[level] + kCarryPairPlanes * j;
+
+        // The MACs of the products, [z] = [c] + alpha*[y] + beta*[x] + alpha*beta adds alpha*beta*[Delta],
+        // and the sigma of the openings, MAC([x] - [a]) ^ alpha*[Delta]
+        for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+            const auto key = key_masks_[bit];
+            const auto* mac_p1 = mac_plane(mac_p_, 2 * j, bit);
+            const auto* mac_p2 = mac_plane(mac_p_, 2 * j + 1, bit);
+            const auto* mac_g1 = mac_plane(mac_g_, 2 * j, bit);
+            const auto* mac_g2 = mac_plane(mac_g_, 2 * j + 1, bit);
+            const auto* mac_a1 = mac_plane(triple_macs_, triple_plane, bit);
+            const auto* mac_b1 = mac_plane(triple_macs_, triple_plane + 1, bit);
+            const auto* mac_c1 = mac_plane(triple_macs_, triple_plane + 2, bit);
+            const auto* mac_a2 = mac_plane(triple_macs_, triple_plane + 3, bit);
+            const auto* mac_b2 = mac_plane(triple_macs_, triple_plane + 4, bit);
+            const auto* mac_c2 = mac_plane(triple_macs_, triple_plane + 5, bit);
+            auto* mac_u_p = mac_plane(mac_p_, j, bit);
+            auto* mac_u_g = mac_plane(mac_g_, j, bit);
+            auto* sigma = sigma_.data() + 4 * bit * num_words_;
+            BIOAUTH_SIMD_LOOP
+            for (std::size_t word = 0; word < num_words_; ++word) {
+                sigma[word] = mac_p1[word] ^ mac_a1[word] ^ (alpha_p[word] & key);
+                sigma[num_words_ + word] = mac_p2[word] ^ mac_b1[word] ^ (beta_p[word] & key);
+                sigma[2 * num_words_ + word] = mac_g1[word] ^ mac_a2[word] ^ (alpha_g[word] & key);
+                sigma[3 * num_words_ + word] = mac_p2[word] ^ mac_b2[word] ^ (beta_g[word] & key);
+                auto mac_z = mac_c1[word] ^ (alpha_p[word] & mac_p2[word]) ^ (beta_p[word] & mac_p1[word])
+                             ^ (alpha_p[word] & beta_p[word] & key);
+                auto mac_z_g = mac_c2[word] ^ (alpha_g[word] & mac_p2[word]) ^ (beta_g[word] & mac_g1[word])
+                               ^ (alpha_g[word] & beta_g[word] & key);
+                mac_u_g[word] = mac_g2[word] ^ mac_z_g;
+                mac_u_p[word] = mac_z;
+            }
+        }
+        HashSigma(4 * kBitMacBits);
+
+        const auto* p1 = p_.data() + 2 * j * num_words_;
+        const auto* p2 = p1 + num_words_;
+        const auto* g1 = g_.data() + 2 * j * num_words_;
+        const auto* g2 = g1 + num_words_;
+        const auto* c1 = triples_.data() + (triple_plane + 2) * num_words_;
+        const auto* c2 = triples_.data() + (triple_plane + 5) * num_words_;
+        auto* u_p = p_.data() + j * num_words_;
+        auto* u_g = g_.data() + j * num_words_;
+        for (std::size_t word = 0; word < num_words_; ++word) {
+            auto z = c1[word] ^ (alpha_p[word] & p2[word]) ^ (beta_p[word] & p1[word])
+                     ^ (alpha_p[word] & beta_p[word] & party_0); // z = p1p2
+            auto z_g = c2[word] ^ (alpha_g[word] & p2[word]) ^ (beta_g[word] & g1[word])
+                       ^ (alpha_g[word] & beta_g[word] & party_0); // z = p2g1
+            u_g[word] = g2[word] ^ z_g; // u_g = g2 + p2g1
+            u_p[word] = z;
+        }
+    }
+    if (k_ % 2 == 1) {
+        std::copy_n(p_.data() + (k_ - 1) * num_words_, num_words_, p_.data() + u_len * num_words_);
+        std::copy_n(g_.data() + (k_ - 1) * num_words_, num_words_, g_.data() + u_len * num_words_);
+        std::copy_n(mac_plane(mac_p_, k_ - 1, 0), kBitMacBits * num_words_, mac_plane(mac_p_, u_len, 0));
+        std::copy_n(mac_plane(mac_g_, k_ - 1, 0), kBitMacBits * num_words_, mac_plane(mac_g_, u_len, 0));
+        u_len += 1;
+    }
+    k_ = u_len; // u_len : bit length
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+CarryOutRadixSend(std::size_t level, MessageBuffer& send_buffer) {
+    // Group j combines the bits [j * r, (j + 1) * r), and opens their p and g but the g of the last one,
+    // masked by the masks of its triple. A group of a single bit is passed on as it is
+    std::size_t num_opened = 0;
+    for (auto t : carryUnits(k_, radix_)) {
+        num_opened += 2 * t - 1;
+    }
+
+    opened_.resize(num_opened * num_words_);
+    auto* open = opened_.data();
+    auto triple_plane = level_planes_[level];
+    for (std::size_t group = 0; group < num_radix_groups(); ++group) {
+        const auto t = radix_group_bits(group);
+        if (t == 1) {
+            continue;
+        }
+        for (std::size_t v = 0; v < 2 * t - 1; ++v, open += num_words_) {
+            const auto* x = v < t ? p_.data() + (group * radix_ + v) * num_words_
+                                  : g_.data() + (group * radix_ + v - t) * num_words_;
+            const auto* mask = triples_.data() + (triple_plane + v) * num_words_;
+            BIOAUTH_SIMD_LOOP
+            for (std::size_t word = 0; word < num_words_; ++word) {
+                open[word] = x[word] ^ mask[word];
             }
         }
-        //send & rcv
-        //send numTriples, sendmsg; receive numTriples rcvmsg
-#ifndef NDEBUG
-        std::cout << "GtzGate send p,g triples, size: " << sendmsg.size() << "\n";
-#endif
-        // std::thread t1([this, &sendmsg,&sendMacmsg]() {
-        //     this->party->getNetwork().send(1 - this->myId(), sendmsg);
-        //     this->party->getNetwork().send(1 - this->myId(), sendMacmsg);
-        // });
-        // std::thread t2([this, &rcvmsg,&rcvMacmsg]() {
-        //     this->party->getNetwork().rcv(1 - this->myId(), &rcvmsg, rcvmsg.size());
-        //     this->party->getNetwork().rcv(1 - this->myId(), &rcvMacmsg, rcvMacmsg.size());
-        // });
-
-        std::thread t1([this, &sendmsg, &sendMacmsg] {
-            this->party().SendVecToOther(sendmsg);
-            this->party().SendVecToOther(sendMacmsg);
-        });
-        std::thread t2([this, &rcvmsg, &rcvMacmsg, msgBytes, numTriples] {
-            rcvmsg = this->party().template ReceiveVecFromOther<uint8_t>(msgBytes);
-            rcvMacmsg = this->party().template ReceiveVecFromOther<ClearType>(numTriples * 2);
-        });
-
-        t1.join();
-        t2.join();
-
-        //#ifndef NDEBUG
-        //            std::cout<<"sendmsg: ";printVector(sendmsg);
-        //            std::cout<<"rcvmsg: "; printVector(rcvmsg);
-        //#endif
-        //compute
-        bool alpha, beta, z, x_, y_;
-        index_triple = 0;
-        for (int i = 0; i < g.size(); ++i) {
-            // parallel comparison
-            for (int j = 0; j < u_len; ++j) {
-                // compute u_p, u_g
-                vec_loc = index_triple * 2 / 8;
-                bit_loc = (index_triple * 2) % 8;
-                index_triple++;
-                alpha = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc] ^ std::bitset<sizeof(uint8_t) *
-                    8>(rcvmsg[vec_loc])[bit_loc]; // alpha = p1 -a
-                beta = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc + 1] ^ std::bitset<sizeof(uint8_t) *
-                    8>(rcvmsg[vec_loc])[bit_loc + 1]; // beta = p2 - b
-                x_ = p[i][2 * j], y_ = p[i][2 * j + 1]; //x_ -- p1, y_ -- p2
-                z = c ^ (alpha & y_) ^ (beta & x_); // z = p1p2
-                if (this->my_id() == 0) z ^= (alpha & beta);
-                u_p[i][j] = z;
-                vec_loc = index_triple * 2 / 8;
-                bit_loc = (index_triple * 2) % 8;
-                index_triple++;
-                alpha = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc] ^ std::bitset<sizeof(uint8_t) *
-                    8>(rcvmsg[vec_loc])[bit_loc]; // open p1 -a
-                beta = std::bitset<sizeof(uint8_t) * 8>(sendmsg[vec_loc])[bit_loc + 1] ^ std::bitset<sizeof(uint8_t) *
-                    8>(rcvmsg[vec_loc])[bit_loc + 1]; // open  p2 -b
-                x_ = g[i][2 * j], y_ = p[i][2 * j + 1]; // x_ -- g1 y_ -- p2
-                z = c ^ (alpha & y_) ^ (beta & x_); // z = p2g1
-                if (this->my_id() == 0) z ^= (alpha & beta);
-                u_g[i][j] = g[i][2 * j + 1] ^ z; // u_g = g2 + p2g1
+        triple_plane += carryUnitPlanes(t, radix_);
+    }
+    AppendOpened(send_buffer, num_opened);
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+CarryOutRadixReceive(std::size_t level, MessageBuffer& receive_buffer) {
+    ReceiveOpened(receive_buffer, opened_.size() / std::max<std::size_t>(num_words_, 1));
+    num_bit_openings_ += num_comparisons() * (opened_.size() / std::max<std::size_t>(num_words_, 1));
+
+    // The group j overwrites the bit j, which is below the bits of the group unless j = 0,
+    // and the inputs of a group are not read again once they are opened
+    const auto* open = opened_.data();
+    auto triple_plane = level_planes_[level];
+    for (std::size_t group = 0; group < num_radix_groups(); ++group) {
+        const auto base = group * radix_;
+        const auto t = radix_group_bits(group);
+        if (t == 1) {
+            std::copy_n(p_.data() + base * num_words_, num_words_, p_.data() + group * num_words_);
+            std::copy_n(g_.data() + base * num_words_, num_words_, g_.data() + group * num_words_);
+            std::copy_n(mac_plane(mac_p_, base, 0), kBitMacBits * num_words_, mac_plane(mac_p_, group, 0));
+            std::copy_n(mac_plane(mac_g_, base, 0), kBitMacBits * num_words_, mac_plane(mac_g_, group, 0));
+            continue;
+        }
+
+        // The sigma of the openings, MAC([x] - [a]) ^ e * [Delta]
+        const auto& triple = group_triples_[t];
+        const auto num_opened = 2 * t - 1;
+        sigma_.resize(num_opened * kBitMacBits * num_words_);
+        for (std::size_t v = 0; v < num_opened; ++v) {
+            const auto* e = open + v * num_words_;
+            for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+                const auto key = key_masks_[bit];
+                const auto* mac_x = v < t ? mac_plane(mac_p_, base + v, bit) : mac_plane(mac_g_, base + v - t, bit);
+                const auto* mac_a = mac_plane(triple_macs_, triple_plane + v, bit);
+                auto* sigma = sigma_.data() + (v * kBitMacBits + bit) * num_words_;
+                BIOAUTH_SIMD_LOOP
+                for (std::size_t word = 0; word < num_words_; ++word) {
+                    sigma[word] = mac_x[word] ^ mac_a[word] ^ (e[word] & key);
+                }
             }
         }
-        if (index_triple < numTriples) std::cout << "triples amount error\n";
-        if (k % 2 == 1) {
-            u_len += 1;
-            for (int i = 0; i < p.size(); ++i) {
-                u_p[i][u_len] = p[i][k - 1];
-                u_g[i][u_len] = g[i][k - 1];
+        HashSigma(num_opened * kBitMacBits);
+
+        // P is the product of the p of the group, and G is g_{t-1} plus the products of g_j and the p above it
+        auto* u_p = p_.data() + group * num_words_;
+        auto* u_g = g_.data() + group * num_words_;
+        std::fill_n(u_p, num_words_, 0);
+        std::copy_n(g_.data() + (base + t - 1) * num_words_, num_words_, u_g);
+        std::fill_n(mac_plane(mac_p_, group, 0), kBitMacBits * num_words_, 0);
+        std::copy_n(mac_plane(mac_g_, base + t - 1, 0), kBitMacBits * num_words_, mac_plane(mac_g_, group, 0));
+        for (std::size_t begin = 0; begin < num_words_; begin += kChunkWords) {
+            const auto count = std::min(kChunkWords, num_words_ - begin);
+            AddGroupProduct(triple, triple.products[0], open, triple_plane, begin, count, u_p, mac_p_, group);
+            for (std::size_t idx = 1; idx < triple.products.size(); ++idx) {
+                AddGroupProduct(triple, triple.products[idx], open, triple_plane, begin, count, u_g, mac_g_, group);
             }
         }
-        auto ret = CarryOutAux(u_p, u_g, u_len); // u_len : bit length
-        return ret;
+        open += num_opened * num_words_;
+        triple_plane += triple.num_planes();
     }
-    else {
-        //k<=1
-        std::vector<bool> ret(g.size());
-        for (int i = 0; i < ret.size(); ++i) {
-            ret[i] = g[i][0];
+    k_ = num_radix_groups();
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+AddGroupProduct(const CarryGroupTriple& triple, uint32_t product, const uint64_t* open, std::size_t triple_plane,
+                std::size_t begin, std::size_t count, uint64_t* out, std::vector<uint64_t>& out_mac,
+                std::size_t out_plane) {
+    // The inputs of the product are numbered from 0 in a set u. e_products_ holds the product of the opened e_i
+    // of each u, and planes the plane of the product of the masks of the inputs outside u
+    std::array<uint32_t, kMaxRadix> inputs;
+    std::size_t n = 0;
+    for (auto rest = product; rest != 0; rest &= rest - 1) {
+        inputs[n++] = static_cast<uint32_t>(std::countr_zero(rest));
+    }
+    const std::size_t all = (std::size_t(1) << n) - 1;
+    std::array<uint32_t, std::size_t(1) << kMaxRadix> sets, planes;
+    sets[0] = 0;
+    std::fill_n(e_products_.data(), count, ~uint64_t(0));
+    for (std::size_t u = 1; u <= all; ++u) {
+        const auto input = inputs[std::countr_zero(u)];
+        sets[u] = sets[u & (u - 1)] | (uint32_t(1) << input);
+        const auto* lower = e_products_.data() + (u & (u - 1)) * kChunkWords;
+        const auto* e = open + input * num_words_ + begin;
+        auto* e_product = e_products_.data() + u * kChunkWords;
+        for (std::size_t word = 0; word < count; ++word) {
+            e_product[word] = lower[word] & e[word];
+        }
+    }
+    for (std::size_t u = 0; u < all; ++u) {
+        planes[u] = static_cast<uint32_t>(triple_plane) + triple.plane_of[product ^ sets[u]];
+    }
+
+    // The product of all e_i is public, which party 0 adds and whose product with [Delta] is added to the MACs,
+    // the other products of e_i multiply the shares of their products of masks
+    const uint64_t party_0 = this->my_id() == 0 ? ~uint64_t(0) : 0;
+    const auto* e_all = e_products_.data() + all * kChunkWords;
+    for (std::size_t word = 0; word < count; ++word) {
+        out[begin + word] ^= e_all[word] & party_0;
+    }
+    for (std::size_t u = 0; u < all; ++u) {
+        const auto* e_product = e_products_.data() + u * kChunkWords;
+        const auto* mask = triples_.data() + planes[u] * num_words_ + begin;
+        for (std::size_t word = 0; word < count; ++word) {
+            out[begin + word] ^= e_product[word] & mask[word];
+        }
+    }
+    for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+        const auto key = key_masks_[bit];
+        auto* mac = mac_plane(out_mac, out_plane, bit) + begin;
+        for (std::size_t word = 0; word < count; ++word) {
+            mac[word] ^= e_all[word] & key;
+        }
+        for (std::size_t u = 0; u < all; ++u) {
+            const auto* e_product = e_products_.data() + u * kChunkWords;
+            const auto* mask_mac = mac_plane(triple_macs_, planes[u], bit) + begin;
+            BIOAUTH_SIMD_LOOP
+            for (std::size_t word = 0; word < count; ++word) {
+                mac[word] ^= e_product[word] & mask_mac[word];
+            }
+        }
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+AppendOpened(MessageBuffer& send_buffer, std::size_t num_planes) const {
+    // The words are little-endian, so the first bytes of a plane are its first comparisons
+    const auto plane_bytes = (num_comparisons() + 7) / 8;
+    for (std::size_t plane = 0; plane < num_planes; ++plane) {
+        send_buffer.Append(reinterpret_cast<const uint8_t*>(opened_.data() + plane * num_words_), plane_bytes);
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+ReceiveOpened(MessageBuffer& receive_buffer, std::size_t num_planes) {
+    // The bytes of received_ past those of a plane stay zero
+    const auto plane_bytes = (num_comparisons() + 7) / 8;
+    for (std::size_t plane = 0; plane < num_planes; ++plane) {
+        receive_buffer.ReadInto(reinterpret_cast<uint8_t*>(received_.data()), plane_bytes);
+        auto* open = opened_.data() + plane * num_words_;
+        for (std::size_t word = 0; word < num_words_; ++word) {
+            open[word] ^= received_[word];
         }
-        return ret; // Actually only care g[..][0]
     }
 }
 
+
+template <IsSpdz2kShare ShrType>
+void GtzGate<ShrType>::
+HashSigma(std::size_t num_planes) {
+    // The lanes past the last comparison hold what each party computed on its own
+    const auto tail = num_comparisons() % 64;
+    const uint64_t tail_mask = tail == 0 ? ~uint64_t(0) : (uint64_t(1) << tail) - 1;
+    for (std::size_t plane = 0; plane < num_planes && num_words_ > 0; ++plane) {
+        sigma_[(plane + 1) * num_words_ - 1] &= tail_mask;
+    }
+    sigma_hash_.Update(sigma_.data(), num_planes * num_words_ * sizeof(uint64_t));
+}
+
 } // namespace bioauth
 
 #endif //GTZGATE_H
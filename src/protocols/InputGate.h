@@ -23,13 +23,21 @@ public:
 
     void setInput(const std::vector<ClearType>& input_value);
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
+    // Only the owner sends its masked input
+    [[nodiscard]] std::size_t receive_size(std::size_t, std::size_t) const override {
+        return this->my_id() == owner_id_ ? 0 : this->dim_row() * this->dim_col() * ShrType::kClearBytes;
+    }
+
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
 
     std::size_t owner_id_;
-    std::vector<SemiShrType> lambda_clear_;
-    std::vector<SemiShrType> input_value_;
+    std::vector<ClearType> lambda_clear_;
+    std::vector<ClearType> input_value_;
 };
 
 
@@ -48,7 +56,7 @@ setInput(const std::vector<ClearType>& input_value) {
     if (input_value.size() != this->dim_row() * this->dim_col())
         throw std::invalid_argument("Input vector and gate doesn't match in size");
 
-    input_value_ = std::vector<SemiShrType>(input_value.begin(), input_value.end());
+    input_value_.assign(input_value.begin(), input_value.end()); // reuses the storage of the last session
 }
 
 
@@ -57,23 +65,33 @@ void InputGate<ShrType>::doReadOfflineFromFile() {
     auto size = this->dim_row() * this->dim_col();
 
     if (this->party().my_id() == owner_id_) {
-        this->lambda_clear_ = this->party().ReadShares(size);
+        this->party().ReadClear(this->lambda_clear_, size);
     }
 
-    this->lambda_shr() = this->party().ReadShares(size);
-    this->lambda_shr_mac() = this->party().ReadShares(size);
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
 }
 
 
 template <IsSpdz2kShare ShrType>
-void InputGate<ShrType>::doRunOnline() {
+void InputGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
     if (this->my_id() == owner_id_) {
-        this->Delta_clear() = matrixAdd(input_value_, this->lambda_clear_);
-        this->party().SendVecToOther(this->Delta_clear());
+        // Delta_x = x + lambda_x in Z_2^K, only the lower K bits are sent, so the owner keeps no more than them either
+        this->Delta_clear().resize(input_value_.size());
+        matrixTransform(std::span<ClearType>(this->Delta_clear()), [](ClearType input, ClearType lambda) {
+            return ShrType::ToClear(static_cast<SemiShrType>(input + lambda));
+        }, input_value_, this->lambda_clear_);
+        send_buffer.AppendPacked(this->Delta_clear().data(), this->Delta_clear().size(), ShrType::kClearBytes);
     }
-    else {
+}
+
+
+template <IsSpdz2kShare ShrType>
+void InputGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    if (this->my_id() != owner_id_) {
         auto size = this->dim_row() * this->dim_col();
-        this->Delta_clear() = this->party().template ReceiveVecFromOther<SemiShrType>(size);
+        this->Delta_clear().resize(size);
+        receive_buffer.ReadPackedInto(this->Delta_clear().data(), size, ShrType::kClearBytes);
     }
 }
 
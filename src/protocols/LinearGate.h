@@ -0,0 +1,90 @@
+#ifndef BIOAUTH_LINEARGATE_H
+#define BIOAUTH_LINEARGATE_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "protocols/Gate.h"
+#include "share/IsSpdz2kShare.h"
+#include "utils/linear_algebra.h"
+
+namespace bioauth {
+
+/// A local gate whose Delta is a linear combination of the Deltas of its inputs plus a constant,
+/// e.g., addition, subtraction and addition of a constant.
+/// The fusion pass of the circuit (see GateFusion.h) merges a chain of such gates into its last gate,
+/// which then evaluates the whole chain in one pass, while the other gates of the chain are skipped.
+template <IsSpdz2kShare ShrType>
+class LinearGate : public Gate<ShrType> {
+public:
+    using ClearType = typename ShrType::ClearType;
+
+    // The Deltas are public, so the linear forms are over Z_2^K
+    struct Term {
+        Gate<ShrType>* gate;
+        ClearType coefficient;
+    };
+
+    using Gate<ShrType>::Gate;
+
+    /// Appends Delta_z = constant + sum(coefficient * Delta_input) of this gate, in terms of its own inputs
+    void AppendLinearForm(std::vector<Term>& terms, ClearType& constant) const {
+        doAppendLinearForm(terms, constant);
+    }
+
+    /// Evaluates the given linear form of a whole chain instead of this gate alone
+    void FuseChain(std::vector<Term> terms, ClearType constant) {
+        fused_terms_ = std::move(terms);
+        fused_constant_ = constant;
+    }
+
+    /// Skips this gate in the online phase, since its consumer evaluates it as part of a chain
+    void set_skipped(bool skipped) { skipped_ = skipped; }
+
+    void Unfuse() {
+        fused_terms_.clear();
+        skipped_ = false;
+    }
+
+    [[nodiscard]] bool fused() const { return !fused_terms_.empty(); }
+    [[nodiscard]] bool skipped() const { return skipped_; }
+
+private:
+    virtual void doAppendLinearForm(std::vector<Term>& terms, ClearType& constant) const = 0;
+    virtual void doRunLinear() = 0;
+
+    void doRunOnline() override;
+
+    std::vector<Term> fused_terms_;
+    ClearType fused_constant_ = 0;
+    bool skipped_ = false;
+
+    // Kept so that later sessions reuse their storage
+    std::vector<const std::vector<ClearType>*> fused_inputs_;
+    std::vector<ClearType> fused_coefficients_;
+};
+
+
+template <IsSpdz2kShare ShrType>
+void LinearGate<ShrType>::doRunOnline() {
+    if (skipped_) {
+        return;
+    }
+    if (fused_terms_.empty()) {
+        doRunLinear();
+        return;
+    }
+
+    fused_inputs_.clear();
+    fused_coefficients_.clear();
+    for (const auto& term : fused_terms_) {
+        fused_inputs_.push_back(&term.gate->Delta_clear());
+        fused_coefficients_.push_back(term.coefficient);
+    }
+    matrixLinearCombination(fused_inputs_, fused_coefficients_, fused_constant_, this->Delta_clear());
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_LINEARGATE_H
@@ -0,0 +1,196 @@
+#ifndef BIOAUTH_MACCHECK_H
+#define BIOAUTH_MACCHECK_H
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+#include "networking/MessageBuffer.h"
+#include "share/IsSpdz2kShare.h"
+#include "protocols/PartyWithFakeOffline.h"
+#include "utils/crypto.h"
+
+
+namespace bioauth {
+
+/// The deferred MAC check of the online phase, in the spirit of MAC_Check of MP-SPDZ.
+/// The values opened by the gates are not checked when they are opened, instead they are collected
+/// with the shares of their MACs (the gates keep both), and all of them are checked at once after the run:
+/// 1. The parties commit to random seeds s_i and open them, as the coin tossing of MAC_Check.
+///    The coefficients r_j of a random linear combination are derived from H(x_0 || x_1 || ... || s_0 || s_1),
+///    so they are fixed only after the openings. A hash of the openings alone would let the party that sends last
+///    vary the upper bits of its shares until the coefficient of a forged opening is a multiple of 2^(S+1).
+/// 2. Each party computes sigma_i = sum(r_j * [m_j]_i) - [alpha]_i * sum(r_j * x_j) over the full ring of the shares.
+/// 3. The parties commit to sigma_i, open it, and accept if the sum of the sigma_i is zero.
+/// So the check costs four exchanges of a few dozen bytes, regardless of the number of openings.
+///
+/// The boolean openings (see bit_slicing.h) are checked together with them. Over GF(2), the MAC check of an opened
+/// bit x is sigma_0 ^ sigma_1 = 0 for sigma_i = [m]_i ^ x * [Delta]_i, i.e., sigma_0 = sigma_1, which does not
+/// reveal anything that the other party does not know. So the gates hash their sigma_i, and the parties commit to
+/// the hash of these digests with sigma_i, and accept if they hold the same hash.
+/// The commitments include the id of the party, so that a party cannot echo the commitment of the other.
+template <IsSpdz2kShare ShrType>
+class MacCheck {
+public:
+    using SemiShrType = typename ShrType::SemiShrType;
+
+    /// Adds opened values (with all the bits of the shares) and the shares of their MACs.
+    /// The data is not copied, it must stay valid until Check() is called.
+    void Add(std::span<const SemiShrType> opened, std::span<const SemiShrType> mac_shr) {
+        if (opened.size() != mac_shr.size()) {
+            throw std::invalid_argument("The opened values and their MACs differ in size");
+        }
+        openings_.push_back({opened, mac_shr});
+    }
+
+    /// Adds the digest of the sigma_i of num_openings boolean openings, see above
+    void AddBitDigest(const Sha256::Digest& digest, std::size_t num_openings) {
+        bit_digests_.push_back(digest);
+        num_bit_openings_ += num_openings;
+    }
+
+    /// Checks the openings added since the last check and forgets them.
+    /// Throws std::runtime_error if a MAC does not match, after which the outputs must be discarded.
+    void Check(PartyWithFakeOffline<ShrType>& party);
+
+    /// The cost of the last check
+    [[nodiscard]] std::size_t num_rounds() const { return num_rounds_; }
+    [[nodiscard]] std::size_t num_checked() const { return num_checked_; }
+
+private:
+    struct Opening {
+        std::span<const SemiShrType> opened;
+        std::span<const SemiShrType> mac_shr;
+    };
+
+    static constexpr std::size_t kCoefficientBlock = 1024;
+
+    std::vector<Opening> openings_;
+    std::vector<Sha256::Digest> bit_digests_;
+    std::size_t num_bit_openings_ = 0;
+    std::vector<SemiShrType> coefficients_;
+    MessageBuffer send_buffer_, receive_buffer_;
+    std::size_t num_rounds_ = 0;
+    std::size_t num_checked_ = 0;
+};
+
+
+template <IsSpdz2kShare ShrType>
+void MacCheck<ShrType>::Check(PartyWithFakeOffline<ShrType>& party) {
+    num_rounds_ = 0;
+    num_checked_ = 0;
+    const auto my_id = party.my_id(), other_id = 1 - party.my_id();
+
+    // Toss the seed of the coefficients: commit to a random seed, then open it
+    std::array<std::uint8_t, 16> seed, seed_nonce;
+    RandomBytes(seed.data(), seed.size());
+    RandomBytes(seed_nonce.data(), seed_nonce.size());
+    Sha256 seed_commitment;
+    seed_commitment.Update(&my_id, sizeof(my_id));
+    seed_commitment.Update(seed.data(), seed.size());
+    seed_commitment.Update(seed_nonce.data(), seed_nonce.size());
+    auto seed_digest = seed_commitment.Final();
+
+    send_buffer_.Clear();
+    send_buffer_.Append(seed_digest.data(), seed_digest.size());
+    party.ExchangeWithOther(send_buffer_, receive_buffer_, send_buffer_.size());
+    Sha256::Digest other_seed_digest;
+    receive_buffer_.ReadInto(other_seed_digest.data(), other_seed_digest.size());
+
+    send_buffer_.Clear();
+    send_buffer_.Append(seed.data(), seed.size());
+    send_buffer_.Append(seed_nonce.data(), seed_nonce.size());
+    party.ExchangeWithOther(send_buffer_, receive_buffer_, send_buffer_.size());
+    std::array<std::uint8_t, 16> other_seed, other_seed_nonce;
+    receive_buffer_.ReadInto(other_seed.data(), other_seed.size());
+    receive_buffer_.ReadInto(other_seed_nonce.data(), other_seed_nonce.size());
+
+    seed_commitment.Update(&other_id, sizeof(other_id));
+    seed_commitment.Update(other_seed.data(), other_seed.size());
+    seed_commitment.Update(other_seed_nonce.data(), other_seed_nonce.size());
+    if (seed_commitment.Final() != other_seed_digest) {
+        throw std::runtime_error("The other party opened a seed that differs from its commitment in the MAC check");
+    }
+
+    Sha256 transcript;
+    for (const auto& opening : openings_) {
+        transcript.Update(opening.opened.data(), opening.opened.size_bytes());
+    }
+    transcript.Update((my_id == 0 ? seed : other_seed).data(), seed.size());
+    transcript.Update((my_id == 0 ? other_seed : seed).data(), seed.size());
+    AesCtrPrg prg(transcript.Final());
+
+    // y = sum(r_j * x_j), m = sum(r_j * [m_j]), with the coefficients generated block by block
+    SemiShrType y = 0, m = 0;
+    coefficients_.resize(kCoefficientBlock);
+    for (const auto& [opened, mac_shr] : openings_) {
+        for (std::size_t begin = 0; begin < opened.size(); begin += kCoefficientBlock) {
+            auto count = std::min(kCoefficientBlock, opened.size() - begin);
+            prg.Fill(coefficients_.data(), count * sizeof(SemiShrType));
+            for (std::size_t j = 0; j < count; ++j) {
+                y += coefficients_[j] * opened[begin + j];
+                m += coefficients_[j] * mac_shr[begin + j];
+            }
+        }
+        num_checked_ += opened.size();
+    }
+    openings_.clear();
+    SemiShrType sigma = m - static_cast<SemiShrType>(party.global_key_shr()) * y;
+
+    Sha256 bit_transcript;
+    for (const auto& bit_digest : bit_digests_) {
+        bit_transcript.Update(bit_digest.data(), bit_digest.size());
+    }
+    auto bit_sigma = bit_transcript.Final();
+    num_checked_ += num_bit_openings_;
+    bit_digests_.clear();
+    num_bit_openings_ = 0;
+
+    // Commit to sigma and to the digest of the boolean openings, then open them
+    std::array<std::uint8_t, 16> nonce;
+    RandomBytes(nonce.data(), nonce.size());
+    Sha256 commitment;
+    commitment.Update(&my_id, sizeof(my_id));
+    commitment.Update(&sigma, sizeof(sigma));
+    commitment.Update(bit_sigma.data(), bit_sigma.size());
+    commitment.Update(nonce.data(), nonce.size());
+    auto digest = commitment.Final();
+
+    send_buffer_.Clear();
+    send_buffer_.Append(digest.data(), digest.size());
+    party.ExchangeWithOther(send_buffer_, receive_buffer_, send_buffer_.size());
+    Sha256::Digest other_digest;
+    receive_buffer_.ReadInto(other_digest.data(), other_digest.size());
+
+    send_buffer_.Clear();
+    send_buffer_.Append(&sigma, 1);
+    send_buffer_.Append(bit_sigma.data(), bit_sigma.size());
+    send_buffer_.Append(nonce.data(), nonce.size());
+    party.ExchangeWithOther(send_buffer_, receive_buffer_, send_buffer_.size());
+    SemiShrType other_sigma;
+    Sha256::Digest other_bit_sigma;
+    std::array<std::uint8_t, 16> other_nonce;
+    receive_buffer_.ReadInto(&other_sigma, 1);
+    receive_buffer_.ReadInto(other_bit_sigma.data(), other_bit_sigma.size());
+    receive_buffer_.ReadInto(other_nonce.data(), other_nonce.size());
+    num_rounds_ = 4;
+
+    commitment.Update(&other_id, sizeof(other_id));
+    commitment.Update(&other_sigma, sizeof(other_sigma));
+    commitment.Update(other_bit_sigma.data(), other_bit_sigma.size());
+    commitment.Update(other_nonce.data(), other_nonce.size());
+    if (commitment.Final() != other_digest) {
+        throw std::runtime_error("The other party opened a value that differs from its commitment in the MAC check");
+    }
+    if (static_cast<SemiShrType>(sigma + other_sigma) != 0 || bit_sigma != other_bit_sigma) {
+        throw std::runtime_error("MAC check failed");
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_MACCHECK_H
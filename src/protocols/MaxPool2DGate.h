@@ -0,0 +1,147 @@
+#ifndef BIOAUTH_MAXPOOL2DGATE_H
+#define BIOAUTH_MAXPOOL2DGATE_H
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "protocols/Gate.h"
+#include "protocols/GatherGate.h"
+#include "protocols/GtzGate.h"
+#include "protocols/ElemMultiplyGate.h"
+#include "share/IsSpdz2kShare.h"
+#include "utils/tensor.h"
+
+namespace bioauth {
+
+/// The maximum of each window of a max pooling, found by a tournament tree (see TournamentLevel in tensor.h).
+/// The comparisons of a level of the tree, over all windows and channels, are evaluated by a single GtzGate,
+/// so a window of k elements takes ceil(log2(k)) comparisons one after another, each followed by
+/// the multiplication that selects the winners: max(l, r) = r + (l - r) * [l - r >= 0].
+/// The outcomes of the comparisons stay shared, as GtzGate opens its results only masked by daBits, so the parties
+/// learn neither which element of a window is the largest nor how the elements are ordered.
+template <IsSpdz2kShare ShrType>
+class MaxPool2DGate : public Gate<ShrType> {
+public:
+    using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
+
+    MaxPool2DGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, const MaxPoolOp& op);
+
+    [[nodiscard]] std::size_t num_rounds() const override { return levels_.size() * rounds_per_level(); }
+
+private:
+    // The gates of a level of the tournament tree
+    struct Level {
+        std::shared_ptr<Gate<ShrType>> difference; // left - right of each comparison
+        std::shared_ptr<Gate<ShrType>> gtz;        // [left - right >= 0]
+        std::shared_ptr<Gate<ShrType>> multiply;   // max(left - right, 0)
+        std::shared_ptr<Gate<ShrType>> winners;    // right + max(left - right, 0)
+    };
+
+    [[nodiscard]] std::size_t rounds_per_level() const { return levels_[0].gtz->num_rounds() + 1; }
+
+    void doReadOfflineFromFile() override;
+    // The rounds of each level are those of its GtzGate followed by the round of its multiplication,
+    // its local gates run before the first round and after the last one
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
+
+    MaxPoolOp maxPoolOp;
+    std::shared_ptr<Gate<ShrType>> candidates_; // the elements of the windows, window after window
+    std::vector<Level> levels_;
+};
+
+template <IsSpdz2kShare ShrType>
+MaxPool2DGate<ShrType>::
+MaxPool2DGate(const std::shared_ptr<Gate<ShrType>>& p_input_x, const MaxPoolOp& op)
+    : Gate<ShrType>(p_input_x, nullptr), maxPoolOp(op) {
+    if (p_input_x->dim_row() * p_input_x->dim_col() != op.compute_input_size()) {
+        throw std::invalid_argument("The input of max pooling gate should have the size of the pooling");
+    }
+    if (op.compute_kernel_size() < 2) {
+        throw std::invalid_argument("The windows of max pooling gate should have at least two elements");
+    }
+    this->set_dim_row(op.compute_output_size());
+    this->set_dim_col(1);
+
+    const auto num_windows = op.compute_output_size();
+    candidates_ = std::make_shared<GatherGate<ShrType>>(p_input_x, poolingWindows(op));
+    auto candidates = candidates_;
+    for (auto num_candidates = op.compute_kernel_size(); num_candidates > 1;) {
+        auto tournament = tournamentLevel(num_windows, num_candidates);
+        Level level;
+        level.difference = std::make_shared<GatherGate<ShrType>>(candidates, tournament.left, candidates,
+                                                                 tournament.right, true);
+        level.gtz = std::make_shared<GtzGate<ShrType>>(level.difference);
+        level.multiply = std::make_shared<ElemMultiplyGate<ShrType>>(level.difference, level.gtz);
+        level.winners = std::make_shared<GatherGate<ShrType>>(candidates, tournament.winner_candidate,
+                                                              level.multiply, tournament.winner_comparison);
+        candidates = level.winners;
+        num_candidates = tournament.num_winners;
+        levels_.push_back(std::move(level));
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void MaxPool2DGate<ShrType>::doReadOfflineFromFile() {
+    // In the order in which FakeMaxPool2DGate writes them
+    candidates_->readOfflineFromFile();
+    for (const auto& level : levels_) {
+        level.difference->readOfflineFromFile();
+        level.gtz->readOfflineFromFile();
+        level.multiply->readOfflineFromFile();
+        level.winners->readOfflineFromFile();
+    }
+    this->lambda_shr() = levels_.back().winners->lambda_shr();
+    this->lambda_shr_mac() = levels_.back().winners->lambda_shr_mac();
+}
+
+template <IsSpdz2kShare ShrType>
+void MaxPool2DGate<ShrType>::doPrepareRound(std::size_t round, MessageBuffer& send_buffer) {
+    const auto& level = levels_[round / rounds_per_level()];
+    const auto level_round = round % rounds_per_level();
+    if (level_round == 0) {
+        if (round == 0) {
+            candidates_->RunOnline();
+        }
+        level.difference->RunOnline();
+    }
+
+    if (level_round < level.gtz->num_rounds()) {
+        level.gtz->PrepareRound(level_round, send_buffer);
+    }
+    else {
+        level.multiply->PrepareRound(0, send_buffer);
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void MaxPool2DGate<ShrType>::doFinishRound(std::size_t round, MessageBuffer& receive_buffer) {
+    const auto& level = levels_[round / rounds_per_level()];
+    const auto level_round = round % rounds_per_level();
+    if (level_round < level.gtz->num_rounds()) {
+        level.gtz->FinishRound(level_round, receive_buffer);
+    }
+    else {
+        level.multiply->FinishRound(0, receive_buffer);
+        level.winners->RunOnline();
+    }
+
+    if (round + 1 == num_rounds()) {
+        this->Delta_clear() = levels_.back().winners->Delta_clear();
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void MaxPool2DGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    for (const auto& level : levels_) {
+        level.gtz->CollectOpenings(mac_check);
+        level.multiply->CollectOpenings(mac_check);
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_MAXPOOL2DGATE_H
@@ -0,0 +1,243 @@
+#ifndef BIOAUTH_MEMORYPLANNER_H
+#define BIOAUTH_MEMORYPLANNER_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_set>
+
+#include "share/IsSpdz2kShare.h"
+#include "utils/ExecutionPlan.h"
+#include "utils/MemoryStats.h"
+#include "protocols/Gate.h"
+#include "protocols/LinearGate.h"
+#include "protocols/OutputGate.h"
+
+
+namespace bioauth {
+
+/// Plans the lifetimes of the Delta buffers of the online phase, so that gates whose Deltas are never needed
+/// at the same time share one buffer (a slab) instead of each keeping its own until the circuit is destroyed.
+///
+/// The lifetime of a Delta lasts from the first layer of its gate to the last layer of its last reader,
+/// in the layers of RoundScheduler. The gates are assigned to slabs greedily in the order of their first layer,
+/// each taking the best-fitting slab whose previous holder died in an earlier layer.
+/// A slab is a plain vector that is handed from one holder to the next by swapping it into the gate
+/// when its first layer starts, and back to its first holder at the start of the next run,
+/// so later sessions reuse the storage without allocating.
+///
+/// The Deltas of the endpoints and of the inputs of the output gates are needed after the run, they are not planned.
+/// With planning, the Deltas of the other gates are undefined after the run.
+template <IsSpdz2kShare ShrType>
+class MemoryPlanner {
+public:
+    using ClearType = typename ShrType::ClearType;
+
+    /// Hands the slab of gate `from`, and all of its readers are done, to gate `to`
+    struct Handoff {
+        Gate<ShrType>* to;
+        Gate<ShrType>* from;
+        std::vector<Gate<ShrType>*> readers; // the gates that read the Delta of `from`, including itself
+    };
+
+    /// Plans the buffers of the plan, whose gates start in the given layers, and reserves the slabs.
+    /// With `huge_pages`, the slabs are backed by transparent huge pages where supported.
+    void Build(const ExecutionPlan<Gate<ShrType>>& plan, const std::vector<std::size_t>& start_layers,
+               const std::vector<std::shared_ptr<Gate<ShrType>>>& endpoints, bool huge_pages);
+
+    /// Removes the plan, every gate keeps its own buffer
+    void Clear();
+
+    /// Returns the slabs to their first holders, called at the start of each run
+    void Reset();
+
+    /// Performs the handoffs to the gates starting in `layer`, called before the layer is evaluated
+    void RunHandoffs(std::size_t layer);
+
+    /// All handoffs, in the order of the layers
+    [[nodiscard]] const std::vector<Handoff>& handoffs() const { return handoffs_; }
+
+    [[nodiscard]] std::size_t num_slabs() const { return slabs_.size(); }
+
+    /// The size of the planned Delta buffers with and without sharing
+    [[nodiscard]] std::size_t planned_bytes() const { return planned_bytes_; }
+    [[nodiscard]] std::size_t unplanned_bytes() const { return unplanned_bytes_; }
+
+private:
+    struct Slab {
+        Gate<ShrType>* first_holder;
+        Gate<ShrType>* last_holder;
+        std::size_t last_index; // the index of the last holder in the plan
+        std::size_t free_from;  // the first layer after the last reader of the last holder
+        std::size_t size;       // the largest Delta of its holders
+    };
+
+    std::vector<Slab> slabs_;
+    std::vector<Handoff> handoffs_;
+    std::vector<std::size_t> handoff_offsets_; // the handoffs of layer i start at handoff_offsets_[i]
+    std::size_t planned_bytes_ = 0;
+    std::size_t unplanned_bytes_ = 0;
+    bool ran_ = false;
+};
+
+
+template <IsSpdz2kShare ShrType>
+void MemoryPlanner<ShrType>::Build(const ExecutionPlan<Gate<ShrType>>& plan,
+                                   const std::vector<std::size_t>& start_layers,
+                                   const std::vector<std::shared_ptr<Gate<ShrType>>>& endpoints,
+                                   bool huge_pages) {
+    Clear();
+    constexpr auto kNoInput = ExecutionPlan<Gate<ShrType>>::kNoInput;
+    const auto& nodes = plan.nodes();
+    auto skipped = [](Gate<ShrType>* gate) {
+        auto linear = dynamic_cast<LinearGate<ShrType>*>(gate);
+        return linear && linear->skipped();
+    };
+
+    std::vector<std::vector<std::size_t>> consumers(nodes.size());
+    std::unordered_set<const Gate<ShrType>*> pinned;
+    for (const auto& endpoint : endpoints) {
+        pinned.insert(endpoint.get());
+    }
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+        for (auto wire : {nodes[idx].input_x, nodes[idx].input_y}) {
+            if (wire != kNoInput) {
+                consumers[wire].push_back(idx);
+            }
+        }
+        if (dynamic_cast<OutputGate<ShrType>*>(nodes[idx].gate)) {
+            pinned.insert(nodes[idx].gate);
+            pinned.insert(nodes[idx].gate->input_x().get()); // read again by getClear()
+        }
+    }
+
+    // The gates that read the Delta of each gate: a skipped gate of a fused chain is read through its consumer.
+    // Computed backwards, since the consumers come after their inputs in the plan.
+    std::vector<std::vector<std::size_t>> readers(nodes.size());
+    std::vector<std::size_t> last_layer(nodes.size());
+    std::vector<std::size_t> death(nodes.size());
+    for (std::size_t idx = nodes.size(); idx-- > 0;) {
+        auto rounds = nodes[idx].gate->num_rounds();
+        last_layer[idx] = start_layers[idx] + (rounds == 0 ? 0 : rounds - 1);
+        death[idx] = 0;
+        readers[idx].push_back(idx);
+        for (auto consumer : consumers[idx]) {
+            if (skipped(nodes[consumer].gate)) {
+                readers[idx].insert(readers[idx].end(), readers[consumer].begin(), readers[consumer].end());
+            }
+            else {
+                readers[idx].push_back(consumer);
+            }
+        }
+        for (auto reader : readers[idx]) {
+            death[idx] = std::max(death[idx], last_layer[reader]);
+        }
+    }
+
+    std::vector<std::size_t> planned;
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+        if (!pinned.contains(nodes[idx].gate) && !skipped(nodes[idx].gate)) {
+            planned.push_back(idx);
+        }
+    }
+    std::ranges::stable_sort(planned, {}, [&start_layers](std::size_t idx) { return start_layers[idx]; });
+
+    // The handoffs are collected with their layers, and sorted by layer afterwards
+    std::vector<std::pair<std::size_t, Handoff>> handoffs;
+    for (auto idx : planned) {
+        auto gate = nodes[idx].gate;
+        auto size = gate->dim_row() * gate->dim_col();
+        auto birth = start_layers[idx];
+        unplanned_bytes_ += size * sizeof(ClearType);
+
+        // The smallest free slab that fits, otherwise the largest free slab, which grows
+        Slab* best = nullptr;
+        for (auto& slab : slabs_) {
+            if (slab.free_from > birth) {
+                continue;
+            }
+            if (!best || (best->size < size ? slab.size > best->size : slab.size >= size && slab.size < best->size)) {
+                best = &slab;
+            }
+        }
+
+        if (!best) {
+            slabs_.push_back({gate, gate, idx, death[idx] + 1, size});
+            continue;
+        }
+        Handoff handoff{gate, best->last_holder, {}};
+        for (auto reader : readers[best->last_index]) {
+            handoff.readers.push_back(nodes[reader].gate);
+        }
+        handoffs.emplace_back(birth, std::move(handoff));
+        best->last_holder = gate;
+        best->last_index = idx;
+        best->free_from = death[idx] + 1;
+        best->size = std::max(best->size, size);
+    }
+
+    std::ranges::stable_sort(handoffs, {}, &std::pair<std::size_t, Handoff>::first);
+    auto num_layers = handoffs.empty() ? 0 : handoffs.back().first + 1;
+    handoff_offsets_.assign(num_layers + 1, 0);
+    for (auto& [layer, handoff] : handoffs) {
+        ++handoff_offsets_[layer + 1];
+        handoffs_.push_back(std::move(handoff));
+    }
+    for (std::size_t layer = 0; layer < num_layers; ++layer) {
+        handoff_offsets_[layer + 1] += handoff_offsets_[layer];
+    }
+
+    // Only the first holder of each slab keeps its storage, which is reserved up front
+    for (const auto& handoff : handoffs_) {
+        std::vector<ClearType>().swap(handoff.to->Delta_clear());
+    }
+    for (const auto& slab : slabs_) {
+        planned_bytes_ += slab.size * sizeof(ClearType);
+        auto& storage = slab.first_holder->Delta_clear();
+        if (huge_pages && storage.capacity() < slab.size) {
+            std::vector<ClearType>().swap(storage); // reserve() would copy the old contents into the new pages
+        }
+        storage.reserve(slab.size);
+        if (huge_pages) {
+            AdviseHugePages(storage.data(), storage.capacity() * sizeof(ClearType));
+        }
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void MemoryPlanner<ShrType>::Clear() {
+    slabs_.clear();
+    handoffs_.clear();
+    handoff_offsets_.clear();
+    planned_bytes_ = 0;
+    unplanned_bytes_ = 0;
+    ran_ = false;
+}
+
+
+template <IsSpdz2kShare ShrType>
+void MemoryPlanner<ShrType>::Reset() {
+    if (ran_) {
+        for (const auto& slab : slabs_) {
+            slab.first_holder->Delta_clear().swap(slab.last_holder->Delta_clear());
+        }
+    }
+    ran_ = true;
+}
+
+
+template <IsSpdz2kShare ShrType>
+void MemoryPlanner<ShrType>::RunHandoffs(std::size_t layer) {
+    if (layer + 1 >= handoff_offsets_.size()) {
+        return;
+    }
+    for (auto i = handoff_offsets_[layer]; i < handoff_offsets_[layer + 1]; ++i) {
+        handoffs_[i].to->Delta_clear().swap(handoffs_[i].from->Delta_clear());
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_MEMORYPLANNER_H
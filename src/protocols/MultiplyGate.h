@@ -3,15 +3,18 @@
 #ifndef BIOAUTH_MULTIPLYGATE_H
 #define BIOAUTH_MULTIPLYGATE_H
 
+#include <span>
 #include <memory>
 #include <vector>
+#include <chrono>
+#include <utility>
+#include <concepts>
 #include <stdexcept>
-#include <thread>
-#include <numeric>
 
 #include "protocols/Gate.h"
 #include "share/IsSpdz2kShare.h"
 #include "utils/linear_algebra.h"
+#include "utils/gemm.h"
 
 namespace bioauth {
 
@@ -19,24 +22,58 @@ template <IsSpdz2kShare ShrType>
 class MultiplyGate : public Gate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
 
     MultiplyGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                  const std::shared_ptr<Gate<ShrType>>& p_input_y);
 
     [[nodiscard]] std::size_t dim_mid() const { return dim_mid_; }
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
+    /// The bytes of the large operands read by the last session with a single row (Delta_y, delta_y, [b], [b_mac]),
+    /// and the seconds the products took, e.g., to report the throughput of scanning a database
+    [[nodiscard]] std::size_t scanned_bytes() const { return scanned_bytes_; }
+    [[nodiscard]] double scan_seconds() const { return scan_seconds_; }
+
 protected:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
+
+    // The mask of the product, which differs from the mask of the output if the product is truncated
+    [[nodiscard]] virtual const std::vector<SemiShrType>& product_lambda_shr() const { return this->lambda_shr(); }
+    [[nodiscard]] virtual const std::vector<SemiShrType>& product_lambda_shr_mac() const {
+        return this->lambda_shr_mac();
+    }
 
 private:
+    // The products of a single row have vector kernels for the built-in shares, whose public values are half as wide
+    static constexpr bool kVectorProduct = GemmElement<SemiShrType>
+                                           && std::same_as<ClearType, BeaverPublicOf<SemiShrType>>;
+
+    // The products of a single row: lhs_product_ and rhs_product_ in one pass over the large operands
+    void MultiplyVector();
+
     std::size_t dim_mid_;
 
-    std::vector<SemiShrType> a_shr_, a_shr_mac_;
-    std::vector<SemiShrType> b_shr_, b_shr_mac_;
+    // The operands are stacked with the shares of their MACs, so that each large matrix is read once per session:
+    // lhs_stacked_ is [temp_x; a; a_mac] (one above the other), where temp_x is written in each session,
+    // and rhs_stacked_ is [b | b_mac] (side by side)
+    std::vector<SemiShrType> lhs_stacked_;
+    std::vector<SemiShrType> rhs_stacked_;
     std::vector<SemiShrType> c_shr_, c_shr_mac_;
-    std::vector<SemiShrType> delta_x_clear_;
-    std::vector<SemiShrType> delta_y_clear_;
+    std::vector<ClearType> delta_x_clear_;
+    std::vector<ClearType> delta_y_clear_;
+    std::vector<SemiShrType> Delta_z_opened_; // with the upper bits, which Delta_clear drops
+    std::vector<SemiShrType> Delta_z_stacked_; // [Delta_z; Delta_z_mac], kept between the two halves of the round
+
+    // Temporaries of the online phase, kept so that later sessions reuse their storage
+    std::vector<SemiShrType> temp_y_, lhs_product_, rhs_product_;
+
+    std::size_t scanned_bytes_ = 0;
+    double scan_seconds_ = 0;
 };
 
 template <IsSpdz2kShare ShrType>
@@ -59,120 +96,132 @@ void MultiplyGate<ShrType>::doReadOfflineFromFile() {
     auto size_rhs = this->dim_mid() * this->dim_col();
     auto size_output = this->dim_row() * this->dim_col();
 
-    a_shr_ = this->party().ReadShares(size_lhs);
-    a_shr_mac_ = this->party().ReadShares(size_lhs);
-    b_shr_ = this->party().ReadShares(size_rhs);
-    b_shr_mac_ = this->party().ReadShares(size_rhs);
-    c_shr_ = this->party().ReadShares(size_output);
-    c_shr_mac_ = this->party().ReadShares(size_output);
-    this->lambda_shr() = this->party().ReadShares(size_output);
-    this->lambda_shr_mac() = this->party().ReadShares(size_output);
-    delta_x_clear_ = this->party().ReadShares(size_lhs);
-    delta_y_clear_ = this->party().ReadShares(size_rhs);
+    // [a] and [a_mac] are stored one after the other, so they are read as they are, below temp_x
+    lhs_stacked_.resize(3 * size_lhs);
+    this->party().ReadShares(std::span<SemiShrType>(lhs_stacked_).subspan(size_lhs));
+    // [b] and [b_mac] are read row by row into the stack
+    rhs_stacked_.resize(2 * size_rhs);
+    for (std::size_t block = 0; block < 2; ++block) {
+        for (std::size_t row = 0; row < this->dim_mid(); ++row) {
+            auto offset = (2 * row + block) * this->dim_col();
+            this->party().ReadShares(std::span<SemiShrType>(rhs_stacked_).subspan(offset, this->dim_col()));
+        }
+    }
+    this->party().ReadShares(c_shr_, size_output);
+    this->party().ReadShares(c_shr_mac_, size_output);
+    this->party().ReadShares(this->lambda_shr(), size_output);
+    this->party().ReadShares(this->lambda_shr_mac(), size_output);
+    this->party().ReadClear(delta_x_clear_, size_lhs);
+    this->party().ReadClear(delta_y_clear_, size_rhs);
 }
 
 template <IsSpdz2kShare ShrType>
-void MultiplyGate<ShrType>::doRunOnline() {
-    // temp_x = $\Delta_x + \delta_x$
-    auto temp_x = matrixAdd(this->input_x()->Delta_clear(), delta_x_clear_);
-    // temp_y = $\Delta_y + \delta_y$
-    //std::cout << "1: " << this->party().bytes_sent() << " bytes\n";
-    auto temp_y = matrixAdd(this->input_y()->Delta_clear(), delta_y_clear_);
-    // temp_xy = temp_x * temp_y
-    //std::cout << "2: " << this->party().bytes_sent() << " bytes\n";
-    auto temp_xy = matrixMultiply(temp_x, temp_y, this->dim_row(), this->dim_mid(), this->dim_col());
-    //std::cout << "3: " << this->party().bytes_sent() << " bytes\n";
-    
+void MultiplyGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
+    auto dim_row = this->dim_row();
+    auto dim_mid = this->dim_mid();
+    auto dim_col = this->dim_col();
+    auto size_lhs = dim_row * dim_mid;
+    auto size_output = dim_row * dim_col;
+
+    // temp_x = $\Delta_x + \delta_x$, written above [a] and [a_mac]
+    matrixTransform(std::span<SemiShrType>(lhs_stacked_.data(), size_lhs), std::plus<SemiShrType>(),
+                    this->input_x()->Delta_clear(), delta_x_clear_);
+    lhs_product_.resize(3 * size_output);
+    rhs_product_.resize(2 * size_output);
+    if (dim_row == 1 && kVectorProduct) {
+        MultiplyVector();
+    }
+    else {
+        // temp_y = $\Delta_y + \delta_y$
+        matrixTransform(temp_y_, std::plus<SemiShrType>(), this->input_y()->Delta_clear(), delta_y_clear_);
+        // [temp_xy; [a] * temp_y; [a_mac] * temp_y] = [temp_x; [a]; [a_mac]] * temp_y
+        matrixMultiply(lhs_stacked_.data(), temp_y_.data(), lhs_product_.data(), 3 * dim_row, dim_mid, dim_col);
+        // [temp_x * [b] | temp_x * [b_mac]] = temp_x * [[b] | [b_mac]]
+        matrixMultiply(lhs_stacked_.data(), rhs_stacked_.data(), rhs_product_.data(), dim_row, dim_mid, 2 * dim_col);
+    }
+
+    auto block = [dim_row, dim_col](const std::vector<SemiShrType>& matrix, std::size_t offset, std::size_t stride) {
+        return matrixBlock(matrix.data() + offset, dim_row, dim_col, stride);
+    };
+    auto temp_xy = block(lhs_product_, 0, dim_col);
+    auto a_temp_y = block(lhs_product_, size_output, dim_col);
+    auto a_mac_temp_y = block(lhs_product_, 2 * size_output, dim_col);
+    auto temp_x_b = block(rhs_product_, 0, 2 * dim_col);
+    auto temp_x_b_mac = block(rhs_product_, dim_col, 2 * dim_col);
+
+    Delta_z_stacked_.resize(2 * size_output);
+    auto Delta_z_shr = matrixBlock(Delta_z_stacked_.data(), dim_row, dim_col, dim_col);
+    auto Delta_z_mac = matrixBlock(Delta_z_stacked_.data() + size_output, dim_row, dim_col, dim_col);
+
     // Compute [Delta_z] according to the paper
-    // [Delta_z] = [c] + [lambda_z]
-    auto Delta_z_shr = matrixAdd(c_shr_, this->lambda_shr());
-    // [Delta_z] -= [a] * temp_y
-    matrixSubtractAssign(Delta_z_shr,
-                         matrixMultiply(a_shr_, temp_y, this->dim_row(), this->dim_mid(), this->dim_col()));
-    // [Delta_z] -= temp_x * [b]
-    matrixSubtractAssign(Delta_z_shr,
-                         matrixMultiply(temp_x, b_shr_, this->dim_row(), this->dim_mid(), this->dim_col()));
+    // [Delta_z] = [c] + [lambda_z] (+ temp_xy for party 0) - [a] * temp_y - temp_x * [b]
     if (this->my_id() == 0) {
-        // [Delta_z] += temp_xy
-        matrixAddAssign(Delta_z_shr, temp_xy);
+        Delta_z_shr = block(c_shr_, 0, dim_col) + block(product_lambda_shr(), 0, dim_col) + temp_xy
+                      - a_temp_y - temp_x_b;
+    }
+    else {
+        Delta_z_shr = block(c_shr_, 0, dim_col) + block(product_lambda_shr(), 0, dim_col) - a_temp_y - temp_x_b;
     }
-    
-    // Compute Delta_z_mac according to the paper结果验证
-    // [Delta_z_mac] = temp_xy * [key]
-    auto Delta_z_mac = std::move(temp_xy);
-    matrixScalarAssign(Delta_z_mac, this->party().global_key_shr());
-    // [Delta_z_mac] += [c_mac] + [lambda_z_mac]
-    matrixAddAssign(Delta_z_mac,
-                    matrixAdd(c_shr_mac_, this->lambda_shr_mac()));
-    // [Delta_z_mac] -= [a_mac] * temp_y
-    matrixSubtractAssign(Delta_z_mac,
-                         matrixMultiply(a_shr_mac_, temp_y, this->dim_row(), this->dim_mid(), this->dim_col()));
-    // [Delta_z_mac] -= temp_x * [b_mac]
-    matrixSubtractAssign(Delta_z_mac,
-                         matrixMultiply(temp_x, b_shr_mac_, this->dim_row(), this->dim_mid(), this->dim_col()));
+    // [Delta_z_mac] = temp_xy * [key] + [c_mac] + [lambda_z_mac] - [a_mac] * temp_y - temp_x * [b_mac]
+    Delta_z_mac = temp_xy * static_cast<SemiShrType>(this->party().global_key_shr()) + block(c_shr_mac_, 0, dim_col)
+                  + block(product_lambda_shr_mac(), 0, dim_col) - a_mac_temp_y - temp_x_b_mac;
 
-    using ClearType = typename ShrType::ClearType;
-    //ClearType inner_product_share = std::accumulate(Delta_z_shr.begin(), Delta_z_shr.end(), ClearType(0));
-    auto inner_product_shares = Delta_z_shr;  // 直接使用每个 [Δ_z]
-
-    //std::cout << "Before communication: " << this->party().bytes_sent() << " bytes\n";
-    uint64_t before_ = this->party().bytes_sent();
-    //std::cout << "Before communication: " << before_ << " bytes\n";
-    //std::cout << "size: " << inner_product_shares.size() << " \n";
-    std::thread t1([&, this]() {
-        //this->party().SendVecToOther(std::vector<ClearType>{inner_product_share});  
-        this->party().SendVecToOther(inner_product_shares);
-    });
-
-    //std::vector<ClearType> received_vec = this->party().template ReceiveVecFromOther<ClearType>(1);
-    std::vector<ClearType> received_vec = this->party().template ReceiveVecFromOther<ClearType>(inner_product_shares.size());
-    t1.join();
-    //uint64_t after_ = this->party().bytes_sent();
-    this->party().comm_actual_=this->party().bytes_sent()-before_;
-    //this->party().comm_after_ = this->party().bytes_sent();
-    //uint64_t bytes_sent_=bytes_sent_actual(comm_before,comm_after);
-
-   // std::cout << "After communication: " << this->party().comm_actual_<< " bytes\n";
-    //ClearType final_share = inner_product_share + received_vec[0];
-    std::vector<ClearType> added_clear(inner_product_shares.size());
-    for (std::size_t i = 0; i < inner_product_shares.size(); ++i) {
-        added_clear[i] = inner_product_shares[i] + received_vec[i];
+    // Each [Delta_z] is opened directly, the opening is merged with the other gates of the same round
+    send_buffer.Append(Delta_z_stacked_.data(), size_output);
+}
+
+// With a single row, e.g., a query scored against a database, the products are matrix-vector products
+// bound by reading the large operands, which are read once for all of them, and temp_y is never written
+template <IsSpdz2kShare ShrType>
+void MultiplyGate<ShrType>::MultiplyVector() {
+    if constexpr (kVectorProduct) {
+        auto dim_mid = this->dim_mid();
+        auto dim_col = this->dim_col();
+        auto start = std::chrono::steady_clock::now();
+
+        BeaverGemvOperands<SemiShrType> operands{
+            .x = lhs_stacked_.data(),
+            .a = lhs_stacked_.data() + dim_mid,
+            .a_mac = lhs_stacked_.data() + 2 * dim_mid,
+            .y_0 = this->input_y()->Delta_clear().data(),
+            .y_1 = delta_y_clear_.data(),
+            .b = rhs_stacked_.data(),
+            .b_mac = rhs_stacked_.data() + dim_col,
+            .b_stride = 2 * dim_col,
+            .x_y = lhs_product_.data(),
+            .a_y = lhs_product_.data() + dim_col,
+            .a_mac_y = lhs_product_.data() + 2 * dim_col,
+            .x_b = rhs_product_.data(),
+            .x_b_mac = rhs_product_.data() + dim_col,
+        };
+        beaverGemv(operands, dim_mid, dim_col);
+
+        scanned_bytes_ = 2 * dim_mid * dim_col * (sizeof(ClearType) + sizeof(SemiShrType));
+        scan_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
+}
 
+template <IsSpdz2kShare ShrType>
+void MultiplyGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    auto size_output = this->dim_row() * this->dim_col();
 
-    //this->Delta_clear().resize(1);
-    //this->Delta_clear()[0] = final_share;
+    // The opened [Delta_z] keeps all its bits for the MAC check
+    Delta_z_opened_.resize(size_output);
+    receive_buffer.ReadInto(Delta_z_opened_.data(), size_output);
+    matrixTransform(Delta_z_opened_, std::plus<SemiShrType>(), Delta_z_opened_,
+                    std::span<const SemiShrType>(Delta_z_stacked_).first(size_output));
 
+    // Delta_clear keeps the lower K bits, the upper bits must not be shifted into the result of MultiplyTruncGate
+    ShrType::ToClear(Delta_z_opened_, this->Delta_clear());
 
-    // Since Delta_clear is in ClearType but stored in SemiShrType, we need to remove the upper bits
-    // This is important since it affects the correctness in MultiplyTruncGate!!!
-    //ShrType::RemoveUpperBitsInplace(this->Delta_clear());
+    // The buffers of the preprocessing data and the temporaries are kept,
+    // they are overwritten in place by the next session
+}
 
-    std::vector<SemiShrType> final_shares;
-    final_shares.reserve(added_clear.size());
-    for (const auto& val : added_clear) {
-         final_shares.emplace_back(static_cast<SemiShrType>(val));  // 转换 ClearType → SemiShrType
-    }
-    this->Delta_clear() = std::move(final_shares);
-    ShrType::RemoveUpperBitsInplace(this->Delta_clear());
-
-    // free the spaces of preprocessing data
-    a_shr_.clear();
-    a_shr_.shrink_to_fit();
-    a_shr_mac_.clear();
-    a_shr_mac_.shrink_to_fit();
-    b_shr_.clear();
-    b_shr_.shrink_to_fit();
-    b_shr_mac_.clear();
-    b_shr_mac_.shrink_to_fit();
-    c_shr_.clear();
-    c_shr_.shrink_to_fit();
-    c_shr_mac_.clear();
-    c_shr_mac_.shrink_to_fit();
-    delta_x_clear_.clear();
-    delta_x_clear_.shrink_to_fit();
-    delta_y_clear_.clear();
-    delta_y_clear_.shrink_to_fit();
+template <IsSpdz2kShare ShrType>
+void MultiplyGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    auto size_output = this->dim_row() * this->dim_col();
+    mac_check.Add(Delta_z_opened_, std::span<const SemiShrType>(Delta_z_stacked_).subspan(size_output));
 }
 
 } // bioauth
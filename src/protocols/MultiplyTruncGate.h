@@ -26,7 +26,12 @@ public:
 
 protected:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+
+    [[nodiscard]] const std::vector<SemiShrType>& product_lambda_shr() const override { return lambda_prime_shr_; }
+    [[nodiscard]] const std::vector<SemiShrType>& product_lambda_shr_mac() const override {
+        return lambda_prime_shr_mac_;
+    }
 
 private:
     std::vector<SemiShrType> lambda_prime_shr_;
@@ -54,19 +59,19 @@ void MultiplyTruncGate<ShrType>::doReadOfflineFromFile() {
     // The lambda_shr_ in the base class is actually lambda_prime_shr_ here, so is the lambda_shr_mac_.
     // So we compute the real lambda_shr_ in lambda_prime_shr_, and the real lambda_shr_mac_ in lambda_prime_shr_mac_.
     // Then swap the corresponding vectors.
-    lambda_prime_shr_ = this->party().ReadShares(size_output);
-    lambda_prime_shr_mac_ = this->party().ReadShares(size_output);
+    this->party().ReadShares(lambda_prime_shr_, size_output);
+    this->party().ReadShares(lambda_prime_shr_mac_, size_output);
+
+    // The swap is done right after reading, the protocol reaches the prime values through product_lambda_shr().
+    // So the mask of the output is known before the online phase (e.g., to open it early).
+    lambda_prime_shr_.swap(this->lambda_shr());
+    lambda_prime_shr_mac_.swap(this->lambda_shr_mac());
 }
 
 
 template <IsSpdz2kShare ShrType>
-void MultiplyTruncGate<ShrType>::doRunOnline() {
-    MultiplyGate<ShrType>::doRunOnline();
-
-    // The swap is done after the computation of the multiplication,
-    // because the real prime values are used in the protocol.
-    lambda_prime_shr_.swap(this->lambda_shr());
-    lambda_prime_shr_mac_.swap(this->lambda_shr_mac());
+void MultiplyTruncGate<ShrType>::doFinishRound(std::size_t round, MessageBuffer& receive_buffer) {
+    MultiplyGate<ShrType>::doFinishRound(round, receive_buffer);
 
     // Delta_z = Delta_z' / 2^d
     truncateClearVecInplace(this->Delta_clear());
@@ -4,7 +4,6 @@
 
 #include <memory>
 #include <vector>
-#include <thread>
 #include <utils/print_vector.h>
 
 #include "protocols/Gate.h"
@@ -24,12 +23,22 @@ public:
 
     std::vector<ClearType> getClear() const;
 
+    [[nodiscard]] std::size_t num_rounds() const override { return 1; }
+
+    // The round only opens lambda_x, which is known before the online phase,
+    // so the fusion pass lets it share the first round with the input gates
+    [[nodiscard]] bool rounds_use_only_preprocessing() const override { return reveal_early_; }
+    void set_reveal_early(bool reveal_early) { reveal_early_ = reveal_early; }
+
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
 
-    std::vector<SemiShrType> lambda_clear_;
-    std::vector<SemiShrType> output_value_;
+    std::vector<SemiShrType> lambda_clear_; // opened with all its bits for the MAC check
+    std::vector<ClearType> output_value_;
+    bool reveal_early_ = false;
 };
 
 
@@ -46,32 +55,53 @@ void OutputGate<ShrType>::doReadOfflineFromFile() {} // Do nothing
 
 
 template <IsSpdz2kShare ShrType>
-void OutputGate<ShrType>::doRunOnline() {
-    auto size = this->dim_row() * this->dim_col();
-
+void OutputGate<ShrType>::doPrepareRound(std::size_t, MessageBuffer& send_buffer) {
     // std::cerr << "Delta_clear:" << '\n';
     // PrintVector(this->input_x()->Delta_clear());
 
-    std::thread t1([this] {
-        this->party().SendVecToOther(this->input_x()->lambda_shr());
-    });
+    send_buffer.Append(this->input_x()->lambda_shr());
+}
 
-    std::thread t2([this, size] {
-        this->lambda_clear_ = this->party().template ReceiveVecFromOther<SemiShrType>(size);
-    });
 
-    t1.join();
-    t2.join();
+template <IsSpdz2kShare ShrType>
+void OutputGate<ShrType>::doFinishRound(std::size_t, MessageBuffer& receive_buffer) {
+    auto size = this->dim_row() * this->dim_col();
+    lambda_clear_.resize(size);
+    receive_buffer.ReadInto(lambda_clear_.data(), size);
 
     matrixAddAssign(lambda_clear_, this->input_x()->lambda_shr()); // reconstruct $\lambda_x$
-    output_value_ = matrixSubtract(this->input_x()->Delta_clear(), lambda_clear_); // $x = \Delta_x - \lambda_x$
+    if (!reveal_early_) {
+        // $x = \Delta_x - \lambda_x$, in Z_2^K
+        matrixTransform(output_value_, [](ClearType Delta, SemiShrType lambda) {
+            return ShrType::ToClear(static_cast<SemiShrType>(Delta) - lambda);
+        }, this->input_x()->Delta_clear(), lambda_clear_);
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void OutputGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    // $\lambda_x$ is opened with all its bits, it is checked if the input gate has its MAC
+    const auto& lambda_mac = this->input_x()->lambda_shr_mac();
+    if (lambda_mac.size() == lambda_clear_.size()) {
+        mac_check.Add(lambda_clear_, lambda_mac);
+    }
 }
 
 
 template <IsSpdz2kShare ShrType>
 std::vector<typename OutputGate<ShrType>::ClearType> OutputGate<ShrType>::
 getClear() const {
-    return std::vector<ClearType>(output_value_.begin(), output_value_.end());
+    if (reveal_early_) {
+        // $\Delta_x$ was not available yet when $\lambda_x$ was opened, so $x = \Delta_x - \lambda_x$ is computed here
+        const auto& Delta_x = this->input_x()->Delta_clear();
+        std::vector<ClearType> output(Delta_x.size());
+        for (std::size_t i = 0; i < output.size(); ++i) {
+            output[i] = ShrType::ToClear(static_cast<SemiShrType>(Delta_x[i]) - lambda_clear_[i]);
+        }
+        return output;
+    }
+    return output_value_;
 }
 
 } // bioauth
@@ -0,0 +1,311 @@
+#ifndef BIOAUTH_PARALLELEXECUTOR_H
+#define BIOAUTH_PARALLELEXECUTOR_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "networking/Party.h"
+#include "networking/MessageBuffer.h"
+#include "share/IsSpdz2kShare.h"
+#include "utils/ExecutionPlan.h"
+#include "utils/WorkStealingPool.h"
+#include "protocols/Gate.h"
+#include "protocols/MemoryPlanner.h"
+
+
+namespace bioauth {
+
+/// Evaluates the online phase of a circuit as a task graph on a work-stealing pool,
+/// so that gates that do not depend on each other (e.g., two convolution branches) run concurrently.
+///
+/// Each local gate is one task, and each round of an interactive gate is split into a prepare task
+/// and a finish task. The communication of a layer is a task of its own: it depends on the prepare tasks
+/// of the layer and on the exchange of the previous layer, and the finish tasks depend on it.
+/// The layers and the message format are the same as those of RoundScheduler, so the two parties
+/// can evaluate the same circuit with different executors.
+template <IsSpdz2kShare ShrType>
+class ParallelExecutor {
+public:
+    /// Builds the task graph of the plan, the plan must be in topological order.
+    /// With a memory planner, a gate that takes over the Delta buffer of another gate
+    /// starts after all readers of that buffer are done.
+    void Build(const ExecutionPlan<Gate<ShrType>>& plan, const MemoryPlanner<ShrType>* memory_planner = nullptr);
+
+    void Run(Party& party, WorkStealingPool& pool, MemoryPlanner<ShrType>* memory_planner = nullptr);
+
+    /// The number of communication rounds of the last run
+    [[nodiscard]] std::size_t num_rounds() const { return num_rounds_; }
+
+    [[nodiscard]] std::size_t num_tasks() const { return tasks_.size(); }
+
+private:
+    enum class TaskKind { kLocal, kPrepare, kExchange, kFinish };
+
+    struct Task {
+        TaskKind kind;
+        Gate<ShrType>* gate;
+        std::size_t round;
+        std::size_t index; // the message of kPrepare and kFinish, the layer of kExchange
+        Gate<ShrType>* handoff_from = nullptr; // the gate whose Delta buffer is taken over before the task
+    };
+
+    // The message of one round of one gate, kept across runs to reuse the storage
+    struct Message {
+        Gate<ShrType>* gate;
+        std::size_t round;
+        MessageBuffer send_buffer;
+        MessageBuffer receive_buffer;
+    };
+
+    void Execute(std::size_t task, std::size_t worker);
+    void Exchange(std::size_t layer);
+
+    Party* party_ = nullptr;
+    WorkStealingPool* pool_ = nullptr;
+
+    std::vector<Task> tasks_;
+    std::vector<std::size_t> roots_;
+    std::vector<std::size_t> num_dependencies_;
+    std::unique_ptr<std::atomic<std::size_t>[]> pending_;
+
+    // The successors of task i are successors_[successor_offsets_[i] .. successor_offsets_[i + 1]]
+    std::vector<std::size_t> successor_offsets_;
+    std::vector<std::size_t> successors_;
+
+    std::vector<Message> messages_;
+    std::vector<std::vector<std::size_t>> layer_messages_; // the messages of each layer, in the order of the plan
+    std::size_t num_rounds_ = 0;
+
+    // Only one exchange runs at a time
+    MessageBuffer send_buffer_, receive_buffer_;
+    std::vector<std::uint64_t> message_sizes_;
+};
+
+
+template <IsSpdz2kShare ShrType>
+void ParallelExecutor<ShrType>::Build(const ExecutionPlan<Gate<ShrType>>& plan,
+                                      const MemoryPlanner<ShrType>* memory_planner) {
+    tasks_.clear();
+    roots_.clear();
+    messages_.clear();
+    layer_messages_.clear();
+
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    auto add_task = [this](TaskKind kind, Gate<ShrType>* gate, std::size_t round, std::size_t index) {
+        tasks_.push_back({kind, gate, round, index, nullptr});
+        return tasks_.size() - 1;
+    };
+
+    // For each gate in the plan, the layer from which its output is available (as in RoundScheduler),
+    // and the task after which it is available
+    constexpr auto kNoInput = ExecutionPlan<Gate<ShrType>>::kNoInput;
+    std::vector<std::size_t> available(plan.size());
+    std::vector<std::size_t> done(plan.size());
+    std::unordered_map<const Gate<ShrType>*, std::pair<std::size_t, std::size_t>> gate_tasks; // first and done
+    std::vector<std::size_t> message_layers; // the layer of each message, to connect the exchanges later
+
+    for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+        const auto& node = plan.nodes()[idx];
+        std::size_t start = 0;
+        std::vector<std::size_t> inputs;
+        for (auto wire : {node.input_x, node.input_y}) {
+            if (wire != kNoInput && !node.gate->rounds_use_only_preprocessing()) {
+                start = std::max(start, available[wire]);
+                inputs.push_back(done[wire]);
+            }
+        }
+
+        auto rounds = node.gate->num_rounds();
+        if (rounds == 0) {
+            auto task = add_task(TaskKind::kLocal, node.gate, 0, 0);
+            for (auto input : inputs) edges.emplace_back(input, task);
+            done[idx] = task;
+            gate_tasks[node.gate] = {task, task};
+        }
+        else {
+            std::size_t first_prepare = 0;
+            std::size_t previous_finish = 0;
+            for (std::size_t round = 0; round < rounds; ++round) {
+                auto layer = start + round;
+                if (layer_messages_.size() <= layer) {
+                    layer_messages_.resize(layer + 1);
+                }
+                layer_messages_[layer].push_back(messages_.size());
+
+                auto prepare = add_task(TaskKind::kPrepare, node.gate, round, messages_.size());
+                auto finish = add_task(TaskKind::kFinish, node.gate, round, messages_.size());
+                messages_.push_back({node.gate, round, {}, {}});
+
+                if (round == 0) {
+                    first_prepare = prepare;
+                    for (auto input : inputs) edges.emplace_back(input, prepare);
+                }
+                else {
+                    edges.emplace_back(previous_finish, prepare);
+                }
+                message_layers.push_back(layer);
+                previous_finish = finish;
+            }
+            done[idx] = previous_finish;
+            gate_tasks[node.gate] = {first_prepare, previous_finish};
+        }
+        available[idx] = start + rounds;
+    }
+
+    // The exchange of each layer, chained in the order of the layers to keep the messages in order
+    std::vector<std::size_t> exchanges(layer_messages_.size());
+    std::size_t previous_exchange = kNoInput;
+    for (std::size_t layer = 0; layer < layer_messages_.size(); ++layer) {
+        if (layer_messages_[layer].empty()) {
+            continue;
+        }
+        exchanges[layer] = add_task(TaskKind::kExchange, nullptr, 0, layer);
+        if (previous_exchange != kNoInput) {
+            edges.emplace_back(previous_exchange, exchanges[layer]);
+        }
+        previous_exchange = exchanges[layer];
+    }
+    for (std::size_t task = 0; task < tasks_.size(); ++task) {
+        const auto& [kind, gate, round, message, handoff_from] = tasks_[task];
+        if (kind == TaskKind::kPrepare) {
+            edges.emplace_back(task, exchanges[message_layers[message]]);
+        }
+        else if (kind == TaskKind::kFinish) {
+            edges.emplace_back(exchanges[message_layers[message]], task);
+        }
+    }
+
+    if (memory_planner) {
+        for (const auto& handoff : memory_planner->handoffs()) {
+            auto first = gate_tasks.at(handoff.to).first;
+            tasks_[first].handoff_from = handoff.from;
+            for (auto reader : handoff.readers) {
+                edges.emplace_back(gate_tasks.at(reader).second, first);
+            }
+        }
+    }
+
+    // Compress the edges into the successor lists
+    num_dependencies_.assign(tasks_.size(), 0);
+    successor_offsets_.assign(tasks_.size() + 1, 0);
+    for (auto [from, to] : edges) {
+        ++successor_offsets_[from + 1];
+        ++num_dependencies_[to];
+    }
+    for (std::size_t task = 0; task < tasks_.size(); ++task) {
+        successor_offsets_[task + 1] += successor_offsets_[task];
+    }
+    successors_.resize(edges.size());
+    std::vector<std::size_t> fill(successor_offsets_.begin(), successor_offsets_.end() - 1);
+    for (auto [from, to] : edges) {
+        successors_[fill[from]++] = to;
+    }
+
+    for (std::size_t task = 0; task < tasks_.size(); ++task) {
+        if (num_dependencies_[task] == 0) {
+            roots_.push_back(task);
+        }
+    }
+    pending_ = std::make_unique<std::atomic<std::size_t>[]>(tasks_.size());
+}
+
+
+template <IsSpdz2kShare ShrType>
+void ParallelExecutor<ShrType>::Run(Party& party, WorkStealingPool& pool, MemoryPlanner<ShrType>* memory_planner) {
+    if (memory_planner) {
+        memory_planner->Reset();
+    }
+    party_ = &party;
+    pool_ = &pool;
+    num_rounds_ = 0;
+    for (std::size_t task = 0; task < tasks_.size(); ++task) {
+        pending_[task].store(num_dependencies_[task], std::memory_order_relaxed);
+    }
+
+    auto execute = [this](std::size_t task, std::size_t worker) { Execute(task, worker); };
+    pool.Run(roots_, tasks_.size(), execute);
+}
+
+
+template <IsSpdz2kShare ShrType>
+void ParallelExecutor<ShrType>::Execute(std::size_t task_id, std::size_t worker) {
+    const auto& task = tasks_[task_id];
+    if (task.handoff_from) {
+        task.gate->Delta_clear().swap(task.handoff_from->Delta_clear());
+    }
+    switch (task.kind) {
+        case TaskKind::kLocal:
+            task.gate->RunOnline();
+            break;
+        case TaskKind::kPrepare:
+            messages_[task.index].send_buffer.Clear();
+            task.gate->PrepareRound(task.round, messages_[task.index].send_buffer);
+            break;
+        case TaskKind::kExchange:
+            Exchange(task.index);
+            break;
+        case TaskKind::kFinish:
+            task.gate->FinishRound(task.round, messages_[task.index].receive_buffer);
+            break;
+    }
+
+    for (auto i = successor_offsets_[task_id]; i < successor_offsets_[task_id + 1]; ++i) {
+        auto successor = successors_[i];
+        if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pool_->Spawn(worker, successor);
+        }
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void ParallelExecutor<ShrType>::Exchange(std::size_t layer) {
+    const auto& layer_messages = layer_messages_[layer];
+
+    // The messages of the gates, followed by their sizes, see RoundScheduler::Run()
+    send_buffer_.Clear();
+    message_sizes_.clear();
+    std::size_t receive_size = layer_messages.size() * sizeof(std::uint64_t);
+    for (auto message : layer_messages) {
+        const auto& [gate, round, send_buffer, receive_buffer] = messages_[message];
+        send_buffer_.Append(send_buffer.bytes());
+        message_sizes_.push_back(send_buffer.size());
+        receive_size += gate->receive_size(round, send_buffer.size());
+    }
+    send_buffer_.Append(message_sizes_);
+
+    party_->ExchangeWithOther(send_buffer_, receive_buffer_, receive_size);
+
+    // Split the message of the other party, so that the finish tasks can read their parts concurrently
+    const auto& received = receive_buffer_.bytes();
+    auto trailer_size = layer_messages.size() * sizeof(std::uint64_t);
+    if (received.size() < trailer_size) {
+        throw std::runtime_error("The layer message of the other party is too short");
+    }
+    auto trailer = received.data() + received.size() - trailer_size;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < layer_messages.size(); ++i) {
+        std::uint64_t size;
+        std::memcpy(&size, trailer + i * sizeof(size), sizeof(size));
+        if (offset + size > received.size() - trailer_size) {
+            throw std::runtime_error("The layer message of the other party does not match the circuit");
+        }
+
+        auto& receive_buffer = messages_[layer_messages[i]].receive_buffer;
+        receive_buffer.Clear();
+        receive_buffer.bytes().assign(received.begin() + offset, received.begin() + offset + size);
+        offset += size;
+    }
+    ++num_rounds_;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_PARALLELEXECUTOR_H
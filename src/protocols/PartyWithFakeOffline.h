@@ -3,6 +3,9 @@
 #define BIOAUTH_PartyWithFakeOffline_H
 
 
+#include <span>
+#include <vector>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <filesystem>
@@ -28,13 +31,32 @@ public:
 
     std::vector<ClearType> ReadClear(std::size_t num_elements);
 
+    // Read into an existing vector, which does not allocate if its capacity is large enough.
+    // The preprocessing data of consecutive sessions are stored one after another in the file,
+    // so a circuit can be re-armed for the next session by reading into the same buffers.
+    void ReadShares(std::vector<SemiShrType>& shares, std::size_t num_elements);
+
+    // Read into existing storage, e.g., a block of a stacked operand
+    void ReadShares(std::span<SemiShrType> shares);
+
+    void ReadClear(std::vector<ClearType>& clear, std::size_t num_elements);
+
+    // Read the words of bit planes, e.g., the MACs of boolean shares, which are packed in binary
+    void ReadWords(std::vector<uint64_t>& words, std::size_t num_words);
+
+    void ReadWords(std::span<uint64_t> words);
+
     [[nodiscard]] std::ifstream& input_file() { return input_file_; }
 
     [[nodiscard]] GlobalKeyType global_key_shr() const { return global_key_shr_; }
 
+    /// The share of the binary MAC key of the boolean shares, see bit_slicing.h
+    [[nodiscard]] uint64_t bit_key_shr() const { return bit_key_shr_; }
+
 private:
     inline static const std::filesystem::path kFakeOfflineDir{FAKE_OFFLINE_DIR}; // The macro is in CMakeLists.txt
     GlobalKeyType global_key_shr_;
+    uint64_t bit_key_shr_;
     std::ifstream input_file_;
 };
 
@@ -45,31 +67,68 @@ PartyWithFakeOffline(std::size_t p_my_id, std::size_t p_num_parties, std::size_t
     : Party(p_my_id, p_num_parties, p_port) {
     // Open the file for input
     std::string file_name = job_name + (job_name.empty() ? "party-" : "-party-") + std::to_string(p_my_id) + ".txt";
-    input_file_.open(kFakeOfflineDir / file_name);
+    input_file_.open(kFakeOfflineDir / file_name, std::ios::binary);
 
-    // Read the MAC key
-    input_file_ >> global_key_shr_;
+    // Read the MAC keys
+    input_file_ >> global_key_shr_ >> bit_key_shr_;
 }
 
 
 template <IsSpdz2kShare ShrType>
 std::vector<typename PartyWithFakeOffline<ShrType>::SemiShrType> PartyWithFakeOffline<ShrType>::
 ReadShares(std::size_t num_elements) {
-    auto shares = std::vector<SemiShrType>(num_elements);
-    for (auto& share : shares) {
-        input_file_ >> share;
-    }
+    std::vector<SemiShrType> shares;
+    ReadShares(shares, num_elements);
     return shares;
 }
 
 template <IsSpdz2kShare ShrType>
 std::vector<typename PartyWithFakeOffline<ShrType>::ClearType> PartyWithFakeOffline<ShrType>::
 ReadClear(std::size_t num_elements) {
-    auto clear = std::vector<ClearType>(num_elements);
+    std::vector<ClearType> clear;
+    ReadClear(clear, num_elements);
+    return clear;
+}
+
+template <IsSpdz2kShare ShrType>
+void PartyWithFakeOffline<ShrType>::
+ReadShares(std::vector<SemiShrType>& shares, std::size_t num_elements) {
+    shares.resize(num_elements);
+    ReadShares(std::span<SemiShrType>(shares));
+}
+
+template <IsSpdz2kShare ShrType>
+void PartyWithFakeOffline<ShrType>::
+ReadShares(std::span<SemiShrType> shares) {
+    for (auto& share : shares) {
+        input_file_ >> share;
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void PartyWithFakeOffline<ShrType>::
+ReadClear(std::vector<ClearType>& clear, std::size_t num_elements) {
+    clear.resize(num_elements);
     for (auto& c : clear) {
         input_file_ >> c;
     }
-    return clear;
+}
+
+template <IsSpdz2kShare ShrType>
+void PartyWithFakeOffline<ShrType>::
+ReadWords(std::vector<uint64_t>& words, std::size_t num_words) {
+    words.resize(num_words);
+    ReadWords(std::span<uint64_t>(words));
+}
+
+template <IsSpdz2kShare ShrType>
+void PartyWithFakeOffline<ShrType>::
+ReadWords(std::span<uint64_t> words) {
+    // The words follow the end of the line of what was read before them
+    if (input_file_.get() != '\n'
+        || !input_file_.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size_bytes()))) {
+        throw std::runtime_error("Failed to read the words of the preprocessing data");
+    }
 }
 
 } // namespace bioauth
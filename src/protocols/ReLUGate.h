@@ -23,11 +23,18 @@ public:
 
     explicit ReLUGate(const std::shared_ptr<Gate<ShrType>>& input_x);
 
+    [[nodiscard]] std::size_t num_rounds() const override;
+
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    // The rounds of the inner GtzGate come first, followed by the rounds of the multiplication
+    void doPrepareRound(std::size_t round, MessageBuffer& send_buffer) override;
+    void doFinishRound(std::size_t round, MessageBuffer& receive_buffer) override;
+    void doCollectOpenings(MacCheck<ShrType>& mac_check) const override;
 
     Circuit<ShrType> circuit_;
+    std::shared_ptr<Gate<ShrType>> gtz_;
+    std::shared_ptr<Gate<ShrType>> multiply_;
 };
 
 template <IsSpdz2kShare ShrType>
@@ -37,9 +44,14 @@ ReLUGate(const std::shared_ptr<Gate<ShrType>>& input_x)
     this->set_dim_row(input_x->dim_row());
     this->set_dim_col(input_x->dim_col());
 
-    auto b = circuit_.gtz(input_x);
-    auto z = circuit_.elementMultiply(this->input_x(), b);
-    circuit_.addEndpoint(z);
+    gtz_ = circuit_.gtz(input_x);
+    multiply_ = circuit_.elementMultiply(this->input_x(), gtz_);
+    circuit_.addEndpoint(multiply_);
+}
+
+template <IsSpdz2kShare ShrType>
+std::size_t ReLUGate<ShrType>::num_rounds() const {
+    return gtz_->num_rounds() + multiply_->num_rounds();
 }
 
 template <IsSpdz2kShare ShrType>
@@ -49,9 +61,33 @@ void ReLUGate<ShrType>::doReadOfflineFromFile() {
 }
 
 template <IsSpdz2kShare ShrType>
-void ReLUGate<ShrType>::doRunOnline() {
-    circuit_.runOnline();
-    this->Delta_clear() = this->circuit_.endpoints()[0]->Delta_clear();
+void ReLUGate<ShrType>::doPrepareRound(std::size_t round, MessageBuffer& send_buffer) {
+    if (round < gtz_->num_rounds()) {
+        gtz_->PrepareRound(round, send_buffer);
+    }
+    else {
+        multiply_->PrepareRound(round - gtz_->num_rounds(), send_buffer);
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void ReLUGate<ShrType>::doFinishRound(std::size_t round, MessageBuffer& receive_buffer) {
+    if (round < gtz_->num_rounds()) {
+        gtz_->FinishRound(round, receive_buffer);
+    }
+    else {
+        multiply_->FinishRound(round - gtz_->num_rounds(), receive_buffer);
+    }
+
+    if (round + 1 == num_rounds()) {
+        this->Delta_clear() = multiply_->Delta_clear();
+    }
+}
+
+template <IsSpdz2kShare ShrType>
+void ReLUGate<ShrType>::doCollectOpenings(MacCheck<ShrType>& mac_check) const {
+    gtz_->CollectOpenings(mac_check);
+    multiply_->CollectOpenings(mac_check);
 }
 
 } // namespace bioauth
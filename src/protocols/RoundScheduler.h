@@ -0,0 +1,143 @@
+
+#ifndef BIOAUTH_ROUNDSCHEDULER_H
+#define BIOAUTH_ROUNDSCHEDULER_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+#include "networking/Party.h"
+#include "networking/MessageBuffer.h"
+#include "share/IsSpdz2kShare.h"
+#include "utils/ExecutionPlan.h"
+#include "protocols/Gate.h"
+#include "protocols/MemoryPlanner.h"
+
+
+namespace bioauth {
+
+/// Evaluates the online phase of a circuit layer by layer.
+/// The gates are sorted into communication layers according to their depth in rounds:
+/// a gate starts in the first layer where all of its inputs are available,
+/// and an interactive gate occupies one layer per communication round.
+/// The messages of all gates in the same layer are merged, so each layer costs
+/// exactly one exchange per direction, regardless of the number of gates in it.
+/// A layer message ends with the sizes of the messages of its gates, which the serial walk ignores,
+/// but which allows ParallelExecutor to split the message and finish the gates concurrently.
+template <IsSpdz2kShare ShrType>
+class RoundScheduler {
+public:
+    /// Sorts the gates of the plan into layers, the plan must be in topological order
+    void Build(const ExecutionPlan<Gate<ShrType>>& plan);
+
+    /// Runs the layers, handing the Delta buffers between the gates according to `memory_planner` if given
+    void Run(Party& party, MemoryPlanner<ShrType>* memory_planner = nullptr);
+
+    /// The number of communication rounds of the last run
+    [[nodiscard]] std::size_t num_rounds() const { return num_rounds_; }
+
+    [[nodiscard]] std::size_t num_layers() const { return layers_.size(); }
+
+    /// The first layer of each gate of the plan
+    [[nodiscard]] const std::vector<std::size_t>& start_layers() const { return start_layers_; }
+
+private:
+    struct Layer {
+        // Local gates are evaluated first, in topological order
+        std::vector<Gate<ShrType>*> local_gates;
+        // Interactive gates, with the round of each gate that falls into this layer
+        std::vector<std::pair<Gate<ShrType>*, std::size_t>> round_gates;
+    };
+
+    std::vector<Layer> layers_;
+    std::vector<std::size_t> start_layers_;
+    std::size_t num_rounds_ = 0;
+
+    // Kept across runs, so that later sessions reuse their storage
+    MessageBuffer send_buffer_, receive_buffer_;
+    std::vector<std::uint64_t> message_sizes_;
+};
+
+
+template <IsSpdz2kShare ShrType>
+void RoundScheduler<ShrType>::Build(const ExecutionPlan<Gate<ShrType>>& plan) {
+    layers_.clear();
+    start_layers_.resize(plan.size());
+
+    // The layer from which the output of each gate in the plan is available,
+    // gates outside the plan have been evaluated before and are available from the beginning
+    std::vector<std::size_t> available(plan.size());
+    auto available_at = [&available](std::size_t wire) {
+        return wire == ExecutionPlan<Gate<ShrType>>::kNoInput ? 0 : available[wire];
+    };
+
+    for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+        const auto& node = plan.nodes()[idx];
+        auto start = node.gate->rounds_use_only_preprocessing()
+                         ? 0 : std::max(available_at(node.input_x), available_at(node.input_y));
+
+        start_layers_[idx] = start;
+
+        auto rounds = node.gate->num_rounds();
+        if (layers_.size() < start + rounds + 1) {
+            layers_.resize(start + rounds + 1);
+        }
+
+        if (rounds == 0) {
+            layers_[start].local_gates.push_back(node.gate);
+        }
+        else {
+            for (std::size_t round = 0; round < rounds; ++round) {
+                layers_[start + round].round_gates.emplace_back(node.gate, round);
+            }
+        }
+        available[idx] = start + rounds;
+    }
+}
+
+
+template <IsSpdz2kShare ShrType>
+void RoundScheduler<ShrType>::Run(Party& party, MemoryPlanner<ShrType>* memory_planner) {
+    num_rounds_ = 0;
+    if (memory_planner) {
+        memory_planner->Reset();
+    }
+
+    for (std::size_t layer_index = 0; layer_index < layers_.size(); ++layer_index) {
+        const auto& layer = layers_[layer_index];
+        if (memory_planner) {
+            memory_planner->RunHandoffs(layer_index);
+        }
+        for (auto gate : layer.local_gates) {
+            gate->RunOnline();
+        }
+
+        if (layer.round_gates.empty()) {
+            continue;
+        }
+
+        send_buffer_.Clear();
+        message_sizes_.clear();
+        // The message of the other party holds the messages of the same gates, followed by their sizes
+        std::size_t receive_size = layer.round_gates.size() * sizeof(std::uint64_t);
+        for (auto [gate, round] : layer.round_gates) {
+            auto begin = send_buffer_.size();
+            gate->PrepareRound(round, send_buffer_);
+            message_sizes_.push_back(send_buffer_.size() - begin);
+            receive_size += gate->receive_size(round, message_sizes_.back());
+        }
+        send_buffer_.Append(message_sizes_);
+
+        party.ExchangeWithOther(send_buffer_, receive_buffer_, receive_size);
+
+        for (auto [gate, round] : layer.round_gates) {
+            gate->FinishRound(round, receive_buffer_);
+        }
+        ++num_rounds_;
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_ROUNDSCHEDULER_H
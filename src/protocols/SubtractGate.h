@@ -6,23 +6,26 @@
 #include <memory>
 #include <vector>
 
-#include "protocols/Gate.h"
+#include "protocols/LinearGate.h"
 #include "share/IsSpdz2kShare.h"
 #include "utils/linear_algebra.h"
 
 namespace bioauth {
 
 template <IsSpdz2kShare ShrType>
-class SubtractGate : public Gate<ShrType> {
+class SubtractGate : public LinearGate<ShrType> {
 public:
     using SemiShrType = typename ShrType::SemiShrType;
+    using ClearType = typename ShrType::ClearType;
+    using Term = typename LinearGate<ShrType>::Term;
 
     SubtractGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
                  const std::shared_ptr<Gate<ShrType>>& p_input_y);
 
 private:
     void doReadOfflineFromFile() override;
-    void doRunOnline() override;
+    void doRunLinear() override;
+    void doAppendLinearForm(std::vector<Term>& terms, ClearType& constant) const override;
 };
 
 
@@ -30,7 +33,7 @@ template <IsSpdz2kShare ShrType>
 SubtractGate<ShrType>::
 SubtractGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
              const std::shared_ptr<Gate<ShrType>>& p_input_y)
-    : Gate<ShrType>(p_input_x, p_input_y) {
+    : LinearGate<ShrType>(p_input_x, p_input_y) {
     if (p_input_x->dim_row() != p_input_y->dim_row() ||
         p_input_x->dim_col() != p_input_y->dim_col()) {
         throw std::invalid_argument("The inputs of subtraction gate should have the same dimensions");
@@ -41,12 +44,24 @@ SubtractGate(const std::shared_ptr<Gate<ShrType>>& p_input_x,
 
 
 template <IsSpdz2kShare ShrType>
-void SubtractGate<ShrType>::doReadOfflineFromFile() {} // do nothing
+void SubtractGate<ShrType>::doReadOfflineFromFile() {
+    // The shares of lambda written by FakeSubtractGate
+    auto size = this->dim_row() * this->dim_col();
+    this->party().ReadShares(this->lambda_shr(), size);
+    this->party().ReadShares(this->lambda_shr_mac(), size);
+}
+
+
+template <IsSpdz2kShare ShrType>
+void SubtractGate<ShrType>::doRunLinear() {
+    matrixSubtract(this->input_x()->Delta_clear(), this->input_y()->Delta_clear(), this->Delta_clear());
+}
 
 
 template <IsSpdz2kShare ShrType>
-void SubtractGate<ShrType>::doRunOnline() {
-    this->Delta_clear() = matrixSubtract(this->input_x()->Delta_clear(), this->input_y()->Delta_clear());
+void SubtractGate<ShrType>::doAppendLinearForm(std::vector<Term>& terms, ClearType&) const {
+    terms.push_back({this->input_x().get(), 1});
+    terms.push_back({this->input_y().get(), ClearType(-1)});
 }
 
 } // bioauth
@@ -7,16 +7,23 @@
 #include <cstddef>
 #include <type_traits>
 
+#include "WideUint.h"
+
 namespace  bioauth {
 
-/// Represent an integer modulo 2^N, N should be less than or equal to 128
+/// Represent an integer modulo 2^N, N should be less than or equal to 256.
+/// Above 128 bits, the integers have 192 or 256 bits, see WideUint
 template <std::size_t N>
 using Mod2PowN_t =
 std::conditional_t<N <= 32,
                    uint32_t,
                    std::conditional_t<N <= 64,
                                       uint64_t,
-                                      __uint128_t>>;
+                                      std::conditional_t<N <= 128,
+                                                         __uint128_t,
+                                                         std::conditional_t<N <= 192,
+                                                                            WideUint<3>,
+                                                                            WideUint<4>>>>>;
 
 } // namespace bioauth
 #endif //BIOAUTH_MOD2POWN_H
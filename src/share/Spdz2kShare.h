@@ -7,9 +7,11 @@
 #include <cstddef>
 #include <vector>
 #include <algorithm>
-#include <execution>
+#include <concepts>
 
 #include "Mod2PowN.h"
+#include "utils/limb_arithmetic.h"
+#include "utils/parallel_for.h"
 
 
 namespace bioauth{
@@ -33,10 +35,19 @@ public:
 
     constexpr static std::size_t kBits = K;
     constexpr static std::size_t sBits = S;
+    /// The bytes of a public value of Z_2^K on the wire, fewer than sizeof(ClearType) if K is not a power of 2
+    constexpr static std::size_t kClearBytes = (K + 7) / 8;
 
     static SemiShrType RemoveUpperBits(SemiShrType value);
     static std::vector<SemiShrType> RemoveUpperBits(const std::vector<SemiShrType>& values);
+    // Writes the values without their upper bits into an existing vector, which may be `values`
+    static void RemoveUpperBits(const std::vector<SemiShrType>& values, std::vector<SemiShrType>& output);
     static void RemoveUpperBitsInplace(std::vector<SemiShrType>& values);
+
+    /// The public value of Z_2^K that an opened value of Z_2^(K+S) stands for, i.e., its lower K bits
+    static ClearType ToClear(SemiShrType value);
+    // Writes the public values into an existing vector, which does not allocate if its capacity is large enough
+    static void ToClear(const std::vector<SemiShrType>& values, std::vector<ClearType>& output);
 };
 
 using Spdz2kShare32 = Spdz2kShare<32, 32>;
@@ -48,8 +59,10 @@ using Spdz2kShare128 = Spdz2kShare<128, 128>;
 template <std::size_t K, std::size_t S>
 typename Spdz2kShare<K, S>::SemiShrType Spdz2kShare<K, S>::
 RemoveUpperBits(SemiShrType value) {
-    if constexpr (S > 0) {
-        return (value << S) >> S;
+    // Keeps the lower K bits, the shares of Z_2^(K+S) may be stored in a wider integer, e.g., 144 bits in 192 bits
+    constexpr std::size_t kUpperBits = 8 * sizeof(SemiShrType) - K;
+    if constexpr (kUpperBits > 0) {
+        return (value << kUpperBits) >> kUpperBits;
     } else {
         return value;
     }
@@ -59,32 +72,60 @@ RemoveUpperBits(SemiShrType value) {
 template <std::size_t K, std::size_t S>
 std::vector<typename Spdz2kShare<K, S>::SemiShrType> Spdz2kShare<K, S>::
 RemoveUpperBits(const std::vector<SemiShrType>& values) {
-    std::vector<SemiShrType> ret(values.size());
+    std::vector<SemiShrType> ret;
+    RemoveUpperBits(values, ret);
+    return ret;
+}
 
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(values.begin(), values.end(), ret.begin(),
-                   [](SemiShrType value) { return RemoveUpperBits(value); });
-#else
-    std::transform(std::execution::par_unseq,
-                   values.begin(), values.end(), ret.begin(),
-                   [](SemiShrType value) { return RemoveUpperBits(value); });
-#endif
 
-    return ret;
+template <std::size_t K, std::size_t S>
+void Spdz2kShare<K, S>::
+RemoveUpperBits(const std::vector<SemiShrType>& values, std::vector<SemiShrType>& output) {
+    output.resize(values.size());
+
+    // The 128-bit shares are masked by the vector kernels, the compiler does not vectorize them
+    if constexpr (std::same_as<SemiShrType, __uint128_t>) {
+        limbBitAnd(values.data(), RemoveUpperBits(~SemiShrType(0)), output.data(), values.size());
+        return;
+    }
+
+    const auto* in = values.data();
+    auto* out = output.data();
+    parallelFor<SemiShrType>(values.size(), [in, out](std::size_t begin, std::size_t end) {
+        BIOAUTH_SIMD_LOOP
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            out[idx] = RemoveUpperBits(in[idx]);
+        }
+    });
 }
 
 
 template <std::size_t K, std::size_t S>
 void Spdz2kShare<K, S>::
 RemoveUpperBitsInplace(std::vector<SemiShrType>& values) {
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(values.begin(), values.end(), values.begin(),
-                   [](SemiShrType value) { return RemoveUpperBits(value); });
-#else
-    std::transform(std::execution::par_unseq,
-                   values.begin(), values.end(), values.begin(),
-                   [](SemiShrType value) { return RemoveUpperBits(value); });
-#endif
+    RemoveUpperBits(values, values);
+}
+
+
+template <std::size_t K, std::size_t S>
+typename Spdz2kShare<K, S>::ClearType Spdz2kShare<K, S>::
+ToClear(SemiShrType value) {
+    return static_cast<ClearType>(RemoveUpperBits(value));
+}
+
+
+template <std::size_t K, std::size_t S>
+void Spdz2kShare<K, S>::
+ToClear(const std::vector<SemiShrType>& values, std::vector<ClearType>& output) {
+    output.resize(values.size());
+    const auto* in = values.data();
+    auto* out = output.data();
+    parallelFor<SemiShrType>(values.size(), [in, out](std::size_t begin, std::size_t end) {
+        BIOAUTH_SIMD_LOOP
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            out[idx] = ToClear(in[idx]);
+        }
+    });
 }
 
 
@@ -0,0 +1,262 @@
+/// @file
+/// Defines the unsigned integers wider than 128 bits, for the rings Z_2^N with 128 < N <= 256
+
+#ifndef BIOAUTH_WIDEUINT_H
+#define BIOAUTH_WIDEUINT_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <compare>
+#include <concepts>
+#include <type_traits>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+namespace bioauth {
+
+/// An unsigned integer of kLimbs 64-bit limbs, the least significant limb first, with wrap-around arithmetic
+/// modulo 2^(64 * kLimbs) like the built-in unsigned integers.
+/// It has the same size as its limbs and no padding, so vectors of it are sent and stored as raw bytes.
+///
+/// The products are truncated to kLimbs limbs and computed by the schoolbook method,
+/// which needs kLimbs * (kLimbs + 1) / 2 multiplications of 64-bit limbs, e.g., 6 for 192 bits and 10 for 256 bits.
+/// Karatsuba saves fewer multiplications than it costs additions for so few limbs.
+template <std::size_t kLimbs>
+class WideUint {
+    static_assert(kLimbs > 2, "Use the built-in integers up to 128 bits");
+
+public:
+    static constexpr std::size_t kBits = 64 * kLimbs;
+
+    constexpr WideUint() : limbs_{} {}
+
+    /// Converts an integer as the built-in unsigned integers do: negative values are sign-extended
+    template <std::integral T>
+    constexpr WideUint(T value) : limbs_{} {
+        limbs_[0] = static_cast<std::uint64_t>(value);
+        if constexpr (sizeof(T) > 8) {
+            limbs_[1] = static_cast<std::uint64_t>(static_cast<__uint128_t>(value) >> 64);
+        }
+        if constexpr (std::is_signed_v<T> || std::same_as<T, __int128>) {
+            if (value < 0) {
+                std::fill(limbs_.begin() + (sizeof(T) > 8 ? 2 : 1), limbs_.end(), ~std::uint64_t(0));
+            }
+        }
+    }
+
+    /// Converts to a narrower or wider integer, keeping the lower bits of the value
+    template <std::size_t kOtherLimbs>
+    constexpr explicit WideUint(const WideUint<kOtherLimbs>& other) : limbs_{} {
+        for (std::size_t i = 0; i < std::min(kLimbs, kOtherLimbs); ++i) {
+            limbs_[i] = other.limb(i);
+        }
+    }
+
+    /// Keeps the lower bits of the value, as a cast between built-in integers does
+    template <std::integral T>
+    constexpr explicit operator T() const {
+        if constexpr (sizeof(T) > 8) {
+            return static_cast<T>(static_cast<__uint128_t>(limbs_[1]) << 64 | limbs_[0]);
+        }
+        else {
+            return static_cast<T>(limbs_[0]);
+        }
+    }
+
+    constexpr explicit operator bool() const {
+        return std::ranges::any_of(limbs_, [](std::uint64_t limb) { return limb != 0; });
+    }
+
+    [[nodiscard]] constexpr std::uint64_t limb(std::size_t idx) const { return limbs_[idx]; }
+    constexpr std::uint64_t& limb(std::size_t idx) { return limbs_[idx]; }
+
+    // The loops over the limbs are unrolled and write to a local result, so that the limbs stay in registers
+    // and the carries are chained through the carry flag (adc, sbb)
+    constexpr WideUint& operator+=(const WideUint& other) {
+        std::array<std::uint64_t, kLimbs> sum;
+        bool carry = false;
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < kLimbs; ++i) {
+            bool carry_limbs = __builtin_add_overflow(limbs_[i], other.limbs_[i], &sum[i]);
+            bool carry_in = __builtin_add_overflow(sum[i], static_cast<std::uint64_t>(carry), &sum[i]);
+            carry = carry_limbs | carry_in;
+        }
+        limbs_ = sum;
+        return *this;
+    }
+
+    constexpr WideUint& operator-=(const WideUint& other) {
+        std::array<std::uint64_t, kLimbs> difference;
+        bool borrow = false;
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < kLimbs; ++i) {
+            bool borrow_limbs = __builtin_sub_overflow(limbs_[i], other.limbs_[i], &difference[i]);
+            bool borrow_in = __builtin_sub_overflow(difference[i], static_cast<std::uint64_t>(borrow), &difference[i]);
+            borrow = borrow_limbs | borrow_in;
+        }
+        limbs_ = difference;
+        return *this;
+    }
+
+    constexpr WideUint& operator*=(const WideUint& other) {
+        std::array<std::uint64_t, kLimbs> product{};
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < kLimbs; ++i) {
+            std::uint64_t carry = 0;
+            // The products of limbs i and j with i + j >= kLimbs only reach the bits above the result
+#pragma GCC unroll 4
+            for (std::size_t j = 0; i + j < kLimbs; ++j) {
+                auto partial = static_cast<__uint128_t>(limbs_[i]) * other.limbs_[j] + product[i + j] + carry;
+                product[i + j] = static_cast<std::uint64_t>(partial);
+                carry = static_cast<std::uint64_t>(partial >> 64);
+            }
+        }
+        limbs_ = product;
+        return *this;
+    }
+
+    constexpr WideUint& operator&=(const WideUint& other) {
+        for (std::size_t i = 0; i < kLimbs; ++i) limbs_[i] &= other.limbs_[i];
+        return *this;
+    }
+
+    constexpr WideUint& operator|=(const WideUint& other) {
+        for (std::size_t i = 0; i < kLimbs; ++i) limbs_[i] |= other.limbs_[i];
+        return *this;
+    }
+
+    constexpr WideUint& operator^=(const WideUint& other) {
+        for (std::size_t i = 0; i < kLimbs; ++i) limbs_[i] ^= other.limbs_[i];
+        return *this;
+    }
+
+    constexpr WideUint& operator<<=(std::size_t shift) {
+        if (shift >= kBits) {
+            return *this = WideUint();
+        }
+        auto limb_shift = shift / 64;
+        auto bit_shift = shift % 64;
+        for (std::size_t i = kLimbs; i-- > 0;) {
+            std::uint64_t limb = i >= limb_shift ? limbs_[i - limb_shift] << bit_shift : 0;
+            if (bit_shift != 0 && i > limb_shift) {
+                limb |= limbs_[i - limb_shift - 1] >> (64 - bit_shift);
+            }
+            limbs_[i] = limb;
+        }
+        return *this;
+    }
+
+    constexpr WideUint& operator>>=(std::size_t shift) {
+        if (shift >= kBits) {
+            return *this = WideUint();
+        }
+        auto limb_shift = shift / 64;
+        auto bit_shift = shift % 64;
+        for (std::size_t i = 0; i < kLimbs; ++i) {
+            std::uint64_t limb = i + limb_shift < kLimbs ? limbs_[i + limb_shift] >> bit_shift : 0;
+            if (bit_shift != 0 && i + limb_shift + 1 < kLimbs) {
+                limb |= limbs_[i + limb_shift + 1] << (64 - bit_shift);
+            }
+            limbs_[i] = limb;
+        }
+        return *this;
+    }
+
+    constexpr WideUint& operator++() { return *this += WideUint(1); }
+    constexpr WideUint& operator--() { return *this -= WideUint(1); }
+
+    friend constexpr WideUint operator+(WideUint x, const WideUint& y) { return x += y; }
+    friend constexpr WideUint operator-(WideUint x, const WideUint& y) { return x -= y; }
+    friend constexpr WideUint operator*(WideUint x, const WideUint& y) { return x *= y; }
+    friend constexpr WideUint operator&(WideUint x, const WideUint& y) { return x &= y; }
+    friend constexpr WideUint operator|(WideUint x, const WideUint& y) { return x |= y; }
+    friend constexpr WideUint operator^(WideUint x, const WideUint& y) { return x ^= y; }
+    friend constexpr WideUint operator<<(WideUint x, std::size_t shift) { return x <<= shift; }
+    friend constexpr WideUint operator>>(WideUint x, std::size_t shift) { return x >>= shift; }
+
+    constexpr WideUint operator-() const { return WideUint() - *this; }
+    constexpr WideUint operator+() const { return *this; }
+
+    constexpr WideUint operator~() const {
+        WideUint result;
+        for (std::size_t i = 0; i < kLimbs; ++i) result.limbs_[i] = ~limbs_[i];
+        return result;
+    }
+
+    friend constexpr bool operator==(const WideUint& x, const WideUint& y) = default;
+
+    friend constexpr std::strong_ordering operator<=>(const WideUint& x, const WideUint& y) {
+        for (std::size_t i = kLimbs; i-- > 0;) {
+            if (x.limbs_[i] != y.limbs_[i]) {
+                return x.limbs_[i] <=> y.limbs_[i];
+            }
+        }
+        return std::strong_ordering::equal;
+    }
+
+    /// Divides by a 64-bit divisor in place and returns the remainder, e.g., to print the value
+    constexpr std::uint64_t DivideInplace(std::uint64_t divisor) {
+        __uint128_t remainder = 0;
+        for (std::size_t i = kLimbs; i-- > 0;) {
+            auto dividend = remainder << 64 | limbs_[i];
+            limbs_[i] = static_cast<std::uint64_t>(dividend / divisor);
+            remainder = dividend % divisor;
+        }
+        return static_cast<std::uint64_t>(remainder);
+    }
+
+private:
+    std::array<std::uint64_t, kLimbs> limbs_;
+};
+
+
+template <typename T>
+struct is_wide_uint : std::false_type {};
+
+template <std::size_t kLimbs>
+struct is_wide_uint<WideUint<kLimbs>> : std::true_type {};
+
+/// The elements of the rings Z_2^N: the built-in integers up to 128 bits and the wide integers above
+template <typename T>
+concept RingElement = std::integral<T> || is_wide_uint<T>::value;
+
+
+/// Prints the value in decimal, as the offline data is stored
+template <std::size_t kLimbs>
+std::ostream& operator<<(std::ostream& os, WideUint<kLimbs> x) {
+    constexpr std::uint64_t kChunk = 10'000'000'000'000'000'000ull; // the largest power of 10 in a limb
+    std::string digits;
+    do {
+        auto chunk = x.DivideInplace(kChunk);
+        for (int digit = 0; digit < 19 && (x || chunk != 0); ++digit) {
+            digits += static_cast<char>('0' + chunk % 10);
+            chunk /= 10;
+        }
+    } while (x);
+    if (digits.empty()) {
+        digits = "0";
+    }
+    std::ranges::reverse(digits);
+    return os << digits;
+}
+
+template <std::size_t kLimbs>
+std::istream& operator>>(std::istream& is, WideUint<kLimbs>& x) {
+    std::string digits;
+    is >> digits;
+    x = WideUint<kLimbs>();
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            throw std::runtime_error("Invalid input: Non-digit characters present.");
+        }
+        x = x * WideUint<kLimbs>(10) + WideUint<kLimbs>(c - '0');
+    }
+    return is;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_WIDEUINT_H
@@ -0,0 +1,104 @@
+
+#ifndef BIOAUTH_EXECUTIONPLAN_H
+#define BIOAUTH_EXECUTIONPLAN_H
+
+#include <memory>
+#include <vector>
+#include <limits>
+#include <utility>
+#include <cstddef>
+#include <ranges>
+#include <unordered_map>
+
+
+namespace bioauth {
+
+/// A topological order of the gates of a circuit, computed once and replayed by every phase.
+/// The gates are kept in a flat array and the wires are indices into this array,
+/// so replaying the plan is a linear scan without recursion or per-gate bookkeeping.
+/// Works for any gate type that exposes input_x() and input_y() as (possibly null) shared pointers.
+template <typename GateType>
+class ExecutionPlan {
+public:
+    /// The wire index of a missing input, or of an input that does not belong to the circuit
+    static constexpr std::size_t kNoInput = std::numeric_limits<std::size_t>::max();
+
+    struct Node {
+        GateType* gate;
+        std::size_t input_x;
+        std::size_t input_y;
+    };
+
+    /// Sorts the gates needed by the endpoints in depth-first post-order, visiting input_x before input_y.
+    /// Only the gates in `gates` are placed in the plan; the other gates reachable from the endpoints
+    /// (e.g., the outer inputs of a sub-circuit) are treated as evaluated elsewhere.
+    void Build(const std::vector<std::shared_ptr<GateType>>& gates,
+               const std::vector<std::shared_ptr<GateType>>& endpoints);
+
+    [[nodiscard]] const std::vector<Node>& nodes() const { return nodes_; }
+
+    [[nodiscard]] std::size_t size() const { return nodes_.size(); }
+
+    [[nodiscard]] auto begin() const { return nodes_.begin(); }
+    [[nodiscard]] auto end() const { return nodes_.end(); }
+
+private:
+    std::vector<Node> nodes_;
+};
+
+
+template <typename GateType>
+void ExecutionPlan<GateType>::Build(const std::vector<std::shared_ptr<GateType>>& gates,
+                                    const std::vector<std::shared_ptr<GateType>>& endpoints) {
+    nodes_.clear();
+    nodes_.reserve(gates.size());
+
+    // The position of each gate in the plan, only the gates of the circuit are in this map
+    constexpr std::size_t kNotPlaced = kNoInput;
+    std::unordered_map<const GateType*, std::size_t> position;
+    position.reserve(gates.size());
+    for (const auto& gate : gates) {
+        position.emplace(gate.get(), kNotPlaced);
+    }
+
+    auto wire = [&position](const GateType* gate) {
+        auto it = gate ? position.find(gate) : position.end();
+        return it == position.end() ? kNoInput : it->second;
+    };
+    auto needs_visit = [&position](const GateType* gate) {
+        auto it = gate ? position.find(gate) : position.end();
+        return it != position.end() && it->second == kNotPlaced;
+    };
+
+    // Depth-first traversal with an explicit stack, so deep circuits cannot overflow the call stack
+    std::vector<std::pair<GateType*, bool>> stack;
+    for (const auto& endpoint : endpoints | std::views::reverse) {
+        stack.emplace_back(endpoint.get(), false);
+    }
+
+    while (!stack.empty()) {
+        auto [gate, inputs_visited] = stack.back();
+        stack.pop_back();
+
+        if (!needs_visit(gate)) {
+            continue;
+        }
+
+        auto input_x = gate->input_x().get();
+        auto input_y = gate->input_y().get();
+
+        if (!inputs_visited) {
+            stack.emplace_back(gate, true);
+            if (needs_visit(input_y)) stack.emplace_back(input_y, false);
+            if (needs_visit(input_x)) stack.emplace_back(input_x, false);
+            continue;
+        }
+
+        position[gate] = nodes_.size();
+        nodes_.push_back({gate, wire(input_x), wire(input_y)});
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_EXECUTIONPLAN_H
@@ -0,0 +1,54 @@
+#ifndef BIOAUTH_MEMORYSTATS_H
+#define BIOAUTH_MEMORYSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace bioauth {
+
+/// The peak resident set size of the process in bytes (VmHWM), or 0 where it cannot be read
+inline std::size_t PeakResidentBytes() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.starts_with("VmHWM:")) {
+            return std::stoull(line.substr(6)) * 1024; // the size is given in kB
+        }
+    }
+#endif
+    return 0;
+}
+
+/// Resets the peak resident set size to the current one, so that the peak of each phase can be measured on its own
+inline void ResetPeakResident() {
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+/// Asks the kernel to back the pages of a buffer with transparent huge pages.
+/// Only takes effect for the pages that are touched afterwards, and only where supported.
+inline void AdviseHugePages(void* data, std::size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    constexpr std::uintptr_t kPageSize = 4096;
+    auto begin = (reinterpret_cast<std::uintptr_t>(data) + kPageSize - 1) & ~(kPageSize - 1);
+    auto end = (reinterpret_cast<std::uintptr_t>(data) + bytes) & ~(kPageSize - 1);
+    if (begin < end) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+    }
+#else
+    (void) data;
+    (void) bytes;
+#endif
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_MEMORYSTATS_H
@@ -20,6 +20,10 @@ long long Timer::elapsed() const {
     return std::chrono::duration_cast<std::chrono::milliseconds>(stop_ - start_).count();
 }
 
+long long Timer::elapsedMicroseconds() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(stop_ - start_).count();
+}
+
 void Timer::printElapsed() const {
     std::cout << "Elapsed time: " << elapsed() << " ms\n";
 }
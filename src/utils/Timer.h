@@ -18,6 +18,8 @@ public:
 
     [[nodiscard]] long long elapsed() const;
 
+    [[nodiscard]] long long elapsedMicroseconds() const;
+
     void printElapsed() const;
 
     template <typename Func, typename... Args>
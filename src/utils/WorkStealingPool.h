@@ -0,0 +1,252 @@
+
+#ifndef BIOAUTH_WORKSTEALINGPOOL_H
+#define BIOAUTH_WORKSTEALINGPOOL_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace bioauth {
+
+/// A fixed set of worker threads that execute a graph of tasks identified by their indices.
+/// Each worker owns a queue of ready tasks: it pushes and pops at the back (the most recent task first,
+/// whose inputs are likely still in its cache), while idle workers steal from the front of the other queues.
+/// The thread calling Run() takes part as worker 0, so a pool of one thread runs everything inline.
+/// The threads are started once and sleep between runs.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(std::size_t num_threads);
+
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /// Executes `num_tasks` tasks, starting with `roots`.
+    /// `execute(task, worker)` runs one task on the given worker, and calls Spawn(worker, next)
+    /// for each task that becomes ready, every task must be spawned exactly once.
+    /// The first exception thrown by a task is rethrown after all workers stopped.
+    template <typename Execute>
+    void Run(const std::vector<std::size_t>& roots, std::size_t num_tasks, Execute& execute);
+
+    /// Executes `num_tasks` tasks, starting with the tasks 0, ..., num_roots - 1,
+    /// which spares the loops that split their work into independent tasks a vector of roots
+    template <typename Execute>
+    void Run(std::size_t num_roots, std::size_t num_tasks, Execute& execute);
+
+    /// Makes a task ready, must be called from inside a task running on `worker`
+    void Spawn(std::size_t worker, std::size_t task);
+
+    [[nodiscard]] std::size_t num_threads() const { return num_threads_; }
+
+private:
+    // Each task is pushed at most once per run, so the queues never wrap around
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::vector<std::size_t> tasks;
+        std::size_t head = 0;
+        std::size_t tail = 0;
+    };
+
+    void ResetQueues(std::size_t num_tasks);
+    template <typename Execute>
+    void RunQueued(std::size_t num_tasks, Execute& execute);
+
+    bool Pop(std::size_t worker, std::size_t& task);
+    bool Steal(std::size_t worker, std::size_t& task);
+    void WorkLoop(std::size_t worker);
+    void ThreadMain(std::size_t worker);
+
+    std::size_t num_threads_;
+    std::unique_ptr<Queue[]> queues_;
+    std::vector<std::thread> threads_;
+
+    // The current run, the function pointer erases the type of the task body
+    void (*execute_)(void* context, std::size_t task, std::size_t worker) = nullptr;
+    void* context_ = nullptr;
+    std::atomic<std::size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::exception_ptr exception_;
+
+    // Wakes up the threads for a new run, and counts the threads still inside the run
+    std::mutex mutex_;
+    std::condition_variable wake_up_;
+    std::uint64_t run_id_ = 0;
+    bool stop_ = false;
+    std::atomic<std::size_t> active_{0};
+};
+
+
+inline WorkStealingPool::WorkStealingPool(std::size_t num_threads)
+    : num_threads_(num_threads == 0 ? 1 : num_threads),
+      queues_(std::make_unique<Queue[]>(num_threads_)) {
+    threads_.reserve(num_threads_ - 1);
+    for (std::size_t worker = 1; worker < num_threads_; ++worker) {
+        threads_.emplace_back(&WorkStealingPool::ThreadMain, this, worker);
+    }
+}
+
+
+inline WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_up_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+
+template <typename Execute>
+void WorkStealingPool::Run(const std::vector<std::size_t>& roots, std::size_t num_tasks, Execute& execute) {
+    if (num_tasks == 0) {
+        return;
+    }
+
+    ResetQueues(num_tasks);
+    auto& queue = queues_[0];
+    for (auto task : roots) {
+        queue.tasks[queue.tail++] = task;
+    }
+    RunQueued(num_tasks, execute);
+}
+
+
+template <typename Execute>
+void WorkStealingPool::Run(std::size_t num_roots, std::size_t num_tasks, Execute& execute) {
+    if (num_tasks == 0) {
+        return;
+    }
+
+    ResetQueues(num_tasks);
+    auto& queue = queues_[0];
+    for (std::size_t task = 0; task < num_roots; ++task) {
+        queue.tasks[queue.tail++] = task;
+    }
+    RunQueued(num_tasks, execute);
+}
+
+
+inline void WorkStealingPool::ResetQueues(std::size_t num_tasks) {
+    for (std::size_t worker = 0; worker < num_threads_; ++worker) {
+        auto& queue = queues_[worker];
+        queue.tasks.resize(num_tasks); // only allocates when a run has more tasks than all runs before
+        queue.head = queue.tail = 0;
+    }
+}
+
+
+// Runs the tasks in the queue of worker 0 and those they spawn
+template <typename Execute>
+void WorkStealingPool::RunQueued(std::size_t num_tasks, Execute& execute) {
+    execute_ = [](void* context, std::size_t task, std::size_t worker) {
+        (*static_cast<Execute*>(context))(task, worker);
+    };
+    context_ = &execute;
+    remaining_.store(num_tasks, std::memory_order_relaxed);
+    failed_.store(false, std::memory_order_relaxed);
+    exception_ = nullptr;
+
+    {
+        std::lock_guard lock(mutex_);
+        active_.store(num_threads_ - 1, std::memory_order_relaxed);
+        ++run_id_;
+    }
+    wake_up_.notify_all();
+
+    WorkLoop(0);
+
+    // The other workers may still be looking for work, wait until they left this run
+    while (active_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    if (exception_) {
+        std::rethrow_exception(exception_);
+    }
+}
+
+
+inline void WorkStealingPool::Spawn(std::size_t worker, std::size_t task) {
+    auto& queue = queues_[worker];
+    std::lock_guard lock(queue.mutex);
+    queue.tasks[queue.tail++] = task;
+}
+
+
+inline bool WorkStealingPool::Pop(std::size_t worker, std::size_t& task) {
+    auto& queue = queues_[worker];
+    std::lock_guard lock(queue.mutex);
+    if (queue.head == queue.tail) {
+        return false;
+    }
+    task = queue.tasks[--queue.tail];
+    return true;
+}
+
+
+inline bool WorkStealingPool::Steal(std::size_t worker, std::size_t& task) {
+    for (std::size_t offset = 1; offset < num_threads_; ++offset) {
+        auto& queue = queues_[(worker + offset) % num_threads_];
+        std::lock_guard lock(queue.mutex);
+        if (queue.head != queue.tail) {
+            task = queue.tasks[queue.head++];
+            return true;
+        }
+    }
+    return false;
+}
+
+
+inline void WorkStealingPool::WorkLoop(std::size_t worker) {
+    while (remaining_.load(std::memory_order_acquire) != 0 && !failed_.load(std::memory_order_acquire)) {
+        std::size_t task;
+        if (!Pop(worker, task) && !Steal(worker, task)) {
+            // A running task (e.g., waiting for the network) will spawn more work
+            std::this_thread::yield();
+            continue;
+        }
+
+        try {
+            execute_(context_, task, worker);
+        }
+        catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!failed_.load(std::memory_order_relaxed)) {
+                exception_ = std::current_exception();
+                failed_.store(true, std::memory_order_release);
+            }
+        }
+        remaining_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+
+inline void WorkStealingPool::ThreadMain(std::size_t worker) {
+    std::uint64_t last_run = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_up_.wait(lock, [this, last_run] { return stop_ || run_id_ != last_run; });
+            if (stop_) {
+                return;
+            }
+            last_run = run_id_;
+        }
+
+        WorkLoop(worker);
+        active_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_WORKSTEALINGPOOL_H
@@ -0,0 +1,90 @@
+#ifndef BIOAUTH_BIT_SLICING_H
+#define BIOAUTH_BIT_SLICING_H
+
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "utils/parallel_for.h"
+
+
+// Bit-slicing lays out many values of a boolean circuit so that a machine word holds the same bit of 64 of them.
+// The gates of the circuit are then word operations, each of which evaluates the gate on 64 values at once.
+// The values are transposed in blocks of 64, with the 64 x 64 transposition of Hacker's Delight (section 7-3).
+
+namespace bioauth {
+
+/// The words of a bit plane of num_values values
+inline constexpr std::size_t bitSliceWords(std::size_t num_values) { return (num_values + 63) / 64; }
+
+/// Transposes a 64 x 64 matrix of bits in place, bit j of rows[i] is swapped with bit i of rows[j]
+inline void transposeBits64(uint64_t* rows) {
+    // Swaps the upper right and lower left blocks of the 2 x 2 blocks of each size, from 32 x 32 to 1 x 1
+    uint64_t mask = 0x00000000FFFFFFFF;
+    for (std::size_t width = 32; width != 0; width >>= 1, mask ^= mask << width) {
+        for (std::size_t row = 0; row < 64; row = (row + width + 1) & ~width) {
+            auto swap = ((rows[row] >> width) ^ rows[row + width]) & mask;
+            rows[row] ^= swap << width;
+            rows[row + width] ^= swap;
+        }
+    }
+}
+
+/// Bit-slices the lower num_bits bits of the values: bit b of values[i] becomes bit i % 64 of
+/// planes[b * bitSliceWords(num_values) + i / 64]. The bits past the last value are zero.
+template <typename T>
+void bitSlice(const T* values, std::size_t num_values, std::size_t num_bits, uint64_t* planes) {
+    if (num_bits > sizeof(T) * 8) {
+        throw std::invalid_argument("Bit-slicing more bits than the values have");
+    }
+    const auto num_words = bitSliceWords(num_values);
+
+    // The 64-bit limbs of 64 values are transposed one after another
+    parallelFor<std::array<T, 64>>(num_words, [=](std::size_t begin, std::size_t end) {
+        std::array<uint64_t, 64> block;
+        for (auto word = begin; word < end; ++word) {
+            const auto* first = values + word * 64;
+            const auto count = std::min<std::size_t>(64, num_values - word * 64);
+            for (std::size_t limb = 0; limb * 64 < num_bits; ++limb) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    if constexpr (sizeof(T) > 8) {
+                        block[i] = static_cast<uint64_t>(first[i] >> (limb * 64));
+                    }
+                    else {
+                        block[i] = static_cast<uint64_t>(first[i]);
+                    }
+                }
+                std::fill(block.begin() + count, block.end(), 0);
+                transposeBits64(block.data());
+                const auto limb_bits = std::min<std::size_t>(64, num_bits - limb * 64);
+                for (std::size_t bit = 0; bit < limb_bits; ++bit) {
+                    planes[(limb * 64 + bit) * num_words + word] = block[bit];
+                }
+            }
+        }
+    });
+}
+
+
+/// The MACs of bit-sliced boolean shares: the MAC of a bit x is x * Delta for a binary global key Delta of
+/// kBitMacBits bits, which is XOR-shared as the bit. It is the 40 bits of gf2n_short in the vendored MP-SPDZ,
+/// though no product in the field is needed: the MAC of a bit is Delta or zero.
+/// So the MACs of a plane are kBitMacBits planes, plane s holding bit s of the MACs, and the MAC of an XOR,
+/// or of an AND with a public plane, is the same word operation on each of them.
+inline constexpr std::size_t kBitMacBits = 40;
+
+/// The masks of the bits of a share of the binary key, ~0 for the set bits, which select the MAC planes of
+/// x * Delta_i from the plane of x
+inline std::array<uint64_t, kBitMacBits> bitMacKeyMasks(uint64_t key_shr) {
+    std::array<uint64_t, kBitMacBits> masks;
+    for (std::size_t bit = 0; bit < kBitMacBits; ++bit) {
+        masks[bit] = ((key_shr >> bit) & 1) ? ~uint64_t(0) : 0;
+    }
+    return masks;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_BIT_SLICING_H
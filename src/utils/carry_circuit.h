@@ -0,0 +1,101 @@
+#ifndef BIOAUTH_CARRY_CIRCUIT_H
+#define BIOAUTH_CARRY_CIRCUIT_H
+
+#include <bit>
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+
+// The shape of the carry circuit of GtzGate, which FakeGtzGate follows to preprocess its triples.
+// A level of radix 2 combines the pairs of bits, an odd last bit is passed on, by two ANDs per pair:
+// p2 * p1 and p2 * g1, each of which takes a bit triple (a, b, c = a * b).
+// A level of radix r combines the groups of r bits, the last one may be smaller and a single bit is passed on,
+// by multi-input ANDs, which take a multi-input triple per group (see CarryGroupTriple).
+
+namespace bioauth {
+
+/// The bit lengths of the levels of a carry circuit of the radix on num_bits bits, before each level
+inline std::vector<std::size_t> carryLevels(std::size_t num_bits, std::size_t radix) {
+    std::vector<std::size_t> levels;
+    for (auto k = num_bits; k > 1; k = (k + radix - 1) / radix) {
+        levels.push_back(k);
+    }
+    return levels;
+}
+
+/// The planes of the triples of a pair of bits of radix 2: a, b and c of p2 * p1, then of p2 * g1
+inline constexpr std::size_t kCarryPairPlanes = 6;
+
+/// The multi-input triple of a group of t bits of a level of higher radix. Its inputs are p_0, ..., p_{t-1},
+/// then g_0, ..., g_{t-2}, and a set of inputs is given by the bits of an index.
+/// A product of inputs is evaluated from the opened e_i = x_i ^ a_i as the sum over the subsets S of its inputs of
+/// (the product of e_i outside S) * (the product of a_i in S), so the triple holds the masks a_i, followed by
+/// the products of the masks of the subsets of at least two inputs of each product.
+struct CarryGroupTriple {
+    static constexpr uint32_t kNoPlane = std::numeric_limits<uint32_t>::max();
+
+    std::size_t num_inputs = 0;
+    std::vector<uint32_t> products; // P = p_0 ... p_{t-1}, then the terms p_{j+1} ... p_{t-1} g_j of G
+    std::vector<uint32_t> subsets;  // the sets of at least two inputs whose products of masks are preprocessed
+    std::vector<uint32_t> plane_of; // the plane of the mask, or product of masks, of each set of inputs
+
+    [[nodiscard]] std::size_t num_planes() const { return num_inputs + subsets.size(); }
+};
+
+inline CarryGroupTriple carryGroupTriple(std::size_t group_bits) {
+    CarryGroupTriple triple;
+    const auto t = static_cast<uint32_t>(group_bits);
+    const uint32_t all_p = (uint32_t(1) << t) - 1;
+    triple.num_inputs = 2 * t - 1;
+    triple.products.push_back(all_p);
+    for (uint32_t j = 0; j + 1 < t; ++j) {
+        triple.products.push_back((uint32_t(1) << (t + j)) | (all_p & ~((uint32_t(2) << j) - 1)));
+    }
+
+    triple.plane_of.assign(std::size_t(1) << triple.num_inputs, CarryGroupTriple::kNoPlane);
+    for (uint32_t i = 0; i < triple.num_inputs; ++i) {
+        triple.plane_of[uint32_t(1) << i] = i;
+    }
+    for (auto product : triple.products) {
+        for (auto subset = product; subset != 0; subset = (subset - 1) & product) {
+            if (std::popcount(subset) > 1 && triple.plane_of[subset] == CarryGroupTriple::kNoPlane) {
+                triple.plane_of[subset] = static_cast<uint32_t>(triple.num_planes());
+                triple.subsets.push_back(subset);
+            }
+        }
+    }
+    return triple;
+}
+
+/// The bits of the pairs, or groups, of a level on k bits that take triples, the last bit is passed on when it is alone
+inline std::vector<std::size_t> carryUnits(std::size_t k, std::size_t radix) {
+    std::vector<std::size_t> units;
+    for (std::size_t first = 0; first + 1 < k; first += radix) {
+        units.push_back(std::min(radix, k - first));
+    }
+    return units;
+}
+
+/// The planes of the triples of a pair, or of a group of t bits, which has 2t - 1 masks and 2^(t + 1) - 2t - 2
+/// products of masks
+inline std::size_t carryUnitPlanes(std::size_t t, std::size_t radix) {
+    return radix == 2 ? kCarryPairPlanes : (std::size_t(2) << t) - 3;
+}
+
+/// The planes of the triples of all levels of a carry circuit
+inline std::size_t carryCircuitPlanes(std::size_t num_bits, std::size_t radix) {
+    std::size_t planes = 0;
+    for (auto k : carryLevels(num_bits, radix)) {
+        for (auto t : carryUnits(k, radix)) {
+            planes += carryUnitPlanes(t, radix);
+        }
+    }
+    return planes;
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_CARRY_CIRCUIT_H
@@ -0,0 +1,82 @@
+#ifndef BIOAUTH_CRYPTO_H
+#define BIOAUTH_CRYPTO_H
+
+#include <array>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+namespace bioauth {
+
+/// Incremental SHA-256, used for commitments and to derive public randomness from a transcript
+class Sha256 {
+public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    Sha256() : context_(EVP_MD_CTX_new(), EVP_MD_CTX_free) {
+        if (!context_ || EVP_DigestInit_ex(context_.get(), EVP_sha256(), nullptr) != 1) {
+            throw std::runtime_error("Failed to initialize SHA-256");
+        }
+    }
+
+    void Update(const void* data, std::size_t size) {
+        if (size != 0 && EVP_DigestUpdate(context_.get(), data, size) != 1) {
+            throw std::runtime_error("Failed to update SHA-256");
+        }
+    }
+
+    /// Returns the digest of everything written since the last call, and starts over
+    Digest Final() {
+        Digest digest;
+        if (EVP_DigestFinal_ex(context_.get(), digest.data(), nullptr) != 1
+            || EVP_DigestInit_ex(context_.get(), EVP_sha256(), nullptr) != 1) {
+            throw std::runtime_error("Failed to finalize SHA-256");
+        }
+        return digest;
+    }
+
+private:
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context_;
+};
+
+
+/// A pseudorandom generator, AES-128 in counter mode keyed by a 32-byte seed (key and IV)
+class AesCtrPrg {
+public:
+    explicit AesCtrPrg(const Sha256::Digest& seed) : context_(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {
+        if (!context_
+            || EVP_EncryptInit_ex(context_.get(), EVP_aes_128_ctr(), nullptr, seed.data(), seed.data() + 16) != 1) {
+            throw std::runtime_error("Failed to initialize AES-CTR");
+        }
+    }
+
+    /// Overwrites the buffer with the next bytes of the stream
+    void Fill(void* data, std::size_t size) {
+        auto bytes = static_cast<std::uint8_t*>(data);
+        std::fill(bytes, bytes + size, std::uint8_t(0));
+        int written = 0;
+        if (EVP_EncryptUpdate(context_.get(), bytes, &written, bytes, static_cast<int>(size)) != 1) {
+            throw std::runtime_error("Failed to generate the AES-CTR stream");
+        }
+    }
+
+private:
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> context_;
+};
+
+
+/// Fills the buffer with cryptographically secure random bytes
+inline void RandomBytes(void* data, std::size_t size) {
+    if (RAND_bytes(static_cast<unsigned char*>(data), static_cast<int>(size)) != 1) {
+        throw std::runtime_error("Failed to generate random bytes");
+    }
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_CRYPTO_H
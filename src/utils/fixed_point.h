@@ -7,7 +7,8 @@
 #include <type_traits>
 #include <vector>
 #include <algorithm>
-#include <execution>
+
+#include "utils/parallel_for.h"
 
 
 namespace bioauth {
@@ -50,22 +51,19 @@ Tp truncateClear(Tp x) {
 template <typename Tp>
 [[nodiscard]]
 std::vector<Tp> truncateClearVec(const std::vector<Tp>& x) {
-    std::vector<Tp> ret(x.size());
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), ret.begin(), truncateClear<Tp>);
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), ret.begin(), truncateClear<Tp>);
-#endif
+    std::vector<Tp> ret(x);
+    truncateClearVecInplace(ret);
     return ret;
 }
 
 template <typename Tp>
 void truncateClearVecInplace(std::vector<Tp>& x) {
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), x.begin(), truncateClear<Tp>);
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), x.begin(), truncateClear<Tp>);
-#endif
+    parallelFor<Tp>(x.size(), [data = x.data()](std::size_t begin, std::size_t end) {
+        BIOAUTH_SIMD_LOOP
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            data[idx] = truncateClear(data[idx]);
+        }
+    });
 }
 
 
@@ -0,0 +1,860 @@
+#ifndef BIOAUTH_GEMM_H
+#define BIOAUTH_GEMM_H
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/parallel_for.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BIOAUTH_GEMM_X86
+#include <immintrin.h>
+#endif
+
+
+// A general matrix multiplication over the rings Z_2^32, Z_2^64 and Z_2^128, i.e., with wrap-around arithmetic,
+// for the products of the online phase. BLAS only covers floating point, and Eigen's generic product
+// multiplies the integers one at a time.
+//
+// The product is blocked for the caches as in GotoBLAS: a block of the rhs is packed into panels of a few columns
+// that are read contiguously, and a block of the lhs into panels of a few rows. A micro-kernel multiplies
+// a panel of the lhs with a panel of the rhs into a small tile of the output, held in vector registers.
+// The 128-bit elements are packed as their low and high 64-bit limbs, the products of the limbs are
+// put together from 32-bit multiplications, which the vector units provide.
+//
+// The micro-kernels are generated for AVX-512, AVX2 and plain C++ from gemm_kernel.inc, and one of them is picked
+// at runtime from the features of the CPU, so the library runs on any x86-64 CPU without compiler flags.
+// The product is split over the threads of parallel_for.h, set with setParallelThreads().
+
+namespace bioauth {
+
+enum class GemmIsa { kScalar, kAvx2, kAvx512 };
+
+/// How a product is written to the output
+enum class GemmUpdate { kAssign, kAdd, kSubtract };
+
+template <typename T>
+concept GemmElement = std::same_as<T, std::uint32_t> || std::same_as<T, std::uint64_t>
+                      || std::same_as<T, __uint128_t>;
+
+/// The public values of a Beaver multiplication whose shares are T, i.e., the clear values of Z_2^K
+/// for shares of Z_2^(K+S) with K = S, e.g., 64-bit values for the 128-bit shares of Spdz2kShare64
+template <typename T>
+using BeaverPublicOf = std::conditional_t<sizeof(T) == 16, std::uint64_t,
+                                          std::conditional_t<sizeof(T) == 8, std::uint32_t, T>>;
+
+/// The operands of the matrix-vector products of a Beaver multiplication with a single row:
+/// x * y, a * y, a_mac * y, x * b and x * b_mac, where the public matrix y = y_0 + y_1 is given by its two summands,
+/// which are read at their own width and summed at the width of the shares
+template <typename T>
+struct BeaverGemvOperands {
+    const T* x;       // the rows, of dim_mid elements
+    const T* a;
+    const T* a_mac;
+    const BeaverPublicOf<T>* y_0; // the dim_mid x dim_col matrices, whose rows are dim_col elements apart
+    const BeaverPublicOf<T>* y_1;
+    const T* b;       // whose rows are b_stride elements apart
+    const T* b_mac;
+    std::size_t b_stride;
+    T* x_y;           // the products, of dim_col elements
+    T* a_y;
+    T* a_mac_y;
+    T* x_b;
+    T* x_b_mac;
+};
+
+namespace gemm_detail {
+
+// The 128-bit elements are packed as two 64-bit limbs, the other elements as themselves
+template <typename T>
+using LimbOf = std::conditional_t<sizeof(T) == 16, std::uint64_t, T>;
+
+template <typename T>
+inline constexpr std::size_t kLimbsOf = sizeof(T) / sizeof(LimbOf<T>);
+
+// The columns of a block of the matrix-vector products: the rows of the matrices are read in runs
+// long enough for the hardware prefetchers, while the sums of the block stay in the L1 and L2 caches
+inline constexpr std::size_t kBeaverBlockCols = 512;
+
+
+template <typename T>
+struct KernelSet {
+    using Function = void (*)(std::size_t depth, const T* lhs, std::size_t lhs_step, const LimbOf<T>* rhs,
+                              T* output, std::size_t output_stride, GemmUpdate update,
+                              std::size_t num_rows, std::size_t num_cols);
+
+    using BeaverFunction = void (*)(const BeaverGemvOperands<T>& operands, std::size_t dim_mid, std::size_t dim_col,
+                                    std::size_t begin, std::size_t num_cols);
+
+    std::size_t rows; // of the tile of the output
+    std::size_t cols;
+    Function full;    // multiplies a full panel of the lhs
+    Function single;  // multiplies one row of a panel, for the rows left over
+    std::size_t lanes;
+    BeaverFunction beaver;
+};
+
+
+template <typename T>
+inline void storeTile(const T* tile, std::size_t tile_stride, T* output, std::size_t output_stride,
+                      GemmUpdate update, std::size_t num_rows, std::size_t num_cols) {
+    for (std::size_t row = 0; row < num_rows; ++row) {
+        const T* from = tile + row * tile_stride;
+        T* to = output + row * output_stride;
+        switch (update) {
+            case GemmUpdate::kAssign:
+                std::copy_n(from, num_cols, to);
+                break;
+            case GemmUpdate::kAdd:
+                for (std::size_t col = 0; col < num_cols; ++col) to[col] += from[col];
+                break;
+            case GemmUpdate::kSubtract:
+                for (std::size_t col = 0; col < num_cols; ++col) to[col] -= from[col];
+                break;
+        }
+    }
+}
+
+
+namespace scalar {
+
+template <typename T>
+struct KernelOps {
+    static constexpr std::size_t kLanes = 1;
+    using Acc = T;
+    using Lhs = T;
+    using Rhs = T;
+
+    static Acc zero() { return 0; }
+    static Lhs broadcast(T element) { return element; }
+    static Rhs load(const LimbOf<T>* row, std::size_t vec, std::size_t num_cols) {
+        if constexpr (kLimbsOf<T> == 2) {
+            return static_cast<T>(row[vec]) | static_cast<T>(row[num_cols + vec]) << 64;
+        }
+        else {
+            return row[vec];
+        }
+    }
+    static Rhs loadElements(const T* elements) { return *elements; }
+    static Rhs loadPublic(const BeaverPublicOf<T>* elements) { return *elements; }
+    static Rhs add(Rhs x, Rhs y) { return x + y; }
+    static void multiplyAdd(Acc& acc, Lhs lhs, Rhs rhs) { acc += lhs * rhs; }
+    static void store(T* output, Acc acc) { *output = acc; }
+};
+
+template <typename T>
+struct TileShape {
+    static constexpr std::size_t kRows = 4;
+    static constexpr std::size_t kVecs = 4;
+};
+
+#include "utils/gemm_kernel.inc"
+
+} // namespace scalar
+
+} // namespace gemm_detail
+} // namespace bioauth
+
+
+#ifdef BIOAUTH_GEMM_X86
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace bioauth::gemm_detail::avx2 {
+
+template <typename T>
+struct KernelOps;
+
+template <>
+struct KernelOps<std::uint32_t> {
+    static constexpr std::size_t kLanes = 8;
+    using Acc = __m256i;
+    using Lhs = __m256i;
+    using Rhs = __m256i;
+
+    static Acc zero() { return _mm256_setzero_si256(); }
+    static Lhs broadcast(std::uint32_t element) { return _mm256_set1_epi32(static_cast<int>(element)); }
+    static Rhs load(const std::uint32_t* row, std::size_t vec, std::size_t) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + vec * kLanes));
+    }
+    static Rhs loadElements(const std::uint32_t* elements) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements));
+    }
+    static Rhs loadPublic(const std::uint32_t* elements) { return loadElements(elements); }
+    static Rhs add(Rhs x, Rhs y) { return _mm256_add_epi32(x, y); }
+    static void multiplyAdd(Acc& acc, Lhs lhs, Rhs rhs) {
+        acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(lhs, rhs));
+    }
+    static void store(std::uint32_t* output, Acc acc) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), acc);
+    }
+};
+
+// AVX2 has no 64-bit multiplication, it is put together from the 32-bit halves:
+// x * y = x_0 * y_0 + (x_0 * y_1 + x_1 * y_0) << 32 mod 2^64, with the high halves shifted down once per operand
+struct Halves {
+    __m256i low;
+    __m256i high; // the high 32 bits of each element, in the low half
+};
+
+inline Halves splitHalves(__m256i value) {
+    return {value, _mm256_srli_epi64(value, 32)};
+}
+
+inline __m256i multiplyLow(const Halves& x, const Halves& y) {
+    auto cross = _mm256_add_epi64(_mm256_mul_epu32(x.low, y.high), _mm256_mul_epu32(x.high, y.low));
+    return _mm256_add_epi64(_mm256_mul_epu32(x.low, y.low), _mm256_slli_epi64(cross, 32));
+}
+
+template <>
+struct KernelOps<std::uint64_t> {
+    static constexpr std::size_t kLanes = 4;
+    using Acc = __m256i;
+    using Lhs = Halves;
+    using Rhs = Halves;
+
+    static Acc zero() { return _mm256_setzero_si256(); }
+    static Lhs broadcast(std::uint64_t element) {
+        return splitHalves(_mm256_set1_epi64x(static_cast<long long>(element)));
+    }
+    static Rhs load(const std::uint64_t* row, std::size_t vec, std::size_t) {
+        return splitHalves(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + vec * kLanes)));
+    }
+    static Rhs loadElements(const std::uint64_t* elements) {
+        return splitHalves(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements)));
+    }
+    // Zero-extends 32-bit elements
+    static Rhs loadPublic(const std::uint32_t* elements) {
+        return {_mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(elements))),
+                _mm256_setzero_si256()};
+    }
+    static Rhs add(const Rhs& x, const Rhs& y) { return splitHalves(_mm256_add_epi64(x.low, y.low)); }
+    static void multiplyAdd(Acc& acc, const Lhs& lhs, const Rhs& rhs) {
+        acc = _mm256_add_epi64(acc, multiplyLow(lhs, rhs));
+    }
+    static void store(std::uint64_t* output, Acc acc) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), acc);
+    }
+};
+
+// A 128-bit element as its limbs, the low limb is split into 32-bit halves for the full 64 x 64 product
+struct Limbs {
+    Halves low;
+    __m256i high;
+};
+
+struct Wide {
+    __m256i low;
+    __m256i high;
+};
+
+template <>
+struct KernelOps<__uint128_t> {
+    static constexpr std::size_t kLanes = 4;
+    using Acc = Wide;
+    using Lhs = Limbs;
+    using Rhs = Limbs;
+
+    static Acc zero() { return {_mm256_setzero_si256(), _mm256_setzero_si256()}; }
+    static Lhs broadcast(__uint128_t element) {
+        return {splitHalves(_mm256_set1_epi64x(static_cast<long long>(element))),
+                _mm256_set1_epi64x(static_cast<long long>(element >> 64))};
+    }
+    static Rhs load(const std::uint64_t* row, std::size_t vec, std::size_t num_cols) {
+        return {splitHalves(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + vec * kLanes))),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + num_cols + vec * kLanes))};
+    }
+    // Loads unpacked elements, whose limbs alternate in memory
+    static Rhs loadElements(const __uint128_t* elements) {
+        auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements));
+        auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements + 2));
+        // The unpacked limbs are in the order of the elements 0, 2, 1, 3
+        auto low = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(first, second), 0xd8);
+        auto high = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(first, second), 0xd8);
+        return {splitHalves(low), high};
+    }
+    // Zero-extends 64-bit elements, which are the low limbs as they are
+    static Rhs loadPublic(const std::uint64_t* elements) {
+        return {splitHalves(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements))), _mm256_setzero_si256()};
+    }
+    static Rhs add(const Rhs& x, const Rhs& y) {
+        auto sign = _mm256_set1_epi64x(static_cast<long long>(1ull << 63));
+        auto low = _mm256_add_epi64(x.low.low, y.low.low);
+        auto carry = _mm256_cmpgt_epi64(_mm256_xor_si256(x.low.low, sign), _mm256_xor_si256(low, sign));
+        return {splitHalves(low), _mm256_sub_epi64(_mm256_add_epi64(x.high, y.high), carry)};
+    }
+    static void multiplyAdd(Acc& acc, const Lhs& lhs, const Rhs& rhs) {
+        // The full product of the low limbs from the four products of their halves
+        auto mask = _mm256_set1_epi64x(0xffffffff);
+        auto low_low = _mm256_mul_epu32(lhs.low.low, rhs.low.low);
+        auto low_high = _mm256_mul_epu32(lhs.low.low, rhs.low.high);
+        auto high_low = _mm256_mul_epu32(lhs.low.high, rhs.low.low);
+        auto high_high = _mm256_mul_epu32(lhs.low.high, rhs.low.high);
+        auto middle = _mm256_add_epi64(_mm256_add_epi64(_mm256_srli_epi64(low_low, 32),
+                                                        _mm256_and_si256(low_high, mask)),
+                                       _mm256_and_si256(high_low, mask));
+        auto product_low = _mm256_or_si256(_mm256_and_si256(low_low, mask), _mm256_slli_epi64(middle, 32));
+        auto product_high = _mm256_add_epi64(
+            _mm256_add_epi64(high_high, _mm256_srli_epi64(middle, 32)),
+            _mm256_add_epi64(_mm256_srli_epi64(low_high, 32), _mm256_srli_epi64(high_low, 32)));
+
+        // The cross products of the low and high limbs only reach the high limb
+        auto cross = _mm256_add_epi64(multiplyLow(lhs.low, splitHalves(rhs.high)),
+                                      multiplyLow(splitHalves(lhs.high), rhs.low));
+        product_high = _mm256_add_epi64(product_high, cross);
+
+        // There is no unsigned comparison, the carry is a signed comparison with the sign bits flipped
+        auto sign = _mm256_set1_epi64x(static_cast<long long>(1ull << 63));
+        auto sum_low = _mm256_add_epi64(acc.low, product_low);
+        auto carry = _mm256_cmpgt_epi64(_mm256_xor_si256(product_low, sign), _mm256_xor_si256(sum_low, sign));
+        acc.low = sum_low;
+        acc.high = _mm256_sub_epi64(_mm256_add_epi64(acc.high, product_high), carry);
+    }
+    static void store(__uint128_t* output, const Acc& acc) {
+        alignas(32) std::uint64_t low[kLanes];
+        alignas(32) std::uint64_t high[kLanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(low), acc.low);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(high), acc.high);
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            output[lane] = static_cast<__uint128_t>(high[lane]) << 64 | low[lane];
+        }
+    }
+};
+
+// The tiles fill the 16 vector registers with the accumulators and the operands of one step
+template <typename T>
+struct TileShape {
+    static constexpr std::size_t kRows = sizeof(T) == 4 ? 6 : sizeof(T) == 8 ? 4 : 2;
+    static constexpr std::size_t kVecs = 2;
+};
+
+#include "utils/gemm_kernel.inc"
+
+} // namespace bioauth::gemm_detail::avx2
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx512f,avx512dq"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq")
+#endif
+
+namespace bioauth::gemm_detail::avx512 {
+
+// GCC builds the unmasked forms of these intrinsics from masked builtins that merge into _mm512_undefined_epi32(),
+// which -Wmaybe-uninitialized reports wherever they are inlined. The zero-masking forms with a full mask are
+// the same instructions without the undefined operand.
+inline __m512i mulEpu32(__m512i x, __m512i y) { return _mm512_maskz_mul_epu32(0xFF, x, y); }
+template <unsigned kShift>
+__m512i srli64(__m512i x) { return _mm512_maskz_srli_epi64(0xFF, x, kShift); }
+template <unsigned kShift>
+__m512i slli64(__m512i x) { return _mm512_maskz_slli_epi64(0xFF, x, kShift); }
+inline __m512i cvtepu32Epi64(__m256i x) { return _mm512_maskz_cvtepu32_epi64(0xFF, x); }
+
+template <typename T>
+struct KernelOps;
+
+template <>
+struct KernelOps<std::uint32_t> {
+    static constexpr std::size_t kLanes = 16;
+    using Acc = __m512i;
+    using Lhs = __m512i;
+    using Rhs = __m512i;
+
+    static Acc zero() { return _mm512_setzero_si512(); }
+    static Lhs broadcast(std::uint32_t element) { return _mm512_set1_epi32(static_cast<int>(element)); }
+    static Rhs load(const std::uint32_t* row, std::size_t vec, std::size_t) {
+        return _mm512_loadu_si512(row + vec * kLanes);
+    }
+    static Rhs loadElements(const std::uint32_t* elements) { return _mm512_loadu_si512(elements); }
+    static Rhs loadPublic(const std::uint32_t* elements) { return loadElements(elements); }
+    static Rhs add(Rhs x, Rhs y) { return _mm512_add_epi32(x, y); }
+    static void multiplyAdd(Acc& acc, Lhs lhs, Rhs rhs) {
+        acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(lhs, rhs));
+    }
+    static void store(std::uint32_t* output, Acc acc) { _mm512_storeu_si512(output, acc); }
+};
+
+template <>
+struct KernelOps<std::uint64_t> {
+    static constexpr std::size_t kLanes = 8;
+    using Acc = __m512i;
+    using Lhs = __m512i;
+    using Rhs = __m512i;
+
+    static Acc zero() { return _mm512_setzero_si512(); }
+    static Lhs broadcast(std::uint64_t element) { return _mm512_set1_epi64(static_cast<long long>(element)); }
+    static Rhs load(const std::uint64_t* row, std::size_t vec, std::size_t) {
+        return _mm512_loadu_si512(row + vec * kLanes);
+    }
+    static Rhs loadElements(const std::uint64_t* elements) { return _mm512_loadu_si512(elements); }
+    // Zero-extends 32-bit elements
+    static Rhs loadPublic(const std::uint32_t* elements) {
+        return cvtepu32Epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements)));
+    }
+    static Rhs add(Rhs x, Rhs y) { return _mm512_add_epi64(x, y); }
+    static void multiplyAdd(Acc& acc, Lhs lhs, Rhs rhs) {
+        acc = _mm512_add_epi64(acc, _mm512_mullo_epi64(lhs, rhs));
+    }
+    static void store(std::uint64_t* output, Acc acc) { _mm512_storeu_si512(output, acc); }
+};
+
+// A 128-bit element as its limbs, with the high half of the low limb shifted down for the 32-bit multiplications
+struct Limbs {
+    __m512i low;
+    __m512i low_high;
+    __m512i high;
+};
+
+struct Wide {
+    __m512i low;
+    __m512i high;
+};
+
+template <>
+struct KernelOps<__uint128_t> {
+    static constexpr std::size_t kLanes = 8;
+    using Acc = Wide;
+    using Lhs = Limbs;
+    using Rhs = Limbs;
+
+    static Acc zero() { return {_mm512_setzero_si512(), _mm512_setzero_si512()}; }
+    static Lhs broadcast(__uint128_t element) {
+        auto low = _mm512_set1_epi64(static_cast<long long>(element));
+        return {low, srli64<32>(low), _mm512_set1_epi64(static_cast<long long>(element >> 64))};
+    }
+    static Rhs load(const std::uint64_t* row, std::size_t vec, std::size_t num_cols) {
+        auto low = _mm512_loadu_si512(row + vec * kLanes);
+        return {low, srli64<32>(low), _mm512_loadu_si512(row + num_cols + vec * kLanes)};
+    }
+    // Loads unpacked elements, whose limbs alternate in memory
+    static Rhs loadElements(const __uint128_t* elements) {
+        auto first = _mm512_loadu_si512(elements);
+        auto second = _mm512_loadu_si512(elements + 4);
+        auto low = _mm512_permutex2var_epi64(first, _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14), second);
+        auto high = _mm512_permutex2var_epi64(first, _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15), second);
+        return {low, srli64<32>(low), high};
+    }
+    // Zero-extends 64-bit elements, which are the low limbs as they are
+    static Rhs loadPublic(const std::uint64_t* elements) {
+        auto low = _mm512_loadu_si512(elements);
+        return {low, srli64<32>(low), _mm512_setzero_si512()};
+    }
+    static Rhs add(const Rhs& x, const Rhs& y) {
+        auto low = _mm512_add_epi64(x.low, y.low);
+        auto high = _mm512_add_epi64(x.high, y.high);
+        high = _mm512_mask_add_epi64(high, _mm512_cmplt_epu64_mask(low, x.low), high, _mm512_set1_epi64(1));
+        return {low, srli64<32>(low), high};
+    }
+    static void multiplyAdd(Acc& acc, const Lhs& lhs, const Rhs& rhs) {
+        // The full product of the low limbs from the four products of their halves
+        auto mask = _mm512_set1_epi64(0xffffffff);
+        auto low_low = mulEpu32(lhs.low, rhs.low);
+        auto low_high = mulEpu32(lhs.low, rhs.low_high);
+        auto high_low = mulEpu32(lhs.low_high, rhs.low);
+        auto high_high = mulEpu32(lhs.low_high, rhs.low_high);
+        auto middle = _mm512_add_epi64(_mm512_add_epi64(srli64<32>(low_low),
+                                                        _mm512_and_si512(low_high, mask)),
+                                       _mm512_and_si512(high_low, mask));
+        auto product_low = _mm512_or_si512(_mm512_and_si512(low_low, mask), slli64<32>(middle));
+        auto product_high = _mm512_add_epi64(
+            _mm512_add_epi64(high_high, srli64<32>(middle)),
+            _mm512_add_epi64(srli64<32>(low_high), srli64<32>(high_low)));
+
+        // The cross products of the low and high limbs only reach the high limb
+        product_high = _mm512_add_epi64(product_high, _mm512_add_epi64(_mm512_mullo_epi64(lhs.low, rhs.high),
+                                                                       _mm512_mullo_epi64(lhs.high, rhs.low)));
+
+        auto sum_low = _mm512_add_epi64(acc.low, product_low);
+        auto carry = _mm512_cmplt_epu64_mask(sum_low, product_low);
+        auto sum_high = _mm512_add_epi64(acc.high, product_high);
+        acc.low = sum_low;
+        acc.high = _mm512_mask_add_epi64(sum_high, carry, sum_high, _mm512_set1_epi64(1));
+    }
+    static void store(__uint128_t* output, const Acc& acc) {
+        alignas(64) std::uint64_t low[kLanes];
+        alignas(64) std::uint64_t high[kLanes];
+        _mm512_store_si512(low, acc.low);
+        _mm512_store_si512(high, acc.high);
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            output[lane] = static_cast<__uint128_t>(high[lane]) << 64 | low[lane];
+        }
+    }
+};
+
+// The tiles fill the 32 vector registers with the accumulators and the operands of one step
+template <typename T>
+struct TileShape {
+    static constexpr std::size_t kRows = sizeof(T) == 16 ? 4 : 6;
+    static constexpr std::size_t kVecs = sizeof(T) == 16 ? 2 : 4;
+};
+
+#include "utils/gemm_kernel.inc"
+
+} // namespace bioauth::gemm_detail::avx512
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // BIOAUTH_GEMM_X86
+
+
+namespace bioauth {
+
+namespace gemm_detail {
+
+struct Settings {
+    std::atomic<GemmIsa> isa;
+};
+
+inline GemmIsa detectIsa() {
+#ifdef BIOAUTH_GEMM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+        return GemmIsa::kAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return GemmIsa::kAvx2;
+    }
+#endif
+    return GemmIsa::kScalar;
+}
+
+inline Settings& settings() {
+    static Settings settings_{.isa = detectIsa()};
+    return settings_;
+}
+
+template <typename T>
+KernelSet<T> kernelsFor(GemmIsa isa) {
+#ifdef BIOAUTH_GEMM_X86
+    switch (isa) {
+        case GemmIsa::kAvx512:
+            return avx512::kernelSet<T>();
+        case GemmIsa::kAvx2:
+            return avx2::kernelSet<T>();
+        case GemmIsa::kScalar:
+            break;
+    }
+#else
+    (void) isa;
+#endif
+    return scalar::kernelSet<T>();
+}
+
+
+// The packed blocks of one thread, which keep their storage between products
+template <typename T>
+struct PackedBlocks {
+    std::vector<T> lhs;
+    std::vector<LimbOf<T>> rhs;
+};
+
+template <typename T>
+PackedBlocks<T>& packedBlocks() {
+    thread_local PackedBlocks<T> blocks;
+    return blocks;
+}
+
+
+// Packs a num_rows x depth block of the lhs into panels of `panel_rows` rows, stored column by column,
+// the rows past the end of the block are zero
+template <typename T>
+void packLhs(const T* lhs, std::size_t lhs_stride, std::size_t num_rows, std::size_t depth,
+             std::size_t panel_rows, std::vector<T>& packed) {
+    auto num_panels = (num_rows + panel_rows - 1) / panel_rows;
+    packed.resize(num_panels * panel_rows * depth);
+    for (std::size_t panel = 0; panel < num_panels; ++panel) {
+        T* to = packed.data() + panel * panel_rows * depth;
+        for (std::size_t row = 0; row < panel_rows; ++row) {
+            auto lhs_row = panel * panel_rows + row;
+            if (lhs_row >= num_rows) {
+                for (std::size_t step = 0; step < depth; ++step) to[step * panel_rows + row] = 0;
+                continue;
+            }
+            const T* from = lhs + lhs_row * lhs_stride;
+            for (std::size_t step = 0; step < depth; ++step) to[step * panel_rows + row] = from[step];
+        }
+    }
+}
+
+
+// Packs a depth x num_cols block of the rhs into panels of `panel_cols` columns, stored row by row,
+// the columns past the end of the block are zero. A row of a panel of 128-bit elements holds their low limbs,
+// then their high limbs.
+template <typename T>
+void packRhs(const T* rhs, std::size_t rhs_stride, std::size_t depth, std::size_t num_cols,
+             std::size_t panel_cols, std::vector<LimbOf<T>>& packed) {
+    auto num_panels = (num_cols + panel_cols - 1) / panel_cols;
+    auto row_limbs = panel_cols * kLimbsOf<T>;
+    packed.resize(num_panels * depth * row_limbs);
+    for (std::size_t panel = 0; panel < num_panels; ++panel) {
+        auto col_begin = panel * panel_cols;
+        auto cols = std::min(panel_cols, num_cols - col_begin);
+        LimbOf<T>* to = packed.data() + panel * depth * row_limbs;
+        for (std::size_t step = 0; step < depth; ++step, to += row_limbs) {
+            const T* from = rhs + step * rhs_stride + col_begin;
+            if constexpr (kLimbsOf<T> == 2) {
+                for (std::size_t col = 0; col < cols; ++col) {
+                    to[col] = static_cast<std::uint64_t>(from[col]);
+                    to[panel_cols + col] = static_cast<std::uint64_t>(from[col] >> 64);
+                }
+                std::fill(to + cols, to + panel_cols, 0);
+                std::fill(to + panel_cols + cols, to + row_limbs, 0);
+            }
+            else {
+                std::copy_n(from, cols, to);
+                std::fill(to + cols, to + panel_cols, 0);
+            }
+        }
+    }
+}
+
+
+// The block sizes for the caches: a packed panel of the rhs of depth_block rows fits into L1,
+// a packed block of the lhs into L2, and a packed block of the rhs into L3
+struct BlockSizes {
+    std::size_t depth;
+    std::size_t rows;
+    std::size_t cols;
+};
+
+template <typename T>
+BlockSizes blockSizes(const KernelSet<T>& kernels) {
+    constexpr std::size_t kL1Bytes = 16 * 1024;
+    constexpr std::size_t kL2Bytes = 128 * 1024;
+    constexpr std::size_t kL3Bytes = 2 * 1024 * 1024;
+    auto depth = std::clamp<std::size_t>(kL1Bytes / (kernels.cols * sizeof(T)), 64, 512);
+    auto rows = std::max<std::size_t>(kL2Bytes / (depth * sizeof(T)) / kernels.rows, 1) * kernels.rows;
+    auto cols = std::max<std::size_t>(kL3Bytes / (depth * sizeof(T)) / kernels.cols, 1) * kernels.cols;
+    return {depth, rows, cols};
+}
+
+
+// The sizes for which the packing buffers of all threads of the pool are reserved
+struct PackingReserve {
+    std::atomic<std::size_t> generation{0};
+    std::atomic<std::size_t> lhs{0};
+    std::atomic<std::size_t> rhs{0};
+};
+
+template <typename T>
+PackingReserve& packingReserve() {
+    static PackingReserve reserve;
+    return reserve;
+}
+
+// Reserves the packing buffers of every thread of the pool for the blocks of a product, before it is split.
+// Any thread may steal a band, so otherwise a thread would grow its buffers whenever it first runs a band
+// of a larger product, in any session. The buffers only grow to the blocks of the products that are split.
+template <typename T>
+void reservePackedBlocks(const KernelSet<T>& kernels, std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    auto blocks = blockSizes(kernels);
+    auto depth = std::min(blocks.depth, dim_mid);
+    auto lhs = std::min(blocks.rows, (dim_row + kernels.rows - 1) / kernels.rows * kernels.rows) * depth;
+    auto rhs = depth * std::min(blocks.cols, (dim_col + kernels.cols - 1) / kernels.cols * kernels.cols)
+               * kLimbsOf<T>;
+
+    auto& reserved = packingReserve<T>();
+    auto generation = parallelGeneration();
+    if (reserved.generation.load(std::memory_order_relaxed) == generation) {
+        if (lhs <= reserved.lhs.load(std::memory_order_relaxed)
+            && rhs <= reserved.rhs.load(std::memory_order_relaxed)) {
+            return;
+        }
+        lhs = std::max(lhs, reserved.lhs.load(std::memory_order_relaxed));
+        rhs = std::max(rhs, reserved.rhs.load(std::memory_order_relaxed));
+    }
+    auto reserve = [lhs, rhs] {
+        auto& packed = packedBlocks<T>();
+        packed.lhs.reserve(lhs);
+        packed.rhs.reserve(rhs);
+    };
+    if (parallelForEachThread(reserve) == generation) {
+        reserved.lhs.store(lhs, std::memory_order_relaxed);
+        reserved.rhs.store(rhs, std::memory_order_relaxed);
+        reserved.generation.store(generation, std::memory_order_relaxed);
+    }
+}
+
+
+template <typename T>
+void gemmSerial(const KernelSet<T>& kernels, const T* lhs, std::size_t lhs_stride, const T* rhs,
+                std::size_t rhs_stride, T* output, std::size_t output_stride,
+                std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, GemmUpdate update) {
+    auto blocks = blockSizes(kernels);
+    auto& packed = packedBlocks<T>();
+
+    for (std::size_t col_block = 0; col_block < dim_col; col_block += blocks.cols) {
+        auto num_cols = std::min(blocks.cols, dim_col - col_block);
+        for (std::size_t depth_block = 0; depth_block < dim_mid; depth_block += blocks.depth) {
+            auto depth = std::min(blocks.depth, dim_mid - depth_block);
+            // The first block of the depth writes the output as asked, the others accumulate into it
+            auto block_update = depth_block == 0 ? update
+                                : update == GemmUpdate::kSubtract ? GemmUpdate::kSubtract : GemmUpdate::kAdd;
+            packRhs(rhs + depth_block * rhs_stride + col_block, rhs_stride, depth, num_cols, kernels.cols,
+                    packed.rhs);
+
+            for (std::size_t row_block = 0; row_block < dim_row; row_block += blocks.rows) {
+                auto num_rows = std::min(blocks.rows, dim_row - row_block);
+                packLhs(lhs + row_block * lhs_stride + depth_block, lhs_stride, num_rows, depth, kernels.rows,
+                        packed.lhs);
+
+                for (std::size_t col = 0; col < num_cols; col += kernels.cols) {
+                    auto tile_cols = std::min(kernels.cols, num_cols - col);
+                    const auto* rhs_panel = packed.rhs.data() + col / kernels.cols * depth * kernels.cols
+                                                                * kLimbsOf<T>;
+                    for (std::size_t row = 0; row < num_rows; row += kernels.rows) {
+                        auto tile_rows = std::min(kernels.rows, num_rows - row);
+                        const T* lhs_panel = packed.lhs.data() + row * depth;
+                        T* tile = output + (row_block + row) * output_stride + col_block + col;
+                        if (tile_rows == kernels.rows) {
+                            kernels.full(depth, lhs_panel, kernels.rows, rhs_panel, tile, output_stride,
+                                         block_update, tile_rows, tile_cols);
+                            continue;
+                        }
+                        for (std::size_t tile_row = 0; tile_row < tile_rows; ++tile_row) {
+                            kernels.single(depth, lhs_panel + tile_row, kernels.rows, rhs_panel,
+                                           tile + tile_row * output_stride, output_stride,
+                                           block_update, 1, tile_cols);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace gemm_detail
+
+
+/// The best instruction set of this CPU for the GEMM kernels
+inline GemmIsa supportedGemmIsa() {
+    static const GemmIsa supported = gemm_detail::detectIsa();
+    return supported;
+}
+
+/// The instruction set of the GEMM kernels in use, the best one of this CPU unless set otherwise
+inline GemmIsa gemmIsa() {
+    return gemm_detail::settings().isa.load(std::memory_order_relaxed);
+}
+
+/// Forces the GEMM kernels of an instruction set, e.g., to compare them
+inline void setGemmIsa(GemmIsa isa) {
+    if (isa > supportedGemmIsa()) {
+        throw std::invalid_argument("The instruction set of the GEMM kernels is not supported by this CPU");
+    }
+    gemm_detail::settings().isa.store(isa, std::memory_order_relaxed);
+}
+
+inline const char* gemmIsaName(GemmIsa isa) {
+    switch (isa) {
+        case GemmIsa::kAvx512:
+            return "AVX-512";
+        case GemmIsa::kAvx2:
+            return "AVX2";
+        case GemmIsa::kScalar:
+            break;
+    }
+    return "scalar";
+}
+
+/// output = lhs * rhs, output += lhs * rhs or output -= lhs * rhs, depending on `update`, modulo 2^(bits of T).
+/// The operands are blocks of row-major matrices, whose rows are `stride` elements apart.
+/// The output must not overlap the operands.
+template <GemmElement T>
+void gemm(const T* lhs, std::size_t lhs_stride, const T* rhs, std::size_t rhs_stride,
+          T* output, std::size_t output_stride,
+          std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, GemmUpdate update = GemmUpdate::kAssign) {
+    if (dim_row == 0 || dim_col == 0) {
+        return;
+    }
+    if (dim_mid == 0) {
+        if (update == GemmUpdate::kAssign) {
+            for (std::size_t row = 0; row < dim_row; ++row) {
+                std::fill_n(output + row * output_stride, dim_col, T(0));
+            }
+        }
+        return;
+    }
+
+    auto kernels = gemm_detail::kernelsFor<T>(gemmIsa());
+
+    // The output is split into bands of tiles along its longer side, one band per thread
+    auto row_tiles = (dim_row + kernels.rows - 1) / kernels.rows;
+    auto col_tiles = (dim_col + kernels.cols - 1) / kernels.cols;
+    bool split_cols = col_tiles >= row_tiles;
+    auto num_tiles = split_cols ? col_tiles : row_tiles;
+    auto band_tiles = (num_tiles + parallelThreads() - 1) / parallelThreads();
+    auto num_tasks = (num_tiles + band_tiles - 1) / band_tiles;
+    if (num_tasks > 1) {
+        gemm_detail::reservePackedBlocks(kernels, dim_row, dim_mid, dim_col);
+    }
+    parallelForTasks(num_tasks, [&](std::size_t task) {
+        if (split_cols) {
+            auto begin = task * band_tiles * kernels.cols;
+            auto cols = std::min(band_tiles * kernels.cols, dim_col - begin);
+            gemm_detail::gemmSerial(kernels, lhs, lhs_stride, rhs + begin, rhs_stride, output + begin,
+                                    output_stride, dim_row, dim_mid, cols, update);
+        }
+        else {
+            auto begin = task * band_tiles * kernels.rows;
+            auto rows = std::min(band_tiles * kernels.rows, dim_row - begin);
+            gemm_detail::gemmSerial(kernels, lhs + begin * lhs_stride, lhs_stride, rhs, rhs_stride,
+                                    output + begin * output_stride, output_stride, rows, dim_mid, dim_col, update);
+        }
+    });
+}
+
+
+/// The five matrix-vector products of a Beaver multiplication with a single row (see BeaverGemvOperands).
+/// They are bound by reading the matrices from memory: instead of a pass to add y and one per product,
+/// each block of columns of y_0, y_1, b and b_mac is read once for all of them.
+/// The blocks are split over the threads of the GEMM.
+template <GemmElement T>
+void beaverGemv(const BeaverGemvOperands<T>& operands, std::size_t dim_mid, std::size_t dim_col) {
+    using gemm_detail::kBeaverBlockCols;
+    auto kernels = gemm_detail::kernelsFor<T>(gemmIsa());
+
+    // At least one block per thread, of whole vectors
+    auto thread_cols = (dim_col + parallelThreads() - 1) / parallelThreads();
+    auto block_cols = std::min(kBeaverBlockCols, (thread_cols + kernels.lanes - 1) / kernels.lanes * kernels.lanes);
+    auto num_blocks = (dim_col + block_cols - 1) / block_cols;
+    parallelForTasks(num_blocks, [&](std::size_t block) {
+        auto begin = block * block_cols;
+        auto num_cols = std::min(block_cols, dim_col - begin);
+        auto vector_cols = num_cols / kernels.lanes * kernels.lanes;
+        if (vector_cols > 0) {
+            kernels.beaver(operands, dim_mid, dim_col, begin, vector_cols);
+        }
+        if (vector_cols < num_cols) {
+            gemm_detail::scalar::beaverGemvKernel(operands, dim_mid, dim_col, begin + vector_cols,
+                                                  num_cols - vector_cols);
+        }
+    });
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_GEMM_H
@@ -0,0 +1,290 @@
+#ifndef BIOAUTH_LIMB_ARITHMETIC_H
+#define BIOAUTH_LIMB_ARITHMETIC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/gemm.h"
+#include "utils/parallel_for.h"
+
+
+// Element-wise arithmetic of vectors over Z_2^128, the shares of Spdz2kShare64.
+// The compiler does not vectorize the 128-bit operations, each element takes a few scalar instructions.
+// Here, a vector register holds a few elements as their low and high 64-bit limbs, in the order of the memory:
+// the limbs are added or subtracted lane by lane and the carries of the low limbs are moved to the high limbs.
+// For a product, the limbs of two registers are split into a register of low limbs and one of high limbs,
+// multiplied as in the GEMM, and interleaved again. AVX2 has no 64-bit multiplication, it keeps the scalar products.
+// The shares stay in their usual layout in memory, so the gates, Eigen and the network read them as before.
+//
+// The kernels are generated for AVX-512, AVX2 and plain C++ from limb_kernel.inc and use the instruction set
+// of the GEMM, see gemmIsa(). A vector is split over the threads of parallel_for.h.
+
+namespace bioauth {
+
+namespace limb_detail {
+
+struct LimbKernels {
+    using Binary = void (*)(const __uint128_t* x, const __uint128_t* y, __uint128_t* output, std::size_t size);
+    using WithElement = void (*)(const __uint128_t* x, __uint128_t element, __uint128_t* output, std::size_t size);
+
+    Binary add;
+    Binary subtract;
+    WithElement scalar_multiply;
+    WithElement bit_and;
+};
+
+namespace scalar {
+
+struct LimbOps {
+    static constexpr std::size_t kElements = 1;
+    static constexpr bool kMultiplies = true;
+    using Vec = __uint128_t;
+    using Scalar = __uint128_t;
+
+    static Vec load(const __uint128_t* elements) { return *elements; }
+    static void store(__uint128_t* elements, Vec vec) { *elements = vec; }
+    static Vec broadcast(__uint128_t element) { return element; }
+    static Scalar prepareScalar(__uint128_t element) { return element; }
+    static Vec add(Vec x, Vec y) { return x + y; }
+    static Vec subtract(Vec x, Vec y) { return x - y; }
+    static void multiply(Vec& x_0, Vec& x_1, Scalar scalar) {
+        x_0 *= scalar;
+        x_1 *= scalar;
+    }
+    static Vec bitAnd(Vec x, Vec mask) { return x & mask; }
+};
+
+#include "utils/limb_kernel.inc"
+
+} // namespace scalar
+
+} // namespace limb_detail
+} // namespace bioauth
+
+
+#ifdef BIOAUTH_GEMM_X86
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace bioauth::limb_detail::avx2 {
+
+// Two elements per register, the low limbs in the even lanes and the high limbs in the odd lanes
+struct LimbOps {
+    static constexpr std::size_t kElements = 2;
+    // Without 64-bit multiplications, a product takes three times the instructions of the scalar code
+    static constexpr bool kMultiplies = false;
+    using Vec = __m256i;
+
+    static Vec load(const __uint128_t* elements) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(elements));
+    }
+    static void store(__uint128_t* elements, Vec vec) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(elements), vec);
+    }
+    static Vec broadcast(__uint128_t element) {
+        auto low = static_cast<long long>(static_cast<std::uint64_t>(element));
+        auto high = static_cast<long long>(static_cast<std::uint64_t>(element >> 64));
+        return _mm256_set_epi64x(high, low, high, low);
+    }
+
+    // AVX2 only compares signed integers, flipping the sign bits compares them as unsigned ones
+    static __m256i lessThan(__m256i x, __m256i y) {
+        auto sign = _mm256_set1_epi64x(static_cast<long long>(std::uint64_t(1) << 63));
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+    }
+
+    static Vec add(Vec x, Vec y) {
+        auto sum = _mm256_add_epi64(x, y);
+        // The carries of the low limbs are all ones, shifting by 8 bytes moves them to the high limbs
+        auto carries = _mm256_slli_si256(lessThan(sum, x), 8);
+        return _mm256_sub_epi64(sum, carries);
+    }
+    static Vec subtract(Vec x, Vec y) {
+        auto difference = _mm256_sub_epi64(x, y);
+        auto borrows = _mm256_slli_si256(lessThan(x, y), 8);
+        return _mm256_add_epi64(difference, borrows);
+    }
+
+    static Vec bitAnd(Vec x, Vec mask) { return _mm256_and_si256(x, mask); }
+};
+
+#include "utils/limb_kernel.inc"
+
+} // namespace bioauth::limb_detail::avx2
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx512f,avx512dq"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq")
+#endif
+
+namespace bioauth::limb_detail::avx512 {
+
+// GCC builds the unmasked forms of these intrinsics from masked builtins that merge into _mm512_undefined_epi32(),
+// which -Wmaybe-uninitialized reports wherever they are inlined. The zero-masking forms with a full mask are
+// the same instructions without the undefined operand.
+inline __m512i mulEpu32(__m512i x, __m512i y) { return _mm512_maskz_mul_epu32(0xFF, x, y); }
+template <unsigned kShift>
+__m512i srli64(__m512i x) { return _mm512_maskz_srli_epi64(0xFF, x, kShift); }
+template <unsigned kShift>
+__m512i slli64(__m512i x) { return _mm512_maskz_slli_epi64(0xFF, x, kShift); }
+
+// Four elements per register, the low limbs in the even lanes and the high limbs in the odd lanes
+struct LimbOps {
+    static constexpr std::size_t kElements = 4;
+    static constexpr bool kMultiplies = true;
+    using Vec = __m512i;
+
+    struct Scalar {
+        __m512i low;      // the low limb
+        __m512i low_high; // its upper 32 bits
+        __m512i high;     // the high limb
+    };
+
+    // Selects the lanes of the low limbs
+    static constexpr __mmask8 kLowLimbs = 0x55;
+
+    static Vec load(const __uint128_t* elements) { return _mm512_loadu_si512(elements); }
+    static void store(__uint128_t* elements, Vec vec) { _mm512_storeu_si512(elements, vec); }
+    static Vec broadcast(__uint128_t element) {
+        auto low = static_cast<long long>(static_cast<std::uint64_t>(element));
+        auto high = static_cast<long long>(static_cast<std::uint64_t>(element >> 64));
+        return _mm512_set_epi64(high, low, high, low, high, low, high, low);
+    }
+    static Scalar prepareScalar(__uint128_t element) {
+        auto low = static_cast<std::uint64_t>(element);
+        return {_mm512_set1_epi64(static_cast<long long>(low)), _mm512_set1_epi64(static_cast<long long>(low >> 32)),
+                _mm512_set1_epi64(static_cast<long long>(element >> 64))};
+    }
+
+    static Vec add(Vec x, Vec y) {
+        auto sum = _mm512_add_epi64(x, y);
+        auto carries = static_cast<__mmask8>(_mm512_cmplt_epu64_mask(sum, x) & kLowLimbs);
+        return _mm512_mask_add_epi64(sum, static_cast<__mmask8>(carries << 1), sum, _mm512_set1_epi64(1));
+    }
+    static Vec subtract(Vec x, Vec y) {
+        auto difference = _mm512_sub_epi64(x, y);
+        auto borrows = static_cast<__mmask8>(_mm512_cmplt_epu64_mask(x, y) & kLowLimbs);
+        return _mm512_mask_sub_epi64(difference, static_cast<__mmask8>(borrows << 1), difference,
+                                     _mm512_set1_epi64(1));
+    }
+
+    // The limbs of two vectors are gathered into a vector of low limbs and a vector of high limbs,
+    // so that every lane computes a useful product. The low limb of the product is the low half of x_low * s_low,
+    // the high limb is the high half of x_low * s_low plus the low halves of x_high * s_low and x_low * s_high.
+    static void multiply(Vec& x_0, Vec& x_1, const Scalar& scalar) {
+        auto even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+        auto odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+        auto x_low = _mm512_permutex2var_epi64(x_0, even, x_1);
+        auto x_high = _mm512_permutex2var_epi64(x_0, odd, x_1);
+
+        auto mask = _mm512_set1_epi64(0xffffffff);
+        auto x_low_high = srli64<32>(x_low);
+        auto low_low = mulEpu32(x_low, scalar.low);
+        auto low_high = mulEpu32(x_low, scalar.low_high);
+        auto high_low = mulEpu32(x_low_high, scalar.low);
+        auto high_high = mulEpu32(x_low_high, scalar.low_high);
+        auto cross = _mm512_add_epi64(low_high, high_low);
+        auto product_low = _mm512_add_epi64(low_low, slli64<32>(cross));
+
+        auto middle = _mm512_add_epi64(srli64<32>(low_low),
+                                       _mm512_add_epi64(_mm512_and_si512(low_high, mask),
+                                                        _mm512_and_si512(high_low, mask)));
+        auto product_high = _mm512_add_epi64(_mm512_add_epi64(high_high, srli64<32>(middle)),
+                                             _mm512_add_epi64(srli64<32>(low_high),
+                                                              srli64<32>(high_low)));
+        product_high = _mm512_add_epi64(product_high, _mm512_add_epi64(_mm512_mullo_epi64(x_high, scalar.low),
+                                                                       _mm512_mullo_epi64(x_low, scalar.high)));
+
+        x_0 = _mm512_permutex2var_epi64(product_low, _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0), product_high);
+        x_1 = _mm512_permutex2var_epi64(product_low, _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4), product_high);
+    }
+
+    static Vec bitAnd(Vec x, Vec mask) { return _mm512_and_si512(x, mask); }
+};
+
+#include "utils/limb_kernel.inc"
+
+} // namespace bioauth::limb_detail::avx512
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // BIOAUTH_GEMM_X86
+
+
+namespace bioauth {
+
+namespace limb_detail {
+
+inline LimbKernels kernelsFor(GemmIsa isa) {
+#ifdef BIOAUTH_GEMM_X86
+    switch (isa) {
+        case GemmIsa::kAvx512:
+            return avx512::limbKernels();
+        case GemmIsa::kAvx2:
+            return avx2::limbKernels();
+        case GemmIsa::kScalar:
+            break;
+    }
+#else
+    (void) isa;
+#endif
+    return scalar::limbKernels();
+}
+
+} // namespace limb_detail
+
+
+/// output = x + y element-wise modulo 2^128, the output may be one of the operands
+inline void limbAdd(const __uint128_t* x, const __uint128_t* y, __uint128_t* output, std::size_t size) {
+    auto kernel = limb_detail::kernelsFor(gemmIsa()).add;
+    parallelFor<__uint128_t>(size, [=](std::size_t begin, std::size_t end) {
+        kernel(x + begin, y + begin, output + begin, end - begin);
+    });
+}
+
+/// output = x - y element-wise modulo 2^128, the output may be one of the operands
+inline void limbSubtract(const __uint128_t* x, const __uint128_t* y, __uint128_t* output, std::size_t size) {
+    auto kernel = limb_detail::kernelsFor(gemmIsa()).subtract;
+    parallelFor<__uint128_t>(size, [=](std::size_t begin, std::size_t end) {
+        kernel(x + begin, y + begin, output + begin, end - begin);
+    });
+}
+
+/// output = scalar * x element-wise modulo 2^128, the output may be the operand
+inline void limbScalarMultiply(const __uint128_t* x, __uint128_t scalar, __uint128_t* output, std::size_t size) {
+    auto kernel = limb_detail::kernelsFor(gemmIsa()).scalar_multiply;
+    parallelFor<__uint128_t>(size, [=](std::size_t begin, std::size_t end) {
+        kernel(x + begin, scalar, output + begin, end - begin);
+    });
+}
+
+/// output = x & mask element-wise, e.g., to remove the upper bits of shares, the output may be the operand
+inline void limbBitAnd(const __uint128_t* x, __uint128_t mask, __uint128_t* output, std::size_t size) {
+    auto kernel = limb_detail::kernelsFor(gemmIsa()).bit_and;
+    parallelFor<__uint128_t>(size, [=](std::size_t begin, std::size_t end) {
+        kernel(x + begin, mask, output + begin, end - begin);
+    });
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_LIMB_ARITHMETIC_H
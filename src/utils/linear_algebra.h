@@ -5,12 +5,48 @@
 
 
 #include <vector>
+#include <span>
+#include <ranges>
 #include <algorithm>
-#include <execution>
 #include <concepts>
+#include <type_traits>
 
 #include <Eigen/Core>
 
+#include "share/WideUint.h"
+#include "utils/gemm.h"
+#include "utils/strassen.h"
+#include "utils/limb_arithmetic.h"
+#include "utils/parallel_for.h"
+
+
+// The integers wider than 128 bits are scalars of Eigen's products, as the built-in integers
+namespace Eigen {
+
+template <std::size_t kLimbs>
+struct NumTraits<bioauth::WideUint<kLimbs>> : GenericNumTraits<bioauth::WideUint<kLimbs>> {
+    using Real = bioauth::WideUint<kLimbs>;
+    using NonInteger = bioauth::WideUint<kLimbs>;
+    using Literal = bioauth::WideUint<kLimbs>;
+    using Nested = bioauth::WideUint<kLimbs>;
+
+    enum {
+        IsComplex = 0,
+        IsInteger = 1,
+        IsSigned = 0,
+        RequireInitialization = 1,
+        ReadCost = static_cast<int>(kLimbs),
+        AddCost = 2 * static_cast<int>(kLimbs),
+        MulCost = static_cast<int>(kLimbs * (kLimbs + 1)),
+    };
+
+    static bioauth::WideUint<kLimbs> highest() { return ~bioauth::WideUint<kLimbs>(); }
+    static bioauth::WideUint<kLimbs> lowest() { return bioauth::WideUint<kLimbs>(); }
+};
+
+} // namespace Eigen
+
+
 namespace bioauth {
 
 // For matrix addtion, subtraction, and scalar product, we can use
@@ -19,13 +55,15 @@ namespace bioauth {
 // 3. Eigen's implementation of matrix operations
 // 4. naive for loop
 //
-// I found that std::transform is the fastest, so I decided to use std::transform
-// Also, we can use std::execution::par_unseq to parallelize the computation
-// However, the parallelization is only available
-// on Linux gcc and Windows MinGW gcc, but not on macOS Apple Clang.
-// so we detect it using macros to avoid compilation errors on macOS.
+// The element-wise operations are all written as matrixTransform(), a loop over raw pointers that the compiler
+// vectorizes, split over the threads of parallel_for.h for large matrices. std::transform with
+// std::execution::par_unseq depended on the build of the standard library: it was serial without TBB,
+// and split even small matrices into tasks with TBB.
+// The compiler does not vectorize the 128-bit elements, their additions, subtractions and scalar products
+// use the vector kernels of limb_arithmetic.h instead.
 //
-// For matrix multiplication, we use Eigen's implementation.
+// For matrix multiplication, we use the GEMM of gemm.h where it has vector kernels for the CPU,
+// and Eigen's implementation otherwise.
 //
 // WARNING:
 // To improve efficiency, the dimensions are not checked in these functions,
@@ -33,129 +71,415 @@ namespace bioauth {
 // so the checks are carried out prior to the online phase.
 
 
-template <std::integral T>
+// output[i] = op(inputs[i]...) in a single pass, which fuses a formula of several element-wise operations
+// without writing its intermediate results. The inputs are contiguous ranges (e.g., vectors or spans)
+// of at least the size of the output, the output may be one of the inputs.
+template <RingElement T, typename Op, std::ranges::contiguous_range... Inputs>
 inline
-std::vector<T> matrixAdd(const std::vector<T>& x, const std::vector<T>& y) {
-    std::vector<T> output(x.size());
+void matrixTransform(std::span<T> output, Op op, const Inputs&... inputs) {
+    parallelFor<T>(output.size(), [op, data = output.data(), ... input = std::ranges::data(inputs)](
+            std::size_t begin, std::size_t end) {
+        BIOAUTH_SIMD_LOOP
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            data[idx] = op(input[idx]...);
+        }
+    });
+}
 
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL   // or !__cpp_lib_execution?
-    std::transform(x.begin(), x.end(), y.begin(), output.begin(), std::plus<T>());
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), output.begin(), std::plus<T>());
-#endif
 
+// Writes x + y into an existing vector, which does not allocate if its capacity is large enough
+template <RingElement T>
+inline
+void matrixAdd(const std::vector<T>& x, const std::vector<T>& y, std::vector<T>& output) {
+    output.resize(x.size());
+
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbAdd(x.data(), y.data(), output.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(output), std::plus<T>(), x, y);
+    }
+}
+
+
+template <RingElement T>
+inline
+std::vector<T> matrixAdd(const std::vector<T>& x, const std::vector<T>& y) {
+    std::vector<T> output;
+    matrixAdd(x, y, output);
     return output;
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline
 void matrixAddAssign(std::vector<T>& x, const std::vector<T>& y) {
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), y.begin(), x.begin(), std::plus<T>());
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), x.begin(), std::plus<T>());
-#endif
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbAdd(x.data(), y.data(), x.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(x), std::plus<T>(), x, y);
+    }
 }
 
 
-template <std::integral T1, std::integral T2>
+template <RingElement T1, RingElement T2>
+inline
+void matrixAddConstant(const std::vector<T1>& x, T2 constant, std::vector<T1>& output) {
+    output.resize(x.size());
+    matrixTransform(std::span<T1>(output), [constant](T1 val) { return val + constant; }, x);
+}
+
+
+template <RingElement T1, RingElement T2>
 inline
 std::vector<T1> matrixAddConstant(const std::vector<T1>& x, T2 constant) {
-    std::vector<T1> output(x.size());
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), output.begin(),
-                   [constant](T1 val) { return val + constant; });
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), output.begin(),
-                   [constant](T1 val) { return val + constant; });
-#endif
+    std::vector<T1> output;
+    matrixAddConstant(x, constant, output);
     return output;
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline
-std::vector<T> matrixSubtract(const std::vector<T>& x, const std::vector<T>& y) {
-    std::vector<T> output(x.size());
+void matrixSubtract(const std::vector<T>& x, const std::vector<T>& y, std::vector<T>& output) {
+    output.resize(x.size());
+
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbSubtract(x.data(), y.data(), output.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(output), std::minus<T>(), x, y);
+    }
+}
 
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), y.begin(), output.begin(), std::minus<T>());
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), output.begin(), std::minus<T>());
-#endif
 
+template <RingElement T>
+inline
+std::vector<T> matrixSubtract(const std::vector<T>& x, const std::vector<T>& y) {
+    std::vector<T> output;
+    matrixSubtract(x, y, output);
     return output;
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline
 void matrixSubtractAssign(std::vector<T>& x, const std::vector<T>& y) {
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), y.begin(), x.begin(), std::minus<T>());
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), y.begin(), x.begin(), std::minus<T>());
-#endif
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbSubtract(x.data(), y.data(), x.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(x), std::minus<T>(), x, y);
+    }
 }
 
 
 // matrix scalar product
-template <std::integral T>
+template <RingElement T>
+inline
+void matrixScalarAssign(std::vector<T>& x, T scalar) {
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbScalarMultiply(x.data(), scalar, x.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(x), [scalar](T val) { return scalar * val; }, x);
+    }
+}
+
+template <RingElement T>
 inline
 std::vector<T> matrixScalar(const std::vector<T>& x, T scalar) {
     std::vector<T> output(x.size());
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), output.begin(), [scalar](T val) { return scalar * val; });
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), output.begin(),
-                   [scalar](T val) { return scalar * val; });
-#endif
+    if constexpr (std::same_as<T, __uint128_t>) {
+        limbScalarMultiply(x.data(), scalar, output.data(), x.size());
+    }
+    else {
+        matrixTransform(std::span<T>(output), [scalar](T val) { return scalar * val; }, x);
+    }
     return output;
 }
 
-template <std::integral T>
+
+template <RingElement T>
 inline
-void matrixScalarAssign(std::vector<T>& x, T scalar) {
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), x.begin(), [scalar](T val) { return scalar * val; });
-#else
-    std::transform(std::execution::par_unseq, x.begin(), x.end(), x.begin(), [scalar](T val) { return scalar * val; });
-#endif
+void matrixElemMultiply(const std::vector<T>& x, const std::vector<T>& y, std::vector<T>& output) {
+    output.resize(x.size());
+    matrixTransform(std::span<T>(output), std::multiplies<T>(), x, y);
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline
 std::vector<T> matrixElemMultiply(std::vector<T>& x, std::vector<T>& y) {
-    std::vector<T> output(x.size());
+    std::vector<T> output;
+    matrixElemMultiply(x, y, output);
+    return output;
+}
 
-#ifdef _LIBCPP_HAS_NO_INCOMPLETE_PSTL
-    std::transform(x.begin(), x.end(), y.begin(), output.begin(), std::multiplies<T>());
-#else
-    std::transform(std::execution::par_unseq,
-                   x.begin(), x.end(), y.begin(), output.begin(), std::multiplies<T>());
-#endif
 
-    return output;
+/// The index of matrixGather() that leaves out its second input
+inline constexpr std::size_t kNoIndex = static_cast<std::size_t>(-1);
+
+// output[i] = x[x_index[i]] + y[y_index[i]], or x[x_index[i]] - y[y_index[i]] with `subtract`,
+// where y is left out if y_index[i] is kNoIndex. It rearranges the elements of a matrix into a new order
+// (e.g., the candidates of the windows of a max pooling), so the accesses are not contiguous and it runs serially.
+template <RingElement T>
+inline
+void matrixGather(const std::vector<T>& x, const std::vector<std::size_t>& x_index,
+                  const std::vector<T>& y, const std::vector<std::size_t>& y_index, bool subtract,
+                  std::vector<T>& output) {
+    output.resize(x_index.size());
+    for (std::size_t i = 0; i < x_index.size(); ++i) {
+        output[i] = x[x_index[i]];
+        if (y_index[i] != kNoIndex) {
+            output[i] = subtract ? output[i] - y[y_index[i]] : output[i] + y[y_index[i]];
+        }
+    }
+}
+
+
+// output = constant + sum(coefficients[j] * inputs[j]), in a single pass over the inputs.
+// The output is computed in blocks that stay in the L1 cache while the inputs are added to them one by one,
+// so that each inner loop has a single coefficient and vectorizes.
+template <RingElement T>
+inline
+void matrixLinearCombination(const std::vector<const std::vector<T>*>& inputs, const std::vector<T>& coefficients,
+                             T constant, std::vector<T>& output) {
+    constexpr std::size_t kBlockElements = 8192 / sizeof(T);
+    output.resize(inputs.front()->size());
+
+    parallelFor<T>(output.size(), [&inputs, &coefficients, constant, data = output.data()](
+            std::size_t begin, std::size_t end) {
+        for (auto block_begin = begin; block_begin < end; block_begin += kBlockElements) {
+            auto block_end = std::min(block_begin + kBlockElements, end);
+            std::fill(data + block_begin, data + block_end, constant);
+            for (std::size_t j = 0; j < inputs.size(); ++j) {
+                const T* input = inputs[j]->data();
+                auto coefficient = coefficients[j];
+                // Most coefficients of a chain of additions and subtractions are 1 or -1
+                if constexpr (std::same_as<T, __uint128_t>) {
+                    if (coefficient == T(1)) {
+                        limbAdd(data + block_begin, input + block_begin, data + block_begin, block_end - block_begin);
+                        continue;
+                    }
+                    if (coefficient == T(-1)) {
+                        limbSubtract(data + block_begin, input + block_begin, data + block_begin,
+                                     block_end - block_begin);
+                        continue;
+                    }
+                }
+                if (coefficient == T(1)) {
+                    BIOAUTH_SIMD_LOOP
+                    for (auto idx = block_begin; idx < block_end; ++idx) data[idx] += input[idx];
+                }
+                else if (coefficient == T(-1)) {
+                    BIOAUTH_SIMD_LOOP
+                    for (auto idx = block_begin; idx < block_end; ++idx) data[idx] -= input[idx];
+                }
+                else {
+                    BIOAUTH_SIMD_LOOP
+                    for (auto idx = block_begin; idx < block_end; ++idx) data[idx] += coefficient * input[idx];
+                }
+            }
+        }
+    });
+}
+
+
+// Resizes the output to the size of the first input, which does not allocate if its capacity is large enough
+template <RingElement T, typename Op, std::ranges::contiguous_range Input, std::ranges::contiguous_range... Inputs>
+inline
+void matrixTransform(std::vector<T>& output, Op op, const Input& input, const Inputs&... inputs) {
+    output.resize(std::ranges::size(input));
+    matrixTransform(std::span<T>(output), op, input, inputs...);
+}
+
+
+// A row-major view of a dim_row x dim_col block of a larger row-major matrix, whose rows are `stride` elements apart.
+// Blocks let several matrices be stacked into one operand, e.g., a matrix and the shares of its MAC side by side,
+// so that a product with the stack reads the other operand once for all of them.
+// Element-wise expressions of blocks are evaluated by Eigen in a single pass, without temporaries.
+template <typename T>
+    requires RingElement<std::remove_const_t<T>>
+inline
+auto matrixBlock(T* data, std::size_t dim_row, std::size_t dim_col, std::size_t stride) {
+    using MatrixType = Eigen::Matrix<std::remove_const_t<T>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    using MapType = Eigen::Map<std::conditional_t<std::is_const_v<T>, const MatrixType, MatrixType>,
+                               Eigen::Unaligned, Eigen::OuterStride<>>;
+
+    return MapType(data, static_cast<Eigen::Index>(dim_row), static_cast<Eigen::Index>(dim_col),
+                   Eigen::OuterStride<>(static_cast<Eigen::Index>(stride)));
+}
+
+
+// output = lhs * rhs (or output -= lhs * rhs) for a lhs of a few rows, e.g., a row vector stacked with the shares
+// of its MAC. Eigen packs the rhs for a product with more than one row, which costs more than the product itself here.
+// Instead, the rows of the rhs are streamed once, in blocks of columns that stay in the L1 cache
+// while they are applied to every row of the lhs, four rows of the rhs at a time.
+template <bool kSubtract, RingElement T>
+inline
+void matrixMultiplyShort(const T* lhs, std::size_t lhs_stride, const T* rhs, std::size_t rhs_stride,
+                         T* output, std::size_t output_stride,
+                         std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    constexpr std::size_t kBlockCols = 2048 / sizeof(T);
+
+    for (std::size_t col_begin = 0; col_begin < dim_col; col_begin += kBlockCols) {
+        auto num_cols = std::min(kBlockCols, dim_col - col_begin);
+        if constexpr (!kSubtract) {
+            for (std::size_t row = 0; row < dim_row; ++row) {
+                std::fill_n(output + row * output_stride + col_begin, num_cols, T(0));
+            }
+        }
+        for (std::size_t mid = 0; mid < dim_mid; mid += 4) {
+            // The last rows of the rhs are padded with zero coefficients
+            auto num_mid = std::min<std::size_t>(4, dim_mid - mid);
+            const T* rhs_0 = rhs + mid * rhs_stride + col_begin;
+            const T* rhs_1 = num_mid > 1 ? rhs_0 + rhs_stride : rhs_0;
+            const T* rhs_2 = num_mid > 2 ? rhs_1 + rhs_stride : rhs_0;
+            const T* rhs_3 = num_mid > 3 ? rhs_2 + rhs_stride : rhs_0;
+            for (std::size_t row = 0; row < dim_row; ++row) {
+                const T* coefficients = lhs + row * lhs_stride + mid;
+                T c_0 = coefficients[0];
+                T c_1 = num_mid > 1 ? coefficients[1] : T(0);
+                T c_2 = num_mid > 2 ? coefficients[2] : T(0);
+                T c_3 = num_mid > 3 ? coefficients[3] : T(0);
+                T* out = output + row * output_stride + col_begin;
+                for (std::size_t col = 0; col < num_cols; ++col) {
+                    T sum = c_0 * rhs_0[col] + c_1 * rhs_1[col] + c_2 * rhs_2[col] + c_3 * rhs_3[col];
+                    if constexpr (kSubtract) {
+                        out[col] -= sum;
+                    }
+                    else {
+                        out[col] += sum;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+// Up to this many rows of the lhs, a product is faster without packing (measured with 128-bit shares).
+// A single row is left to Eigen, which evaluates it as a matrix-vector product without packing.
+// The integers wider than 128 bits take the short product for any shape: their multiplications dominate,
+// and Eigen's generic product for them is 2-3x slower (measured with 192 and 256 bits).
+inline constexpr std::size_t kMaxShortProductRows = 16;
+
+template <RingElement T>
+inline bool isShortProduct(std::size_t dim_row) {
+    if constexpr (is_wide_uint<T>::value) {
+        return true;
+    }
+    else {
+        return dim_row > 1 && dim_row <= kMaxShortProductRows;
+    }
+}
+
+
+// Whether a product goes to the GEMM of gemm.h: its vector kernels beat Eigen and the short product
+// for more than one row (measured in experiments/gemm-benchmark), except the AVX2 kernels for 128-bit elements.
+// A single row is left to Eigen, which does not pack the rhs for a matrix-vector product.
+// So are fewer than kMinGemmCols columns, e.g., a convolution with a single output position: the GEMM pads the rhs
+// to the width of its tiles (16 to 64 columns), and was up to 12x slower than Eigen for a single column
+// (measured with AVX-512 at 384 x 2048 x dim_col).
+inline constexpr std::size_t kMinGemmCols = 16;
+
+template <RingElement T>
+inline bool isGemmProduct(std::size_t dim_row, std::size_t dim_col) {
+    if constexpr (GemmElement<T>) {
+        auto isa = gemmIsa();
+        return dim_row > 1 && dim_col >= kMinGemmCols
+               && (isa == GemmIsa::kAvx512 || (isa == GemmIsa::kAvx2 && sizeof(T) <= 8));
+    }
+    else {
+        return false;
+    }
+}
+
+
+// Whether a product of the GEMM is split by Strassen-Winograd first (see strassen.h): all of its dimensions reach
+// the cutoff of its elements, from which a level of Strassen-Winograd beats the GEMM, i.e., one product of blocks
+// saves more than 15 additions of blocks cost. The wider the elements, the costlier their multiplications
+// and the smaller the cutoff (measured with AVX-512 in experiments/strassen-benchmark).
+template <RingElement T>
+inline constexpr std::size_t kStrassenCutoff = sizeof(T) <= 4 ? 1024 : sizeof(T) <= 8 ? 768 : 256;
+
+template <RingElement T>
+inline bool isStrassenProduct(std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    return isGemmProduct<T>(dim_row, dim_col) && std::min({dim_row, dim_mid, dim_col}) >= kStrassenCutoff<T>;
 }
 
 
-template <std::integral T>
+// output = lhs * rhs on blocks of larger matrices, the strides are the distances between the rows of each block
+template <RingElement T>
+inline
+void matrixMultiply(const T* lhs, std::size_t lhs_stride, const T* rhs, std::size_t rhs_stride,
+                    T* output, std::size_t output_stride,
+                    std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    if constexpr (GemmElement<T>) {
+        if (isStrassenProduct<T>(dim_row, dim_mid, dim_col)) {
+            strassenGemm(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, dim_row, dim_mid, dim_col,
+                         kStrassenCutoff<T>);
+            return;
+        }
+        if (isGemmProduct<T>(dim_row, dim_col)) {
+            gemm(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, dim_row, dim_mid, dim_col);
+            return;
+        }
+    }
+    if (isShortProduct<T>(dim_row)) {
+        matrixMultiplyShort<false>(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, dim_row, dim_mid, dim_col);
+        return;
+    }
+    auto matrix_output = matrixBlock(output, dim_row, dim_col, output_stride);
+    matrix_output.noalias() = matrixBlock(lhs, dim_row, dim_mid, lhs_stride)
+                              * matrixBlock(rhs, dim_mid, dim_col, rhs_stride);
+}
+
+
+// output -= lhs * rhs on blocks of larger matrices
+template <RingElement T>
+inline
+void matrixMultiplySubtract(const T* lhs, std::size_t lhs_stride, const T* rhs, std::size_t rhs_stride,
+                            T* output, std::size_t output_stride,
+                            std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    if constexpr (GemmElement<T>) {
+        if (isGemmProduct<T>(dim_row, dim_col)) {
+            gemm(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, dim_row, dim_mid, dim_col,
+                 GemmUpdate::kSubtract);
+            return;
+        }
+    }
+    if (isShortProduct<T>(dim_row)) {
+        matrixMultiplyShort<true>(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, dim_row, dim_mid, dim_col);
+        return;
+    }
+    auto matrix_output = matrixBlock(output, dim_row, dim_col, output_stride);
+    matrix_output.noalias() -= matrixBlock(lhs, dim_row, dim_mid, lhs_stride)
+                               * matrixBlock(rhs, dim_mid, dim_col, rhs_stride);
+}
+
+
+// The output never aliases the inputs
+template <RingElement T>
 inline
 void matrixMultiply(const T* lhs, const T* rhs, T* output,
                     std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
-    using MatrixType = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    matrixMultiply(lhs, dim_mid, rhs, dim_col, output, dim_col, dim_row, dim_mid, dim_col);
+}
 
-    Eigen::Map<const MatrixType> matrix_lhs(lhs, dim_row, dim_mid);
-    Eigen::Map<const MatrixType> matrix_rhs(rhs, dim_mid, dim_col);
-    Eigen::Map<MatrixType> matrix_output(output, dim_row, dim_col);
 
-    matrix_output = matrix_lhs * matrix_rhs;
+// output -= lhs * rhs, the product is accumulated into the output without a temporary
+template <RingElement T>
+inline
+void matrixMultiplySubtract(const T* lhs, const T* rhs, T* output,
+                            std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    matrixMultiplySubtract(lhs, dim_mid, rhs, dim_col, output, dim_col, dim_row, dim_mid, dim_col);
 }
 
 
-template <std::integral T>
+template <RingElement T>
 inline
 std::vector<T> matrixMultiply(const std::vector<T>& lhs, const std::vector<T>& rhs,
                               std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
@@ -165,6 +489,23 @@ std::vector<T> matrixMultiply(const std::vector<T>& lhs, const std::vector<T>& r
 }
 
 
+template <RingElement T>
+inline
+void matrixMultiply(const std::vector<T>& lhs, const std::vector<T>& rhs, std::vector<T>& output,
+                    std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    output.resize(dim_row * dim_col);
+    matrixMultiply(lhs.data(), rhs.data(), output.data(), dim_row, dim_mid, dim_col);
+}
+
+
+template <RingElement T>
+inline
+void matrixMultiplySubtract(const std::vector<T>& lhs, const std::vector<T>& rhs, std::vector<T>& output,
+                            std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col) {
+    matrixMultiplySubtract(lhs.data(), rhs.data(), output.data(), dim_row, dim_mid, dim_col);
+}
+
+
 } // namespace bioauth
 
 
@@ -0,0 +1,148 @@
+#ifndef BIOAUTH_PARALLEL_FOR_H
+#define BIOAUTH_PARALLEL_FOR_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <cstddef>
+
+#include "utils/WorkStealingPool.h"
+
+
+// The loops of the online phase are split over a persistent pool of threads, shared by the GEMM and
+// the element-wise operations of linear_algebra.h. std::execution::par_unseq is serial or hands out tasks of
+// a few hundred elements depending on the build of the standard library (e.g., whether it finds TBB).
+// Here, a loop is only split if each thread gets enough elements to pay for waking it up,
+// and each part runs a plain loop that the compiler vectorizes, see BIOAUTH_SIMD_LOOP.
+//
+// The pool has one thread by default, setParallelThreads() starts the others, which sleep between the loops.
+
+// Vectorizes the next loop without checking whether its arrays overlap at runtime.
+// The element-wise loops only read and write the same index of each array, so an output may be one of the inputs.
+#if defined(__clang__)
+#define BIOAUTH_SIMD_LOOP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define BIOAUTH_SIMD_LOOP _Pragma("GCC ivdep")
+#else
+#define BIOAUTH_SIMD_LOOP
+#endif
+
+namespace bioauth {
+
+namespace parallel_detail {
+
+struct Settings {
+    std::mutex mutex; // held while the pool runs a loop, the threads of other loops run theirs serially
+    std::unique_ptr<WorkStealingPool> pool;
+    std::atomic<std::size_t> num_threads = 1;
+    std::atomic<std::size_t> generation = 1; // changes with the threads of the pool, see parallelForEachThread()
+};
+
+inline Settings& settings() {
+    static Settings settings_;
+    return settings_;
+}
+
+} // namespace parallel_detail
+
+
+/// The fewest bytes of output worth a thread of their own, smaller loops run in the calling thread.
+/// Waking up the pool takes as long as adding about 64 KB of 64-bit elements,
+/// parts of 512 KB keep it near 10% of a loop (measured in experiments/parallel-for-benchmark).
+inline constexpr std::size_t kMinTaskBytes = std::size_t(512) << 10;
+
+
+/// The number of threads a loop is split over
+inline std::size_t parallelThreads() {
+    return parallel_detail::settings().num_threads.load(std::memory_order_relaxed);
+}
+
+/// Sets the number of threads a loop is split over, the calling thread is one of them
+inline void setParallelThreads(std::size_t num_threads) {
+    auto& settings = parallel_detail::settings();
+    std::lock_guard lock(settings.mutex);
+    num_threads = std::max<std::size_t>(num_threads, 1);
+    settings.num_threads.store(num_threads, std::memory_order_relaxed);
+    settings.pool = num_threads > 1 ? std::make_unique<WorkStealingPool>(num_threads) : nullptr;
+    settings.generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/// Identifies the threads of the pool, it changes whenever setParallelThreads() starts new ones
+inline std::size_t parallelGeneration() {
+    return parallel_detail::settings().generation.load(std::memory_order_relaxed);
+}
+
+
+/// Runs body() once on each thread of the pool, e.g., to size the thread-local buffers of the loops that follow.
+/// Returns the parallelGeneration() of the threads, or 0 if body() only ran in the calling thread,
+/// because there is no pool or it runs another loop.
+template <typename Body>
+std::size_t parallelForEachThread(const Body& body) {
+    auto& settings = parallel_detail::settings();
+    std::unique_lock lock(settings.mutex, std::try_to_lock);
+    if (!lock || !settings.pool) {
+        body();
+        return 0;
+    }
+
+    // A task waits until all tasks have started, so that every worker takes exactly one of them
+    auto num_threads = settings.pool->num_threads();
+    std::atomic<std::size_t> started{0};
+    auto execute = [&](std::size_t, std::size_t) {
+        body();
+        started.fetch_add(1, std::memory_order_acq_rel);
+        while (started.load(std::memory_order_acquire) < num_threads) {
+            std::this_thread::yield();
+        }
+    };
+    settings.pool->Run(num_threads, num_threads, execute);
+    return settings.generation.load(std::memory_order_relaxed);
+}
+
+
+/// Runs body(task) for each task in [0, num_tasks) on the threads of the pool,
+/// or one after another in the calling thread while they work on another loop
+template <typename Body>
+void parallelForTasks(std::size_t num_tasks, const Body& body) {
+    auto& settings = parallel_detail::settings();
+    std::unique_lock lock(settings.mutex, std::try_to_lock);
+    if (!lock || !settings.pool || num_tasks <= 1) {
+        for (std::size_t task = 0; task < num_tasks; ++task) {
+            body(task);
+        }
+        return;
+    }
+
+    // Every task is a root, so the loop allocates nothing once the queues of the pool have grown to its size
+    auto execute = [&body](std::size_t task, std::size_t) { body(task); };
+    settings.pool->Run(num_tasks, num_tasks, execute);
+}
+
+
+/// Runs kernel(begin, end) over the parts of [0, size), one part per thread, each of at least kMinTaskBytes
+/// of elements of type T. The parts are whole cache lines of elements, so that the threads rarely share a line.
+template <typename T, typename Kernel>
+void parallelFor(std::size_t size, const Kernel& kernel) {
+    constexpr std::size_t kMinTaskElements = std::max<std::size_t>(kMinTaskBytes / sizeof(T), 1);
+    constexpr std::size_t kLineElements = std::max<std::size_t>(64 / sizeof(T), 1);
+
+    auto num_tasks = std::min(parallelThreads(), size / kMinTaskElements);
+    if (num_tasks <= 1) {
+        kernel(std::size_t(0), size);
+        return;
+    }
+    auto task_size = ((size + num_tasks - 1) / num_tasks + kLineElements - 1) / kLineElements * kLineElements;
+    parallelForTasks(num_tasks, [&kernel, size, task_size](std::size_t task) {
+        auto begin = task * task_size;
+        if (begin < size) {
+            kernel(begin, std::min(begin + task_size, size));
+        }
+    });
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_PARALLEL_FOR_H
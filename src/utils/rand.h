@@ -8,13 +8,16 @@
 #include <random>
 #include <algorithm>
 #include <concepts>
+#include <cstring>
+
+#include "share/WideUint.h"
 
 namespace bioauth {
 
 /// Generate a random number of type Tp
-/// @tparam Tp The type of the random number to be generated, should be an integral type (e.g., uint64_t)
+/// @tparam Tp The type of the random number to be generated, should be an integral type (e.g., uint64_t) or a WideUint
 /// @return The generated random number of type Tp
-template <std::integral Tp>
+template <RingElement Tp>
 inline
 Tp getRand() {
     using EngOutput_t = unsigned; // EngOutput_t is the output type of the random number generator
@@ -27,7 +30,9 @@ Tp getRand() {
     EngOutput_t buf[sizeof(Tp) / sizeof(EngOutput_t)];
     std::generate(std::begin(buf), std::end(buf), []() { return rng(); });
 
-    return *reinterpret_cast<Tp*>(buf);
+    Tp value;
+    std::memcpy(&value, buf, sizeof(Tp));
+    return value;
 }
 
 } // namespace bioauth
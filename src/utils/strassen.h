@@ -0,0 +1,162 @@
+#ifndef BIOAUTH_STRASSEN_H
+#define BIOAUTH_STRASSEN_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "utils/gemm.h"
+#include "utils/parallel_for.h"
+
+
+// The Strassen-Winograd product of large matrices over Z_2^32, Z_2^64 and Z_2^128: each level splits the operands
+// into 2 x 2 blocks and replaces the 8 products of the blocks with 7, at the cost of 15 additions and subtractions.
+// It only adds, subtracts and multiplies, so it is exact modulo 2^(bits of T), as the GEMM.
+// The products of the blocks are split again until a dimension falls below the cutoff, below which the GEMM
+// of gemm.h is faster (measured in experiments/strassen-benchmark). Odd dimensions are peeled off:
+// the even part is split, and the last row, column and rank-one update are computed by the GEMM.
+
+namespace bioauth {
+
+namespace strassen_detail {
+
+// A block of a row-major matrix, whose rows are `stride` elements apart
+template <typename T>
+struct Block {
+    T* data;
+    std::size_t stride;
+
+    [[nodiscard]] Block quadrant(std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) const {
+        return {data + row * rows * stride + col * cols, stride};
+    }
+};
+
+// output = op(x, y) on rows x cols blocks, split over the threads in bands of rows
+template <typename T, typename Op>
+void blockTransform(Block<T> output, Block<const T> x, Block<const T> y, std::size_t rows, std::size_t cols, Op op) {
+    auto num_tasks = std::min(parallelThreads(), rows * cols * sizeof(T) / kMinTaskBytes);
+    num_tasks = std::max<std::size_t>(num_tasks, 1);
+    auto band_rows = (rows + num_tasks - 1) / num_tasks;
+    parallelForTasks(num_tasks, [&](std::size_t task) {
+        auto end = std::min(rows, (task + 1) * band_rows);
+        for (auto row = task * band_rows; row < end; ++row) {
+            T* out = output.data + row * output.stride;
+            const T* lhs = x.data + row * x.stride;
+            const T* rhs = y.data + row * y.stride;
+            BIOAUTH_SIMD_LOOP
+            for (std::size_t col = 0; col < cols; ++col) {
+                out[col] = op(lhs[col], rhs[col]);
+            }
+        }
+    });
+}
+
+template <typename T>
+void blockAdd(Block<T> output, Block<const T> x, Block<const T> y, std::size_t rows, std::size_t cols) {
+    blockTransform(output, x, y, rows, cols, [](T a, T b) { return a + b; });
+}
+
+template <typename T>
+void blockSubtract(Block<T> output, Block<const T> x, Block<const T> y, std::size_t rows, std::size_t cols) {
+    blockTransform(output, x, y, rows, cols, [](T a, T b) { return a - b; });
+}
+
+template <typename T>
+Block<const T> constBlock(Block<T> block) {
+    return {block.data, block.stride};
+}
+
+template <GemmElement T>
+void strassenProduct(Block<const T> lhs, Block<const T> rhs, Block<T> output,
+                     std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, std::size_t cutoff);
+
+// output = lhs * rhs for even dimensions, with the schedule of Douglas et al. (1994), which keeps
+// three temporaries: x (a block of the lhs), y (a block of the rhs) and z (a block of the output)
+template <GemmElement T>
+void strassenLevel(Block<const T> lhs, Block<const T> rhs, Block<T> output,
+                   std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, std::size_t cutoff) {
+    auto m = dim_row / 2;
+    auto k = dim_mid / 2;
+    auto n = dim_col / 2;
+    auto a11 = lhs.quadrant(0, 0, m, k), a12 = lhs.quadrant(0, 1, m, k);
+    auto a21 = lhs.quadrant(1, 0, m, k), a22 = lhs.quadrant(1, 1, m, k);
+    auto b11 = rhs.quadrant(0, 0, k, n), b12 = rhs.quadrant(0, 1, k, n);
+    auto b21 = rhs.quadrant(1, 0, k, n), b22 = rhs.quadrant(1, 1, k, n);
+    auto c11 = output.quadrant(0, 0, m, n), c12 = output.quadrant(0, 1, m, n);
+    auto c21 = output.quadrant(1, 0, m, n), c22 = output.quadrant(1, 1, m, n);
+
+    std::vector<T> x_storage(m * k), y_storage(k * n), z_storage(m * n);
+    Block<T> x{x_storage.data(), k}, y{y_storage.data(), n}, z{z_storage.data(), n};
+    auto product = [cutoff, m, k, n](Block<const T> a, Block<const T> b, Block<T> c) {
+        strassenProduct(a, b, c, m, k, n, cutoff);
+    };
+
+    blockSubtract(x, a11, a21, m, k);                                  // s3 = a11 - a21
+    blockSubtract(y, b22, b12, k, n);                                  // t3 = b22 - b12
+    product(constBlock(x), constBlock(y), c21);                        // p7 = s3 * t3
+    blockAdd(x, a21, a22, m, k);                                       // s1 = a21 + a22
+    blockSubtract(y, b12, b11, k, n);                                  // t1 = b12 - b11
+    product(constBlock(x), constBlock(y), c22);                        // p5 = s1 * t1
+    blockSubtract(x, constBlock(x), a11, m, k);                        // s2 = s1 - a11
+    blockSubtract(y, b22, constBlock(y), k, n);                        // t2 = b22 - t1
+    product(constBlock(x), constBlock(y), c12);                        // p6 = s2 * t2
+    blockSubtract(x, a12, constBlock(x), m, k);                        // s4 = a12 - s2
+    product(constBlock(x), b22, c11);                                  // p3 = s4 * b22
+    product(a11, b11, z);                                              // p1 = a11 * b11
+    blockAdd(c12, constBlock(z), constBlock(c12), m, n);               // u2 = p1 + p6
+    blockAdd(c21, constBlock(c12), constBlock(c21), m, n);             // u3 = u2 + p7
+    blockAdd(c12, constBlock(c12), constBlock(c22), m, n);             // u4 = u2 + p5
+    blockAdd(c22, constBlock(c21), constBlock(c22), m, n);             // c22 = u3 + p5
+    blockAdd(c12, constBlock(c12), constBlock(c11), m, n);             // c12 = u4 + p3
+    blockSubtract(y, constBlock(y), b21, k, n);                        // t4 = t2 - b21
+    product(a22, constBlock(y), c11);                                  // p4 = a22 * t4
+    blockSubtract(c21, constBlock(c21), constBlock(c11), m, n);        // c21 = u3 - p4
+    product(a12, b21, c11);                                            // p2 = a12 * b21
+    blockAdd(c11, constBlock(z), constBlock(c11), m, n);               // c11 = p1 + p2
+}
+
+template <GemmElement T>
+void strassenProduct(Block<const T> lhs, Block<const T> rhs, Block<T> output,
+                     std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, std::size_t cutoff) {
+    if (std::min({dim_row, dim_mid, dim_col}) < std::max<std::size_t>(cutoff, 2)) {
+        gemm(lhs.data, lhs.stride, rhs.data, rhs.stride, output.data, output.stride, dim_row, dim_mid, dim_col);
+        return;
+    }
+
+    // The even part, then the peeled-off row, column and middle index of odd dimensions
+    auto even_row = dim_row & ~std::size_t(1);
+    auto even_mid = dim_mid & ~std::size_t(1);
+    auto even_col = dim_col & ~std::size_t(1);
+    strassenLevel(lhs, rhs, output, even_row, even_mid, even_col, cutoff);
+    if (even_mid < dim_mid) {
+        gemm(lhs.data + even_mid, lhs.stride, rhs.data + even_mid * rhs.stride, rhs.stride, output.data,
+             output.stride, even_row, std::size_t(1), even_col, GemmUpdate::kAdd);
+    }
+    if (even_col < dim_col) {
+        gemm(lhs.data, lhs.stride, rhs.data + even_col, rhs.stride, output.data + even_col, output.stride,
+             dim_row, dim_mid, std::size_t(1));
+    }
+    if (even_row < dim_row) {
+        gemm(lhs.data + even_row * lhs.stride, lhs.stride, rhs.data, rhs.stride,
+             output.data + even_row * output.stride, output.stride, std::size_t(1), dim_mid, even_col);
+    }
+}
+
+} // namespace strassen_detail
+
+
+/// output = lhs * rhs modulo 2^(bits of T) by Strassen-Winograd, whose products of blocks are split
+/// until a dimension is below `cutoff`, and computed by the GEMM from there.
+/// The operands are blocks of row-major matrices, whose rows are `stride` elements apart.
+/// The output must not overlap the operands.
+template <GemmElement T>
+void strassenGemm(const T* lhs, std::size_t lhs_stride, const T* rhs, std::size_t rhs_stride,
+                  T* output, std::size_t output_stride,
+                  std::size_t dim_row, std::size_t dim_mid, std::size_t dim_col, std::size_t cutoff) {
+    strassen_detail::strassenProduct<T>({lhs, lhs_stride}, {rhs, rhs_stride}, {output, output_stride},
+                                        dim_row, dim_mid, dim_col, cutoff);
+}
+
+} // namespace bioauth
+
+#endif //BIOAUTH_STRASSEN_H
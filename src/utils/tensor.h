@@ -11,11 +11,16 @@
 #include <vector>
 #include <array>
 #include <utility>
+#include <algorithm>
+#include <cstddef>
 #include <cassert>
 
 #include <Eigen/Core>
 #include <unsupported/Eigen/CXX11/Tensor>
 
+#include "utils/linear_algebra.h"
+#include "utils/parallel_for.h"
+
 
 struct TensorDimensions {
     std::size_t batch_size_;
@@ -47,6 +52,9 @@ struct Conv2DOp {
     std::array<std::size_t, 4> pads_;
     std::array<std::size_t, 2> strides_;
 
+    // The images convolved with the same kernel, the input and the output hold them one after the other
+    std::size_t batch_size_ = 1;
+
     bool verify() const noexcept;
 
     std::array<std::size_t, 3> compute_output_shape() const noexcept;
@@ -79,6 +87,7 @@ bool Conv2DOp::verify() const noexcept {
     bool result = true;
     result = result && (output_shape_ == compute_output_shape());
     result = result && strides_[0] > 0 && strides_[1] > 0;
+    result = result && batch_size_ > 0;
     // maybe add more checks here
     return result;
 }
@@ -102,12 +111,12 @@ std::array<std::size_t, 3> Conv2DOp::compute_output_shape() const noexcept {
 std::size_t Conv2DOp::compute_output_size() const noexcept {
     assert(verify());
     auto output_shape = compute_output_shape();
-    return output_shape[0] * output_shape[1] * output_shape[2];
+    return batch_size_ * output_shape[0] * output_shape[1] * output_shape[2];
 }
 
 std::size_t Conv2DOp::compute_input_size() const noexcept {
     assert(verify());
-    return input_shape_[0] * input_shape_[1] * input_shape_[2];
+    return batch_size_ * input_shape_[0] * input_shape_[1] * input_shape_[2];
 }
 
 std::size_t Conv2DOp::compute_kernel_size() const noexcept {
@@ -120,10 +129,11 @@ std::size_t Conv2DOp::compute_bias_size() const noexcept {
     return kernel_shape_[0];
 }
 
+// The columns of the input and output matrices are the positions of the output in all images of the batch
 std::pair<std::size_t, std::size_t> Conv2DOp::compute_input_matrix_shape() const noexcept {
     assert(verify());
     std::size_t num_rows = kernel_shape_[1] * kernel_shape_[2] * kernel_shape_[3];
-    std::size_t num_columns = output_shape_[1] * output_shape_[2];
+    std::size_t num_columns = batch_size_ * output_shape_[1] * output_shape_[2];
     return {num_rows, num_columns};
 }
 
@@ -137,14 +147,14 @@ std::pair<std::size_t, std::size_t> Conv2DOp::compute_kernel_matrix_shape() cons
 std::pair<std::size_t, std::size_t> Conv2DOp::compute_output_matrix_shape() const noexcept {
     assert(verify());
     std::size_t num_rows = kernel_shape_[0];
-    std::size_t num_columns = output_shape_[1] * output_shape_[2];
+    std::size_t num_columns = batch_size_ * output_shape_[1] * output_shape_[2];
     return {num_rows, num_columns};
 }
 
 TensorDimensions Conv2DOp::get_input_tensor_dims() const noexcept {
     assert(verify());
     return {
-        .batch_size_ = 1,
+        .batch_size_ = batch_size_,
         .num_channels_ = input_shape_[0],
         .height_ = input_shape_[1],
         .width_ = input_shape_[2]
@@ -164,7 +174,7 @@ TensorDimensions Conv2DOp::get_kernel_tensor_dims() const noexcept {
 TensorDimensions Conv2DOp::get_output_tensor_dims() const noexcept {
     assert(verify());
     return {
-        .batch_size_ = 1,
+        .batch_size_ = batch_size_,
         .num_channels_ = output_shape_[0],
         .height_ = output_shape_[1],
         .width_ = output_shape_[2]
@@ -181,6 +191,7 @@ bool Conv2DOp::operator==(const Conv2DOp& other) const noexcept {
     result = result && dilations_ == other.dilations_;
     result = result && pads_ == other.pads_;
     result = result && strides_ == other.strides_;
+    result = result && batch_size_ == other.batch_size_;
     return result;
 }
 
@@ -192,6 +203,9 @@ struct MaxPoolOp {
     std::array<std::size_t, 2> kernel_shape_;
     std::array<std::size_t, 2> strides_;
 
+    // The images pooled by the same operation, the input and the output hold them one after the other
+    std::size_t batch_size_ = 1;
+
     bool verify() const noexcept;
     std::array<std::size_t, 3> compute_output_shape() const noexcept;
     std::size_t compute_kernel_size() const noexcept;
@@ -206,7 +220,8 @@ bool MaxPoolOp::verify() const noexcept {
     bool result = true;
     result = result && (output_shape_ == compute_output_shape());
     result = result && strides_[0] > 0 && strides_[1] > 0;
-    result = kernel_shape_[0] <= input_shape_[1] && kernel_shape_[1] <= input_shape_[2];
+    result = result && kernel_shape_[0] <= input_shape_[1] && kernel_shape_[1] <= input_shape_[2];
+    result = result && batch_size_ > 0;
     // maybe add more checks here
     return result;
 }
@@ -220,9 +235,9 @@ std::array<std::size_t, 3> MaxPoolOp::compute_output_shape() const noexcept {
     std::array<std::size_t, 3> output_shape;
     output_shape[0] = input_shape_[0];
     output_shape[1] =
-        compute_output_dimension(input_shape_[1], kernel_shape_[2], strides_[0]);
+        compute_output_dimension(input_shape_[1], kernel_shape_[0], strides_[0]);
     output_shape[2] =
-        compute_output_dimension(input_shape_[2], kernel_shape_[3], strides_[1]);
+        compute_output_dimension(input_shape_[2], kernel_shape_[1], strides_[1]);
     return output_shape;
 }
 
@@ -233,18 +248,18 @@ std::size_t MaxPoolOp::compute_kernel_size() const noexcept {
 
 std::size_t MaxPoolOp::compute_input_size() const noexcept {
     assert(verify());
-    return input_shape_[0] * input_shape_[1] * input_shape_[2];
+    return batch_size_ * input_shape_[0] * input_shape_[1] * input_shape_[2];
 }
 
 std::size_t MaxPoolOp::compute_output_size() const noexcept {
     assert(verify());
-    return output_shape_[0] * output_shape_[1] * output_shape_[2];
+    return batch_size_ * output_shape_[0] * output_shape_[1] * output_shape_[2];
 }
 
 TensorDimensions MaxPoolOp::get_input_tensor_dims() const noexcept {
     assert(verify());
     return {
-        .batch_size_ = 1,
+        .batch_size_ = batch_size_,
         .num_channels_ = input_shape_[0],
         .height_ = input_shape_[1],
         .width_ = input_shape_[2]
@@ -254,7 +269,7 @@ TensorDimensions MaxPoolOp::get_input_tensor_dims() const noexcept {
 TensorDimensions MaxPoolOp::get_output_tensor_dims() const noexcept {
     assert(verify());
     return {
-        .batch_size_ = 1,
+        .batch_size_ = batch_size_,
         .num_channels_ = output_shape_[0],
         .height_ = output_shape_[1],
         .width_ = output_shape_[2]
@@ -262,56 +277,146 @@ TensorDimensions MaxPoolOp::get_output_tensor_dims() const noexcept {
 }
 
 
+// Writes the patches of the input that the kernel is applied to, one column per position of the output (im2col):
+// row (c, i, j) of the (in_channels * kernel_height * kernel_width) x (batch_size * output_height * output_width)
+// row-major matrix holds the elements of channel c under the element (i, j) of the kernel, and 0 in the padding.
+// The columns of each image follow those of the previous one.
+// A convolution is the product of the kernel, as an out_channels x (in_channels * kernel_height * kernel_width)
+// matrix, with the patches, so the patches of an image can be reused for all its convolutions.
+// The rows are split over the threads of parallel_for.h.
 template <typename T>
-void convolution(const T* input_buffer, const T* kernel_buffer, T* output_buffer, const Conv2DOp& conv_op) {
-    using TensorType3 = Eigen::Tensor<T, 3, Eigen::RowMajor>;
-    using CTensorType3 = Eigen::Tensor<const T, 3, Eigen::RowMajor>;
-    using CTensorType4 = Eigen::Tensor<const T, 4, Eigen::RowMajor>;
-
+void im2col(const T* input, T* patches, const Conv2DOp& conv_op) {
     assert(conv_op.verify());
-    const auto& output_shape = conv_op.output_shape_;
-    const auto& input_shape = conv_op.input_shape_;
-    const auto& kernel_shape = conv_op.kernel_shape_;
-
-    Eigen::TensorMap<CTensorType3> input(input_buffer, input_shape[0], input_shape[1],
-                                         input_shape[2]);
-    Eigen::TensorMap<CTensorType4> kernel(kernel_buffer, kernel_shape[0], kernel_shape[1],
-                                          kernel_shape[2], kernel_shape[3]);
-    Eigen::TensorMap<TensorType3> output(output_buffer, output_shape[0], output_shape[1],
-                                         output_shape[2]);
-    const std::array<Eigen::Index, 2> kernel_matrix_dimensions = {
-        static_cast<Eigen::Index>(kernel_shape[1] * kernel_shape[2] * kernel_shape[3]),
-        static_cast<Eigen::Index>(kernel_shape[0])
-    };
-    const std::array<Eigen::Index, 2> input_matrix_dimensions = {
-        static_cast<Eigen::Index>(output_shape[1] * output_shape[2]),
-        static_cast<Eigen::Index>(kernel_shape[1] * kernel_shape[2] * kernel_shape[3])
+    const auto [num_rows, num_columns] = conv_op.compute_input_matrix_shape();
+    const auto image_size = conv_op.input_shape_[0] * conv_op.input_shape_[1] * conv_op.input_shape_[2];
+    const auto in_height = static_cast<std::ptrdiff_t>(conv_op.input_shape_[1]);
+    const auto in_width = static_cast<std::ptrdiff_t>(conv_op.input_shape_[2]);
+    const auto kernel_height = conv_op.kernel_shape_[2];
+    const auto kernel_width = conv_op.kernel_shape_[3];
+    const auto out_height = conv_op.output_shape_[1];
+    const auto out_width = static_cast<std::ptrdiff_t>(conv_op.output_shape_[2]);
+    const auto stride_rows = static_cast<std::ptrdiff_t>(conv_op.strides_[0]);
+    const auto stride_columns = static_cast<std::ptrdiff_t>(conv_op.strides_[1]);
+
+    auto fill_row = [&](std::size_t row) {
+        auto channel = row / (kernel_height * kernel_width);
+        auto i = static_cast<std::ptrdiff_t>(row / kernel_width % kernel_height);
+        auto j = static_cast<std::ptrdiff_t>(row % kernel_width);
+        const T* channel_input = input + channel * conv_op.input_shape_[1] * conv_op.input_shape_[2];
+        T* output = patches + row * num_columns;
+
+        // The input row of output row y is y * stride_rows + row_offset, and likewise for the columns
+        auto row_offset = i * static_cast<std::ptrdiff_t>(conv_op.dilations_[0])
+                          - static_cast<std::ptrdiff_t>(conv_op.pads_[0]);
+        auto column_offset = j * static_cast<std::ptrdiff_t>(conv_op.dilations_[1])
+                             - static_cast<std::ptrdiff_t>(conv_op.pads_[1]);
+        // The output columns [x_begin, x_end) read inside the image, the others read the padding
+        auto x_begin = column_offset >= 0 ? 0 : std::min((-column_offset + stride_columns - 1) / stride_columns,
+                                                         out_width);
+        auto x_end = std::clamp((in_width - column_offset + stride_columns - 1) / stride_columns, x_begin, out_width);
+
+        for (std::size_t image = 0; image < conv_op.batch_size_; ++image) {
+            const T* image_input = channel_input + image * image_size;
+            for (std::size_t y = 0; y < out_height; ++y, output += out_width) {
+                auto in_row = static_cast<std::ptrdiff_t>(y) * stride_rows + row_offset;
+                if (in_row < 0 || in_row >= in_height) {
+                    std::fill_n(output, out_width, T(0));
+                    continue;
+                }
+                const T* in = image_input + in_row * in_width + column_offset;
+                std::fill(output, output + x_begin, T(0));
+                if (stride_columns == 1) {
+                    std::copy(in + x_begin, in + x_end, output + x_begin);
+                }
+                else {
+                    for (auto x = x_begin; x < x_end; ++x) {
+                        output[x] = in[x * stride_columns];
+                    }
+                }
+                std::fill(output + x_end, output + out_width, T(0));
+            }
+        }
     };
 
-    auto kernel_matrix =
-        kernel.shuffle(std::array<int, 4>{3, 2, 1, 0}).reshape(kernel_matrix_dimensions);
+    auto num_tasks = std::clamp<std::size_t>(num_rows * num_columns * sizeof(T) / bioauth::kMinTaskBytes, 1,
+                                             std::min(bioauth::parallelThreads(), num_rows));
+    auto task_rows = (num_rows + num_tasks - 1) / num_tasks;
+    bioauth::parallelForTasks(num_tasks, [&fill_row, num_rows, task_rows](std::size_t task) {
+        for (auto row = task * task_rows; row < std::min((task + 1) * task_rows, num_rows); ++row) {
+            fill_row(row);
+        }
+    });
+}
 
-    auto input_matrix =
-        input.shuffle(Eigen::array<Eigen::Index, 3>{2, 1, 0})
-             .extract_image_patches(kernel_shape[2], kernel_shape[3], conv_op.strides_[0],
-                                    conv_op.strides_[1], conv_op.dilations_[0], conv_op.dilations_[1],
-                                    1, 1, conv_op.pads_[0], conv_op.pads_[2], conv_op.pads_[1],
-                                    conv_op.pads_[3], 0)
-             .reshape(input_matrix_dimensions);
+// Reorders the output of a convolution of a batch from (channel, image, position) to (image, channel, position),
+// i.e., from the rows of the output matrix to the images of the output tensor
+template <typename T>
+void channelsToImages(const T* channel_major, T* output, std::size_t num_channels, std::size_t batch_size,
+                      std::size_t image_size) {
+    for (std::size_t channel = 0; channel < num_channels; ++channel) {
+        for (std::size_t image = 0; image < batch_size; ++image) {
+            const T* in = channel_major + (channel * batch_size + image) * image_size;
+            std::copy(in, in + image_size, output + (image * num_channels + channel) * image_size);
+        }
+    }
+}
 
-    const std::array<Eigen::IndexPair<Eigen::Index>, 1> contraction_dimensions = {
-        Eigen::IndexPair<Eigen::Index>(1, 0)
-    };
-    auto output_matrix =
-        kernel_matrix.shuffle(std::array<Eigen::Index, 2>{1, 0})
-                     .contract(input_matrix.shuffle(std::array<Eigen::Index, 2>{1, 0}), contraction_dimensions)
-                     .shuffle(std::array<Eigen::Index, 2>{1, 0});
+// The images of a batch are convolved in groups whose patches and product (in `scratch`) take at most this many bytes,
+// so that the GEMM of each group reads them from the cache, and the product is reordered while it is still there.
+// A single GEMM over the whole batch made the large maps of the first layers slower per image than one image at a time
+// (down to half the speed with the 32x32 maps, experiments/conv-benchmark).
+inline constexpr std::size_t kConvolutionGroupBytes = 512 * 1024;
+
+// The maps of at most this many positions (e.g., 4x4 or 1x1) are too narrow to fill the tiles of the GEMM alone,
+// so a batch of them is multiplied by a single GEMM over the patches of all its images, whatever its size.
+// With the 4x4 and 1x1 maps of the last layers, a batch of 64 images took down to a third of the time per image of one.
+inline constexpr std::size_t kMaxSmallMapPositions = 16;
+
+// output = kernels * patches, where each group of out_channels rows of `kernels` (e.g., a kernel stacked with
+// the shares of its MAC) is a kernel of the convolution, and its output is written as a tensor after the previous one.
+// The product of a single image is written in place. With a batch, the product of each group of images,
+// whose columns are the positions of the images one after another, is reordered from `scratch` into their images.
+template <typename T>
+void convolvePatches(const T* kernels, std::size_t num_kernels, const T* patches, T* output, std::vector<T>& scratch,
+                     const Conv2DOp& conv_op) {
+    assert(conv_op.verify());
+    assert(num_kernels % conv_op.kernel_shape_[0] == 0);
+    const auto [num_rows, num_columns] = conv_op.compute_input_matrix_shape();
+    if (conv_op.batch_size_ == 1) {
+        bioauth::matrixMultiply(kernels, patches, output, num_kernels, num_rows, num_columns);
+        return;
+    }
 
-    const std::array<Eigen::Index, 3> rev_output_dimensions = {
-        output.dimension(2), output.dimension(1), output.dimension(0)
-    };
-    output =
-        output_matrix.reshape(rev_output_dimensions).shuffle(Eigen::array<Eigen::Index, 3>{2, 1, 0});
+    const auto num_channels = conv_op.kernel_shape_[0];
+    const auto image_size = conv_op.output_shape_[1] * conv_op.output_shape_[2];
+    const auto output_size = conv_op.compute_output_size();
+    const auto image_bytes = (num_rows + num_kernels) * image_size * sizeof(T);
+    const auto group_images = image_size <= kMaxSmallMapPositions
+                              ? conv_op.batch_size_
+                              : std::clamp<std::size_t>(kConvolutionGroupBytes / image_bytes, 1, conv_op.batch_size_);
+    scratch.resize(num_kernels * group_images * image_size);
+    for (std::size_t first = 0; first < conv_op.batch_size_; first += group_images) {
+        auto num_images = std::min(group_images, conv_op.batch_size_ - first);
+        auto group_columns = num_images * image_size;
+        bioauth::matrixMultiply(kernels, num_rows, patches + first * image_size, num_columns, scratch.data(),
+                                group_columns, num_kernels, num_rows, group_columns);
+        for (std::size_t kernel = 0; kernel < num_kernels / num_channels; ++kernel) {
+            channelsToImages(scratch.data() + kernel * num_channels * group_columns,
+                             output + kernel * output_size + first * num_channels * image_size,
+                             num_channels, num_images, image_size);
+        }
+    }
+}
+
+// The convolution as the product of the kernel with the patches of the input, by the GEMM of matrixMultiply()
+template <typename T>
+void convolution(const T* input_buffer, const T* kernel_buffer, T* output_buffer, const Conv2DOp& conv_op) {
+    assert(conv_op.verify());
+    const auto [num_rows, num_columns] = conv_op.compute_input_matrix_shape();
+    std::vector<T> patches(num_rows * num_columns);
+    std::vector<T> scratch;
+    im2col(input_buffer, patches.data(), conv_op);
+    convolvePatches(kernel_buffer, conv_op.kernel_shape_[0], patches.data(), output_buffer, scratch, conv_op);
 }
 
 template <typename T>
@@ -325,16 +430,28 @@ std::vector<T> convolution(const std::vector<T>& input_buffer,
     return output_buffer;
 }
 
+// Writes the convolution into an existing vector, which does not allocate if its capacity is large enough
+template <typename T>
+void convolution(const std::vector<T>& input_buffer, const std::vector<T>& kernel_buffer,
+                 std::vector<T>& output_buffer, const Conv2DOp& conv_op) {
+    assert(conv_op.verify());
+    assert(input_buffer.size() == conv_op.compute_input_size());
+    assert(kernel_buffer.size() == conv_op.compute_kernel_size());
+    output_buffer.resize(conv_op.compute_output_size());
+    convolution(input_buffer.data(), kernel_buffer.data(), output_buffer.data(), conv_op);
+}
+
 
+// The images of a batch are pooled as one image with the channels of all of them
 template <typename T>
 void sumPool(const T* input, T* output, const MaxPoolOp& op) {
     assert(op.verify());
     using TensorType3C = Eigen::Tensor<const T, 3, Eigen::RowMajor>;
     using TensorType3 = Eigen::Tensor<T, 3, Eigen::RowMajor>;
-    const auto in_channels = static_cast<Eigen::Index>(op.input_shape_[0]);
+    const auto in_channels = static_cast<Eigen::Index>(op.batch_size_ * op.input_shape_[0]);
     const auto in_rows = static_cast<Eigen::Index>(op.input_shape_[1]);
     const auto in_columns = static_cast<Eigen::Index>(op.input_shape_[2]);
-    const auto out_channels = static_cast<Eigen::Index>(op.output_shape_[0]);
+    const auto out_channels = static_cast<Eigen::Index>(op.batch_size_ * op.output_shape_[0]);
     const auto out_rows = static_cast<Eigen::Index>(op.output_shape_[1]);
     const auto out_columns = static_cast<Eigen::Index>(op.output_shape_[2]);
     const auto kernel_rows = static_cast<Eigen::Index>(op.kernel_shape_[0]);
@@ -362,5 +479,73 @@ std::vector<T> sumPool(const std::vector<T>& inputBuf, const MaxPoolOp& op) {
     return outputBuf;
 }
 
+template <typename T>
+inline
+void sumPool(const std::vector<T>& inputBuf, std::vector<T>& outputBuf, const MaxPoolOp& op) {
+    outputBuf.resize(op.compute_output_size());
+    sumPool(inputBuf.data(), outputBuf.data(), op);
+}
+
+
+
+// The input index of each element of each window of a pooling, the windows are in the order of the output
+// (image, channel, row, column) and the elements of a window row by row
+inline
+std::vector<std::size_t> poolingWindows(const MaxPoolOp& op) {
+    assert(op.verify());
+    const auto num_images = op.batch_size_ * op.input_shape_[0];
+    const auto in_rows = op.input_shape_[1];
+    const auto in_columns = op.input_shape_[2];
+    std::vector<std::size_t> windows;
+    windows.reserve(op.compute_output_size() * op.compute_kernel_size());
+    for (std::size_t image = 0; image < num_images; ++image) {
+        for (std::size_t out_row = 0; out_row < op.output_shape_[1]; ++out_row) {
+            for (std::size_t out_column = 0; out_column < op.output_shape_[2]; ++out_column) {
+                for (std::size_t kernel_row = 0; kernel_row < op.kernel_shape_[0]; ++kernel_row) {
+                    auto row = out_row * op.strides_[0] + kernel_row;
+                    for (std::size_t kernel_column = 0; kernel_column < op.kernel_shape_[1]; ++kernel_column) {
+                        auto column = out_column * op.strides_[1] + kernel_column;
+                        windows.push_back((image * in_rows + row) * in_columns + column);
+                    }
+                }
+            }
+        }
+    }
+    return windows;
+}
+
+
+// One level of the tournament tree that finds the maximum of each window of a max pooling.
+// The candidates are stored window after window, each window holds the same number of them.
+// The candidates 2t and 2t+1 of a window are compared, the last of an odd number advances unopposed.
+// A winner is right + max(left - right, 0), i.e., a candidate of this level plus the result of its comparison,
+// or the unopposed candidate alone (bioauth::kNoIndex as its comparison).
+struct TournamentLevel {
+    std::vector<std::size_t> left, right; // the candidates of each comparison
+    std::vector<std::size_t> winner_candidate, winner_comparison;
+    std::size_t num_winners = 0; // per window
+};
+
+inline
+TournamentLevel tournamentLevel(std::size_t num_windows, std::size_t num_candidates) {
+    TournamentLevel level;
+    const auto num_comparisons = num_candidates / 2;
+    level.num_winners = (num_candidates + 1) / 2;
+    for (std::size_t window = 0; window < num_windows; ++window) {
+        const auto first = window * num_candidates;
+        for (std::size_t t = 0; t < num_comparisons; ++t) {
+            level.left.push_back(first + 2 * t);
+            level.right.push_back(first + 2 * t + 1);
+            level.winner_candidate.push_back(first + 2 * t + 1);
+            level.winner_comparison.push_back(window * num_comparisons + t);
+        }
+        if (num_candidates % 2 == 1) {
+            level.winner_candidate.push_back(first + num_candidates - 1);
+            level.winner_comparison.push_back(bioauth::kNoIndex);
+        }
+    }
+    return level;
+}
+
 
 #endif //BIOAUTH_TENSOR_H